@@ -6,8 +6,8 @@ CONFIG += qt debug
 TEMPLATE = app
 TARGET = pipeviz
 QT += widgets
-QT += xml
 QT += core
+QT += concurrent
 INCLUDEPATH += $$OUT_PWD/src
 
 CONFIG += gstreamer
@@ -32,6 +32,28 @@ HEADERS += src/PluginsList.h        \
 		src/SeekSlider.h			\
 		src/CustomMenuAction.h		\
 		src/FavoritesList.h			\
+		src/MiniMap.h				\
+		src/Profiler.h				\
+		src/SnapshotFormat.h		\
+		src/LogRing.h				\
+		src/LogModel.h				\
+		src/LogView.h				\
+		src/LogParser.h				\
+		src/LogIndex.h				\
+		src/LogAnalyzer.h			\
+		src/LogLevelPanel.h			\
+		src/TraceRecorder.h			\
+		src/MetricsReport.h			\
+		src/PerformanceReport.h		\
+		src/TracerStats.h			\
+		src/TracerPanel.h			\
+		src/LatencyPanel.h			\
+		src/PadProbes.h				\
+		src/AllocationInspector.h	\
+		src/CopyDetector.h			\
+		src/TimingAnalyzer.h		\
+		src/SyncMonitor.h			\
+		src/SyncPanel.h				\
 		src/Logger.h
 
 SOURCES += src/main.cpp             \
@@ -46,4 +68,25 @@ SOURCES += src/main.cpp             \
 		src/SeekSlider.cpp			\
 		src/CustomMenuAction.cpp	\
 		src/FavoritesList.cpp		\
+		src/MiniMap.cpp				\
+		src/Profiler.cpp			\
+		src/SnapshotFormat.cpp		\
+		src/LogModel.cpp			\
+		src/LogView.cpp				\
+		src/LogParser.cpp			\
+		src/LogIndex.cpp			\
+		src/LogAnalyzer.cpp			\
+		src/LogLevelPanel.cpp		\
+		src/TraceRecorder.cpp		\
+		src/MetricsReport.cpp		\
+		src/PerformanceReport.cpp	\
+		src/TracerStats.cpp			\
+		src/TracerPanel.cpp			\
+		src/LatencyPanel.cpp		\
+		src/PadProbes.cpp			\
+		src/AllocationInspector.cpp	\
+		src/CopyDetector.cpp		\
+		src/TimingAnalyzer.cpp		\
+		src/SyncMonitor.cpp			\
+		src/SyncPanel.cpp			\
 		src/Logger.cpp
@@ -0,0 +1,387 @@
+#include "AllocationInspector.h"
+
+#include <QStringList>
+#include <QTimer>
+
+#include <algorithm>
+#include <string.h>
+
+#include "GraphManager.h"
+
+#define ALLOCATION_UPDATE_INTERVAL 1000
+/* distinct pool buffers remembered per pad, far more than pools hold */
+#define ALLOCATION_SEEN_SIZE 2048
+/* a pool allocating more than this once warm keeps reallocating */
+#define ALLOCATION_REALLOCATION_RATE 1.0
+
+struct AllocationInspector::PadState: public PadProbes::State
+{
+  PadState(GstPad *pad);
+  ~PadState();
+
+  std::string m_name;
+
+  GMutex m_lock;
+  AllocationAnswer m_answer;
+  GstBufferPool *m_pLastPool;
+  GstAllocator *m_pLastAllocator;
+  std::string m_pool;
+  std::string m_memoryType;
+  bool m_videoMeta;
+
+  /* written by the streaming thread only */
+  std::atomic<guint64> m_buffers;
+  std::atomic<guint64> m_allocations;
+  gpointer m_seen[ALLOCATION_SEEN_SIZE];
+  std::atomic<guint> m_seenCount;
+
+  /* read by update */
+  guint64 m_lastBuffers;
+  guint64 m_lastAllocations;
+  gint64 m_lastTime;
+};
+
+AllocationInspector::PadState::PadState (GstPad *pad)
+: m_pLastPool (NULL),
+m_pLastAllocator (NULL),
+m_videoMeta (false),
+m_buffers (0),
+m_allocations (0),
+m_seenCount (0),
+m_lastBuffers (0),
+m_lastAllocations (0),
+m_lastTime (0)
+{
+  GstObject *parent = GST_OBJECT_PARENT (pad);
+  m_name = std::string (parent ? GST_OBJECT_NAME (parent) : "") + ":"
+      + GST_OBJECT_NAME (pad);
+  g_mutex_init (&m_lock);
+  memset (m_seen, 0, sizeof(m_seen));
+}
+
+AllocationInspector::PadState::~PadState ()
+{
+  g_mutex_clear (&m_lock);
+}
+
+namespace
+{
+  void
+  parseAllocation (GstQuery *query, AllocationAnswer &answer)
+  {
+    GstCaps *caps;
+    gboolean needPool;
+
+    gst_query_parse_allocation (query, &caps, &needPool);
+    answer = AllocationAnswer ();
+    answer.m_valid = true;
+    answer.m_needPool = needPool;
+    if (caps) {
+      gchar *str = gst_caps_to_string (caps);
+      answer.m_caps = str;
+      g_free (str);
+    }
+
+    for (guint i = 0; i < gst_query_get_n_allocation_pools (query); i++) {
+      GstBufferPool *pool;
+      AllocationPool item;
+      gst_query_parse_nth_allocation_pool (query, i, &pool, &item.m_size,
+                                           &item.m_min, &item.m_max);
+      item.m_name = pool ? GST_OBJECT_NAME (pool) : "";
+      answer.m_pools.push_back (item);
+      if (pool)
+        gst_object_unref (pool);
+    }
+
+    for (guint i = 0; i < gst_query_get_n_allocation_params (query); i++) {
+      GstAllocator *allocator;
+      GstAllocationParams params;
+      gst_query_parse_nth_allocation_param (query, i, &allocator, &params);
+      answer.m_allocators.push_back (allocator && allocator->mem_type
+                                     ? allocator->mem_type : "default");
+      if (allocator)
+        gst_object_unref (allocator);
+    }
+
+    for (guint i = 0; i < gst_query_get_n_allocation_metas (query); i++)
+      answer.m_metas.push_back (
+          g_type_name (gst_query_parse_nth_allocation_meta (query, i, NULL)));
+  }
+
+  /* false when the buffer was seen already */
+  bool
+  rememberBuffer (AllocationInspector::PadState *state, GstBuffer *buffer)
+  {
+    guint slot = ((guintptr) buffer >> 4) % ALLOCATION_SEEN_SIZE;
+    for (guint i = 0; i < ALLOCATION_SEEN_SIZE; i++) {
+      gpointer &seen = state->m_seen[(slot + i) % ALLOCATION_SEEN_SIZE];
+      if (seen == buffer)
+        return false;
+      if (!seen) {
+        /* a pool reallocating for long fills it up, start over */
+        if (state->m_seenCount >= ALLOCATION_SEEN_SIZE * 3 / 4) {
+          memset (state->m_seen, 0, sizeof(state->m_seen));
+          state->m_seenCount = 0;
+          state->m_seen[slot] = buffer;
+        }
+        else
+          seen = buffer;
+        state->m_seenCount++;
+        return true;
+      }
+    }
+    return true;
+  }
+
+  bool
+  contains (const std::vector<std::string> &list, const std::string &item)
+  {
+    return std::find (list.begin (), list.end (), item) != list.end ();
+  }
+}
+
+static GstPadProbeReturn
+allocation_pad_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+  Q_UNUSED(pad);
+  AllocationInspector::PadState *state = (AllocationInspector::PadState *) data;
+
+  if (info->type & GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM) {
+    GstQuery *query = GST_PAD_PROBE_INFO_QUERY (info);
+    /* once answered */
+    if ((info->type & GST_PAD_PROBE_TYPE_PULL)
+    && GST_QUERY_TYPE (query) == GST_QUERY_ALLOCATION) {
+      AllocationAnswer answer;
+      parseAllocation (query, answer);
+      g_mutex_lock (&state->m_lock);
+      state->m_answer = answer;
+      g_mutex_unlock (&state->m_lock);
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  GstBuffer *buffer;
+  guint count = 1;
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    count = gst_buffer_list_length (list);
+    buffer = count ? gst_buffer_list_get (list, 0) : NULL;
+  }
+  else
+    buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+  if (buffer) {
+    state->m_buffers += count;
+
+    /* a pool keeps its buffers, any other buffer is a new allocation */
+    if (!buffer->pool || rememberBuffer (state, buffer))
+      state->m_allocations += count;
+
+    GstAllocator *allocator = gst_buffer_n_memory (buffer)
+        ? gst_buffer_peek_memory (buffer, 0)->allocator : NULL;
+    /* registered once libgstvideo is loaded */
+    static std::atomic<GType> videoMeta (0);
+    if (!videoMeta)
+      videoMeta = g_type_from_name ("GstVideoMetaAPI");
+    bool hasVideoMeta = videoMeta && gst_buffer_get_meta (buffer, videoMeta);
+
+    g_mutex_lock (&state->m_lock);
+    if (buffer->pool != state->m_pLastPool) {
+      state->m_pLastPool = buffer->pool;
+      state->m_pool = buffer->pool ? GST_OBJECT_NAME (buffer->pool) : "";
+    }
+    if (allocator != state->m_pLastAllocator) {
+      state->m_pLastAllocator = allocator;
+      state->m_memoryType = (allocator && allocator->mem_type)
+          ? allocator->mem_type : "";
+    }
+    state->m_videoMeta = hasVideoMeta;
+    g_mutex_unlock (&state->m_lock);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+AllocationInspector::AllocationInspector (QObject *parent)
+: QObject (parent)
+{
+  m_pUpdateTimer = new QTimer (this);
+  m_pUpdateTimer->setInterval (ALLOCATION_UPDATE_INTERVAL);
+  connect (m_pUpdateTimer, SIGNAL (timeout ()), SLOT (update ()));
+}
+
+AllocationInspector::~AllocationInspector ()
+{
+  stop ();
+}
+
+PadProbes::State *
+AllocationInspector::padData (GstPad *pad, gpointer data)
+{
+  Q_UNUSED(data);
+  if (GST_PAD_DIRECTION (pad) != GST_PAD_SRC)
+    return NULL;
+
+  return new PadState (pad);
+}
+
+bool
+AllocationInspector::start (GraphManager *graph)
+{
+  if (isRunning ())
+    return false;
+
+  m_links.clear ();
+  m_probes.add (graph->m_pGraph, (GstPadProbeType) (
+                    GST_PAD_PROBE_TYPE_BUFFER
+                    | GST_PAD_PROBE_TYPE_BUFFER_LIST
+                    | GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM),
+                allocation_pad_probe, padData, this);
+  m_pUpdateTimer->start ();
+  return true;
+}
+
+void
+AllocationInspector::stop ()
+{
+  /* the pad states go with the last probe callback */
+  m_probes.clear ();
+  m_pUpdateTimer->stop ();
+}
+
+void
+AllocationInspector::update ()
+{
+  gint64 now = g_get_monotonic_time ();
+
+  std::vector<PadProbes::State *> states = m_probes.states ();
+  for (std::size_t i = 0; i < states.size (); i++) {
+    PadState *state = static_cast<PadState *> (states[i]);
+    guint64 buffers = state->m_buffers;
+    guint64 allocations = state->m_allocations;
+    if (!buffers)
+      continue;
+
+    LinkAllocation &link = m_links[state->m_name];
+    g_mutex_lock (&state->m_lock);
+    link.m_answer = state->m_answer;
+    link.m_pool = state->m_pool;
+    link.m_memoryType = state->m_memoryType;
+    link.m_videoMeta = state->m_videoMeta;
+    g_mutex_unlock (&state->m_lock);
+    link.m_poolBuffers = link.m_pool.empty () ? 0 : (guint) state->m_seenCount;
+
+    /* the first interval sees the pool being filled */
+    bool warm = state->m_lastTime != 0;
+    if (warm) {
+      double seconds = (now - state->m_lastTime) / (double) G_USEC_PER_SEC;
+      link.m_buffersPerSecond = (buffers - state->m_lastBuffers) / seconds;
+      link.m_allocationsPerSecond = (allocations - state->m_lastAllocations)
+          / seconds;
+    }
+    state->m_lastBuffers = buffers;
+    state->m_lastAllocations = allocations;
+    state->m_lastTime = now;
+
+    const AllocationAnswer &answer = link.m_answer;
+    link.m_problem = LinkAllocation::None;
+    link.m_reason.clear ();
+
+    bool rawVideo = answer.m_caps.compare (0, 11, "video/x-raw") == 0
+        && answer.m_caps.find ("memory:") == std::string::npos;
+    bool proposedPool = false;
+    for (std::size_t j = 0; j < answer.m_pools.size (); j++)
+      proposedPool |= answer.m_pools[j].m_name == link.m_pool;
+
+    if (answer.m_valid && rawVideo && !contains (answer.m_metas, "GstVideoMetaAPI")) {
+      link.m_problem = LinkAllocation::Copy;
+      link.m_reason = "downstream does not accept GstVideoMeta, frames with "
+          "padding or plane offsets get copied";
+    }
+    else if (answer.m_valid && !answer.m_pools.empty () && !proposedPool
+             && !answer.m_allocators.empty ()
+             && !contains (answer.m_allocators, link.m_memoryType)) {
+      link.m_problem = LinkAllocation::Copy;
+      link.m_reason = "the buffers come from neither the pool nor the "
+          "allocator downstream proposed, it may copy them";
+    }
+    else if (warm && !link.m_pool.empty ()
+             && link.m_allocationsPerSecond > ALLOCATION_REALLOCATION_RATE) {
+      link.m_problem = LinkAllocation::Reallocating;
+      link.m_reason = "the pool keeps allocating new buffers";
+    }
+  }
+
+  emit updated ();
+}
+
+bool
+AllocationInspector::queryAllocation (GstPad *pad, AllocationAnswer &answer)
+{
+  GstCaps *caps = gst_pad_get_current_caps (pad);
+  if (!caps)
+    return false;
+
+  GstQuery *query = gst_query_new_allocation (caps, TRUE);
+  bool res = gst_pad_peer_query (pad, query);
+  if (res)
+    parseAllocation (query, answer);
+  gst_query_unref (query);
+  gst_caps_unref (caps);
+  return res;
+}
+
+QString
+AllocationInspector::describe (const AllocationAnswer &answer)
+{
+  if (!answer.m_valid)
+    return "no allocation query seen";
+
+  QStringList lines;
+  lines.append (QString ("pool needed: %1").arg (answer.m_needPool ? "yes" : "no"));
+
+  for (std::size_t i = 0; i < answer.m_pools.size (); i++) {
+    const AllocationPool &pool = answer.m_pools[i];
+    lines.append (QString ("pool %1: size %2, buffers %3 to %4")
+                  .arg (pool.m_name.empty () ? "(any)" : pool.m_name.c_str ())
+                  .arg (pool.m_size).arg (pool.m_min)
+                  .arg (pool.m_max ? QString::number (pool.m_max)
+                        : QString ("unlimited")));
+  }
+  if (answer.m_pools.empty ())
+    lines.append ("no pool proposed");
+
+  QStringList allocators;
+  for (std::size_t i = 0; i < answer.m_allocators.size (); i++)
+    allocators.append (answer.m_allocators[i].c_str ());
+  lines.append ("allocators: " + (allocators.isEmpty () ? QString ("none")
+                                  : allocators.join (", ")));
+
+  QStringList metas;
+  for (std::size_t i = 0; i < answer.m_metas.size (); i++)
+    metas.append (answer.m_metas[i].c_str ());
+  lines.append ("metas: " + (metas.isEmpty () ? QString ("none")
+                             : metas.join (", ")));
+
+  return lines.join ("\n");
+}
+
+QString
+AllocationInspector::describe (const LinkAllocation &link)
+{
+  QStringList lines;
+  lines.append (QString ("buffers from %1, %2 memory%3")
+                .arg (link.m_pool.empty () ? QString ("no pool")
+                      : QString ("pool %1 (%2 buffers seen)")
+                      .arg (link.m_pool.c_str ()).arg (link.m_poolBuffers))
+                .arg (link.m_memoryType.empty () ? "unknown"
+                      : link.m_memoryType.c_str ())
+                .arg (link.m_videoMeta ? ", with GstVideoMeta" : ""));
+  lines.append (QString ("%1 buffers/s, %2 allocations/s")
+                .arg (link.m_buffersPerSecond, 0, 'f', 1)
+                .arg (link.m_allocationsPerSecond, 0, 'f', 1));
+  if (link.m_problem != LinkAllocation::None)
+    lines.append (QString ("warning: %1").arg (link.m_reason.c_str ()));
+
+  return lines.join ("\n");
+}
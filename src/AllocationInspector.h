@@ -0,0 +1,110 @@
+#ifndef ALLOCATION_INSPECTOR_H_
+#define ALLOCATION_INSPECTOR_H_
+
+#include <QObject>
+#include <QString>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "PadProbes.h"
+
+class GraphManager;
+class QTimer;
+
+struct AllocationPool
+{
+  std::string m_name;
+  guint m_size;
+  guint m_min;
+  guint m_max;
+};
+
+/* The answer of the downstream element to an ALLOCATION query */
+struct AllocationAnswer
+{
+  AllocationAnswer(): m_valid(false), m_needPool(false) {}
+
+  bool m_valid;
+  bool m_needPool;
+  std::string m_caps;
+  std::vector<AllocationPool> m_pools;
+  /* memory types */
+  std::vector<std::string> m_allocators;
+  /* meta APIs, GstVideoMetaAPI and the like */
+  std::vector<std::string> m_metas;
+};
+
+/* How a source pad gets the buffers it pushes, rates over the last
+ * update interval */
+struct LinkAllocation
+{
+  enum Problem
+  {
+    None,
+    Reallocating,
+    Copy
+  };
+
+  LinkAllocation(): m_videoMeta(false), m_buffersPerSecond(0),
+      m_allocationsPerSecond(0), m_poolBuffers(0), m_problem(None) {}
+
+  /* the last one which went through the pad */
+  AllocationAnswer m_answer;
+  /* of the last buffer, the pool is empty for buffers out of any pool */
+  std::string m_pool;
+  std::string m_memoryType;
+  bool m_videoMeta;
+  double m_buffersPerSecond;
+  /* buffers never seen before, from the pool or not */
+  double m_allocationsPerSecond;
+  /* distinct pool buffers seen */
+  guint m_poolBuffers;
+  int m_problem;
+  std::string m_reason;
+};
+
+/* Probes the source pads of the pipeline for the ALLOCATION queries going
+ * downstream and for where the pushed buffers come from. The query is only
+ * sent while negotiating, start before playing to see it. */
+class AllocationInspector: public QObject
+{
+  Q_OBJECT
+
+public:
+  AllocationInspector(QObject *parent = 0);
+  ~AllocationInspector();
+
+  bool start(GraphManager *graph);
+  void stop();
+  bool isRunning() const { return m_probes.isActive (); }
+
+  /* by "element:pad" of the source pad */
+  const std::map<std::string, LinkAllocation> &links() const { return m_links; }
+
+  /* asks the peer of the source pad right now, with the current caps */
+  static bool queryAllocation(GstPad *pad, AllocationAnswer &answer);
+  static QString describe(const AllocationAnswer &answer);
+  static QString describe(const LinkAllocation &link);
+
+  struct PadState;
+
+signals:
+  void updated();
+
+private slots:
+  void update();
+
+private:
+  static PadProbes::State *padData(GstPad *pad, gpointer data);
+
+  std::map<std::string, LinkAllocation> m_links;
+  QTimer *m_pUpdateTimer;
+  /* declared last, the probes go first */
+  PadProbes m_probes;
+};
+
+#endif
@@ -0,0 +1,299 @@
+#include "CopyDetector.h"
+
+#include <QStringList>
+#include <QTimer>
+
+#include "GraphManager.h"
+
+#define COPY_UPDATE_INTERVAL 1000
+/* buffers and memories remembered per element, an element holding more,
+ * like a long queue, shows as copying; only sampled outputs look them up */
+#define COPY_RECENT_SIZE 1024
+
+struct CopyDetector::ElementState: public PadProbes::State
+{
+  ElementState(GstElement *element, int sampleEvery);
+
+  std::string m_name;
+  int m_sampleEvery;
+
+  /* the last buffers and memories the element got, only compared */
+  std::atomic<gpointer> m_recent[COPY_RECENT_SIZE];
+  std::atomic<guint> m_recentCount;
+
+  /* written by the streaming threads */
+  std::atomic<guint64> m_inputs;
+  std::atomic<guint64> m_outputs;
+  std::atomic<guint64> m_samples;
+  std::atomic<guint64> m_passThrough;
+  std::atomic<guint64> m_inPlace;
+  std::atomic<guint64> m_copies;
+  std::atomic<guint64> m_bytes;
+  std::atomic<guint64> m_copiedBytes;
+
+  /* read by update */
+  guint64 m_lastOutputs;
+  guint64 m_lastSamples;
+  guint64 m_lastPassThrough;
+  guint64 m_lastInPlace;
+  guint64 m_lastCopies;
+  guint64 m_lastBytes;
+  guint64 m_lastCopiedBytes;
+  gint64 m_lastTime;
+};
+
+CopyDetector::ElementState::ElementState (GstElement *element, int sampleEvery)
+: m_name (GST_OBJECT_NAME (element)),
+m_sampleEvery (sampleEvery),
+m_recentCount (0),
+m_inputs (0),
+m_outputs (0),
+m_samples (0),
+m_passThrough (0),
+m_inPlace (0),
+m_copies (0),
+m_bytes (0),
+m_copiedBytes (0),
+m_lastOutputs (0),
+m_lastSamples (0),
+m_lastPassThrough (0),
+m_lastInPlace (0),
+m_lastCopies (0),
+m_lastBytes (0),
+m_lastCopiedBytes (0),
+m_lastTime (g_get_monotonic_time ())
+{
+  for (int i = 0; i < COPY_RECENT_SIZE; i++)
+    m_recent[i].store (NULL, std::memory_order_relaxed);
+}
+
+namespace
+{
+  void
+  remember (CopyDetector::ElementState *state, gpointer object)
+  {
+    guint slot = state->m_recentCount.fetch_add (1, std::memory_order_relaxed);
+    state->m_recent[slot % COPY_RECENT_SIZE].store (object, std::memory_order_relaxed);
+  }
+
+  bool
+  isRecent (CopyDetector::ElementState *state, gpointer object)
+  {
+    for (int i = 0; i < COPY_RECENT_SIZE; i++) {
+      if (state->m_recent[i].load (std::memory_order_relaxed) == object)
+        return true;
+    }
+    return false;
+  }
+
+  void
+  markInput (CopyDetector::ElementState *state, GstBuffer *buffer)
+  {
+    state->m_inputs++;
+
+    remember (state, buffer);
+    for (guint i = 0; i < gst_buffer_n_memory (buffer); i++)
+      remember (state, gst_buffer_peek_memory (buffer, i));
+  }
+
+  bool
+  isMarked (CopyDetector::ElementState *state, GstMemory *memory)
+  {
+    /* or a part of the memory it got, from gst_memory_share */
+    return isRecent (state, memory)
+        || (memory->parent && isRecent (state, memory->parent));
+  }
+
+  void
+  checkOutput (CopyDetector::ElementState *state, GstBuffer *buffer)
+  {
+    if (state->m_outputs++ % state->m_sampleEvery)
+      return;
+
+    state->m_samples++;
+    state->m_bytes += gst_buffer_get_size (buffer);
+
+    if (isRecent (state, buffer)) {
+      state->m_passThrough++;
+      return;
+    }
+
+    gsize copied = 0;
+    for (guint i = 0; i < gst_buffer_n_memory (buffer); i++) {
+      GstMemory *memory = gst_buffer_peek_memory (buffer, i);
+      if (!isMarked (state, memory))
+        copied += memory->size;
+    }
+
+    if (copied) {
+      state->m_copies++;
+      state->m_copiedBytes += copied;
+    }
+    else
+      state->m_inPlace++;
+  }
+}
+
+static GstPadProbeReturn
+copy_pad_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+  CopyDetector::ElementState *state = (CopyDetector::ElementState *) data;
+
+  bool input = GST_PAD_DIRECTION (pad) == GST_PAD_SINK;
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    for (guint i = 0; i < gst_buffer_list_length (list); i++) {
+      if (input)
+        markInput (state, gst_buffer_list_get (list, i));
+      else
+        checkOutput (state, gst_buffer_list_get (list, i));
+    }
+  }
+  else if (input)
+    markInput (state, GST_PAD_PROBE_INFO_BUFFER (info));
+  else
+    checkOutput (state, GST_PAD_PROBE_INFO_BUFFER (info));
+
+  return GST_PAD_PROBE_OK;
+}
+
+CopyDetector::CopyDetector (QObject *parent)
+: QObject (parent),
+m_sampleEvery (1)
+{
+  m_pUpdateTimer = new QTimer (this);
+  m_pUpdateTimer->setInterval (COPY_UPDATE_INTERVAL);
+  connect (m_pUpdateTimer, SIGNAL (timeout ()), SLOT (update ()));
+}
+
+CopyDetector::~CopyDetector ()
+{
+  stop ();
+}
+
+PadProbes::State *
+CopyDetector::padData (GstPad *pad, gpointer data)
+{
+  CopyDetector *thiz = (CopyDetector *) data;
+  GstObject *parent = GST_OBJECT_PARENT (pad);
+
+  /* the ghost pads of a bin see what its children do */
+  if (!parent || !GST_IS_ELEMENT (parent) || GST_IS_BIN (parent))
+    return NULL;
+
+  /* the pads of an element share its state */
+  ElementState *&state = thiz->m_elementStates[GST_ELEMENT (parent)];
+  if (!state)
+    state = new ElementState (GST_ELEMENT (parent), thiz->m_sampleEvery);
+  return state;
+}
+
+bool
+CopyDetector::start (GraphManager *graph, int sampleEvery)
+{
+  if (isRunning () || sampleEvery < 1)
+    return false;
+
+  m_sampleEvery = sampleEvery;
+  m_elements.clear ();
+  m_probes.add (graph->m_pGraph, (GstPadProbeType) (
+                    GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                copy_pad_probe, padData, this);
+  m_pUpdateTimer->start ();
+  return true;
+}
+
+void
+CopyDetector::stop ()
+{
+  /* the element states go with the last probe callback */
+  m_probes.clear ();
+  m_elementStates.clear ();
+  m_pUpdateTimer->stop ();
+}
+
+void
+CopyDetector::update ()
+{
+  gint64 now = g_get_monotonic_time ();
+
+  std::vector<PadProbes::State *> states = m_probes.states ();
+  for (std::size_t i = 0; i < states.size (); i++) {
+    ElementState *state = static_cast<ElementState *> (states[i]);
+    guint64 outputs = state->m_outputs;
+    guint64 samples = state->m_samples;
+    guint64 passThrough = state->m_passThrough;
+    guint64 inPlace = state->m_inPlace;
+    guint64 copies = state->m_copies;
+    guint64 bytes = state->m_bytes;
+    guint64 copiedBytes = state->m_copiedBytes;
+    if (!outputs)
+      continue;
+
+    ElementCopy &element = m_elements[state->m_name];
+    double seconds = (now - state->m_lastTime) / (double) G_USEC_PER_SEC;
+    guint64 sampled = samples - state->m_lastSamples;
+    /* the sampled bytes stand for those of every pushed buffer */
+    double scale = sampled ? (outputs - state->m_lastOutputs) / (double) sampled : 0;
+
+    element.m_buffersPerSecond = (outputs - state->m_lastOutputs) / seconds;
+    element.m_bytesPerSecond = (bytes - state->m_lastBytes) * scale / seconds;
+    element.m_copiedBytesPerSecond = (copiedBytes - state->m_lastCopiedBytes)
+        * scale / seconds;
+
+    /* an element which stopped pushing keeps what it did last */
+    if (!state->m_inputs)
+      element.m_kind = ElementCopy::Source;
+    else if (copies > state->m_lastCopies)
+      element.m_kind = ElementCopy::Copy;
+    else if (inPlace > state->m_lastInPlace)
+      element.m_kind = ElementCopy::InPlace;
+    else if (passThrough > state->m_lastPassThrough)
+      element.m_kind = ElementCopy::PassThrough;
+
+    state->m_lastOutputs = outputs;
+    state->m_lastSamples = samples;
+    state->m_lastPassThrough = passThrough;
+    state->m_lastInPlace = inPlace;
+    state->m_lastCopies = copies;
+    state->m_lastBytes = bytes;
+    state->m_lastCopiedBytes = copiedBytes;
+    state->m_lastTime = now;
+  }
+
+  emit updated ();
+}
+
+const char *
+CopyDetector::kindName (int kind)
+{
+  switch (kind) {
+    case ElementCopy::PassThrough:
+      return "pass-through";
+    case ElementCopy::InPlace:
+      return "in-place";
+    case ElementCopy::Copy:
+      return "copy/allocate";
+    case ElementCopy::Source:
+      return "source";
+    default:
+      return "unknown";
+  }
+}
+
+QString
+CopyDetector::describe (const ElementCopy &element)
+{
+  QStringList lines;
+  lines.append (QString ("buffers: %1").arg (kindName (element.m_kind)));
+  lines.append (QString ("%1 buffers/s, %2 MB/s")
+                .arg (element.m_buffersPerSecond, 0, 'f', 1)
+                .arg (element.m_bytesPerSecond / 1e6, 0, 'f', 2));
+  if (element.m_kind == ElementCopy::Copy || element.m_kind == ElementCopy::Source)
+    lines.append (QString ("%1 MB/s %2")
+                  .arg (element.m_copiedBytesPerSecond / 1e6, 0, 'f', 2)
+                  .arg (element.m_kind == ElementCopy::Source ? "produced"
+                        : "copied or allocated"));
+
+  return lines.join ("\n");
+}
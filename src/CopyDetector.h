@@ -0,0 +1,88 @@
+#ifndef COPY_DETECTOR_H_
+#define COPY_DETECTOR_H_
+
+#include <QObject>
+#include <QString>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "PadProbes.h"
+
+class GraphManager;
+class QTimer;
+
+/* What an element does with the buffers it pushes, rates over the last
+ * update interval */
+struct ElementCopy
+{
+  enum Kind
+  {
+    Unknown,
+    /* the buffer it got */
+    PassThrough,
+    /* a new buffer on the memory it got */
+    InPlace,
+    /* memory it did not get, copied or allocated */
+    Copy,
+    /* no sink pad saw a buffer */
+    Source
+  };
+
+  ElementCopy(): m_kind(Unknown), m_buffersPerSecond(0),
+      m_bytesPerSecond(0), m_copiedBytesPerSecond(0) {}
+
+  int m_kind;
+  double m_buffersPerSecond;
+  double m_bytesPerSecond;
+  /* estimated from the sampled buffers */
+  double m_copiedBytesPerSecond;
+};
+
+/* Remembers the last buffers and memories every element got on its sink
+ * pads and looks for a sample of the buffers it pushes among them. Only
+ * the addresses are kept, a buffer freed and allocated again at once at
+ * the same address passes for the one the element got. */
+class CopyDetector: public QObject
+{
+  Q_OBJECT
+
+public:
+  CopyDetector(QObject *parent = 0);
+  ~CopyDetector();
+
+  /* one pushed buffer out of sampleEvery is looked at */
+  bool start(GraphManager *graph, int sampleEvery);
+  void stop();
+  bool isRunning() const { return m_probes.isActive (); }
+
+  /* by element name */
+  const std::map<std::string, ElementCopy> &elements() const { return m_elements; }
+
+  static const char *kindName(int kind);
+  static QString describe(const ElementCopy &element);
+
+  struct ElementState;
+
+signals:
+  void updated();
+
+private slots:
+  void update();
+
+private:
+  static PadProbes::State *padData(GstPad *pad, gpointer data);
+
+  int m_sampleEvery;
+  /* not referenced, used by padData under the lock of the probes */
+  std::map<GstElement *, ElementState *> m_elementStates;
+  std::map<std::string, ElementCopy> m_elements;
+  QTimer *m_pUpdateTimer;
+  /* declared last, the probes go first */
+  PadProbes m_probes;
+};
+
+#endif
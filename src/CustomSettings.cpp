@@ -72,3 +72,17 @@ CustomSettings::lastGstDebugString ()
 
   return res;
 }
+
+void
+CustomSettings::saveTracers (const QString &tracers)
+{
+  QSettings settings (COMPANY_NAME, APPLICATION_NAME);
+  settings.setValue ("tracers", tracers);
+}
+
+QString
+CustomSettings::lastTracers ()
+{
+  QSettings settings (COMPANY_NAME, APPLICATION_NAME);
+  return settings.value ("tracers").toString ();
+}
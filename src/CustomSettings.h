@@ -15,6 +15,10 @@ namespace CustomSettings
   void saveGstDebugString(const QString &name);
   QString lastGstDebugString();
 
+  /* GST_TRACERS syntax, enabled again at startup, empty for none */
+  void saveTracers(const QString &tracers);
+  QString lastTracers();
+
   void saveMainWindowGeometry(const QByteArray &geometry);
   QByteArray mainWindowGeometry();
 }
@@ -1,5 +1,6 @@
 #include "GraphDisplay.h"
 
+#include <algorithm>
 #include <cassert>
 #include <math.h>
 
@@ -8,7 +9,10 @@
 #include <QKeyEvent>
 #include <QMenu>
 #include <QMessageBox>
+#include <QHash>
+#include <QInputDialog>
 #include <QTableWidget>
+#include <QTimer>
 #include <QVariant>
 
 #include "ElementProperties.h"
@@ -18,12 +22,29 @@
 
 #define PAD_SIZE 8
 #define PAD_SIZE_ACTION 16
+#define BIN_MARGIN 20
+#define BIN_TITLE_HEIGHT 25
+#define BADGE_SIZE 10
+/* drop rates from this one on are shown in red */
+#define DROP_RATE_HIGH 0.05
+/* copy costs are tinted from pale to full red between these, in bytes/s */
+#define COPY_COST_LOW 1e6
+#define COPY_COST_HIGH 1e9
+/* how often a running live swap is checked, in milliseconds */
+#define SWAP_POLL_INTERVAL 20
 
 GraphDisplay::GraphDisplay (QWidget *parent, Qt::WindowFlags f)
-: QWidget (parent, f)
+: QWidget (parent, f),
+m_pAllocationInspector (NULL),
+m_pCopyDetector (NULL),
+m_pTimingAnalyzer (NULL)
 {
   setFocusPolicy (Qt::WheelFocus);
   setMouseTracking (true);
+
+  m_pSwapTimer = new QTimer (this);
+  m_pSwapTimer->setInterval (SWAP_POLL_INTERVAL);
+  connect (m_pSwapTimer, SIGNAL (timeout ()), SLOT (pollSwap ()));
 }
 
 ElementInfo*
@@ -77,23 +98,26 @@ GraphDisplay::update (const std::vector<ElementInfo> &info)
 {
   bool needUpdate = false;
 
+  /* the current elements by name, one lookup per element */
+  QHash<QString, std::size_t> oldIndexes;
+  oldIndexes.reserve (m_info.size ());
+  for (std::size_t j = 0; j < m_info.size (); j++)
+    oldIndexes.insert (QString::fromStdString (m_info[j].m_name), j);
+
   if (m_info.size () != info.size ())
     needUpdate = true;
 
   if (!needUpdate) {
     for (std::size_t i = 0; i < info.size (); i++) {
-      std::size_t j = 0;
-
-      for (; j < m_info.size (); j++) {
-        if (info[i].m_name == m_info[j].m_name)
-          break;
-      }
-
-      if (j == m_info.size ()) {
+      QHash<QString, std::size_t>::const_iterator it =
+          oldIndexes.constFind (QString::fromStdString (info[i].m_name));
+      if (it == oldIndexes.constEnd ()) {
         needUpdate = true;
         break;
       }
 
+      std::size_t j = it.value ();
+
       if (info[i].m_pads != m_info[j].m_pads) {
         needUpdate = true;
         break;
@@ -103,14 +127,99 @@ GraphDisplay::update (const std::vector<ElementInfo> &info)
         needUpdate = true;
         break;
       }
+
+      if (info[i].m_isExpanded != m_info[j].m_isExpanded
+      || info[i].m_childCount != m_info[j].m_childCount) {
+        needUpdate = true;
+        break;
+      }
     }
   }
 
   if (needUpdate) {
+    std::vector<ElementInfo> oldInfo = m_info;
+    std::vector<QRect> oldRegions;
+    for (std::size_t i = 0; i < m_displayInfo.size (); i++)
+      oldRegions.push_back (getElementRegion (i));
+
     m_info = info;
     updateDisplayInfoIds ();
     calculatePositions ();
     repaint ();
+
+    QRect changed;
+    std::vector<bool> kept (oldInfo.size (), false);
+    for (std::size_t i = 0; i < m_info.size (); i++) {
+      QHash<QString, std::size_t>::const_iterator it =
+          oldIndexes.constFind (QString::fromStdString (m_info[i].m_name));
+      std::size_t j = (it == oldIndexes.constEnd ()) ? oldInfo.size ()
+                                                     : it.value ();
+      if (j < oldInfo.size ())
+        kept[j] = true;
+
+      if (j == oldInfo.size () || oldInfo[j].m_pads != m_info[i].m_pads
+      || oldInfo[j].m_connections != m_info[i].m_connections
+      || oldInfo[j].m_isExpanded != m_info[i].m_isExpanded
+      || oldInfo[j].m_childCount != m_info[i].m_childCount) {
+        changed |= getElementRegion (i);
+        if (j < oldRegions.size ())
+          changed |= oldRegions[j];
+      }
+    }
+
+    /* the elements which went away */
+    for (std::size_t j = 0; j < oldInfo.size (); j++) {
+      if (!kept[j] && j < oldRegions.size ())
+        changed |= oldRegions[j];
+    }
+
+    if (!changed.isEmpty ())
+      emit signalRegionChanged (changed);
+  }
+}
+
+QRect
+GraphDisplay::getElementRegion (std::size_t index)
+{
+  QRect region = m_displayInfo[index].m_rect.adjusted (-PAD_SIZE, -PAD_SIZE,
+                                                       PAD_SIZE, PAD_SIZE);
+
+  for (std::size_t j = 0; j < m_info[index].m_pads.size (); j++) {
+    if (m_info[index].m_connections[j].m_elementId == ((size_t) -1)
+    || m_info[index].m_connections[j].m_padId == ((size_t) -1))
+      continue;
+
+    QPoint start = getPadPosition (m_info[index].m_id,
+                                   m_info[index].m_pads[j].m_id);
+    QPoint end = getPadPosition (m_info[index].m_connections[j].m_elementId,
+                                 m_info[index].m_connections[j].m_padId);
+    region |= QRect (start, end).normalized ().adjusted (-1, -1, 1, 1);
+  }
+
+  return region;
+}
+
+void
+GraphDisplay::getSceneItems (std::vector<QRect> &elements,
+                             std::vector<QLine> &connections)
+{
+  elements.clear ();
+  connections.clear ();
+
+  for (std::size_t i = 0; i < m_displayInfo.size (); i++) {
+    elements.push_back (m_displayInfo[i].m_rect);
+
+    for (std::size_t j = 0; j < m_info[i].m_pads.size (); j++) {
+      if (m_info[i].m_pads[j].m_type != PadInfo::Out
+      || m_info[i].m_connections[j].m_elementId == ((size_t) -1)
+      || m_info[i].m_connections[j].m_padId == ((size_t) -1))
+        continue;
+
+      connections.push_back (
+      QLine (getPadPosition (m_info[i].m_id, m_info[i].m_pads[j].m_id),
+             getPadPosition (m_info[i].m_connections[j].m_elementId,
+                             m_info[i].m_connections[j].m_padId)));
+    }
   }
 }
 
@@ -121,9 +230,23 @@ GraphDisplay::paintEvent (QPaintEvent *event)
   QPainter painter (this);
   QPen defaultPen = painter.pen ();
   for (std::size_t i = 0; i < m_displayInfo.size (); i++) {
+    QPen elementPen = defaultPen;
+    if (m_info[i].m_isBin && m_info[i].m_isExpanded)
+      elementPen.setStyle (Qt::DashLine);
     if (m_displayInfo[i].m_isSelected)
-      painter.setPen (QPen (Qt::blue));
+      elementPen.setColor (Qt::blue);
+
+    QHash<QString, double>::const_iterator copyCost =
+        m_copyCosts.constFind (QString (m_displayInfo[i].m_name.c_str ()));
+    if (copyCost != m_copyCosts.constEnd () && copyCost.value () > 0) {
+      double level = log10 (copyCost.value () / COPY_COST_LOW)
+          / log10 (COPY_COST_HIGH / COPY_COST_LOW);
+      level = std::max (0.0, std::min (1.0, level));
+      painter.fillRect (m_displayInfo[i].m_rect,
+                        QColor (255, 0, 0, 40 + (int) (level * 160)));
+    }
 
+    painter.setPen (elementPen);
     painter.drawRect (m_displayInfo[i].m_rect);
 
     painter.setPen (defaultPen);
@@ -165,13 +288,57 @@ GraphDisplay::paintEvent (QPaintEvent *event)
         xPosPeer = point.x ();
         yPosPeer = point.y ();
 
+        QHash<QString, int>::const_iterator problem =
+            m_linkProblems.constFind (getLinkSource (i, j));
+        if (problem != m_linkProblems.constEnd ()) {
+          QPen linkPen (problem.value () == LinkAllocation::Copy ? Qt::red
+                        : QColor (255, 160, 0));
+          linkPen.setWidth (2);
+          painter.setPen (linkPen);
+        }
         painter.drawLine (xPos, yPos, xPosPeer, yPosPeer);
+        painter.setPen (defaultPen);
       }
 
     }
 
+    QString title (m_displayInfo[i].m_name.c_str ());
+    if (m_info[i].m_isBin) {
+      if (m_info[i].m_isExpanded)
+        title += " [-]";
+      else
+        title += QString (" [+%1]").arg (m_info[i].m_childCount);
+    }
+
     painter.drawText (m_displayInfo[i].m_rect.topLeft () + QPoint (10, 15),
-                      QString (m_displayInfo[i].m_name.c_str ()));
+                      title);
+
+    QHash<QString, int>::const_iterator badge =
+        m_badges.constFind (QString (m_displayInfo[i].m_name.c_str ()));
+    if (badge != m_badges.constEnd ()) {
+      QColor color = (badge.value () == GST_LEVEL_ERROR) ? Qt::red
+          : QColor (255, 160, 0);
+      painter.setPen (Qt::NoPen);
+      painter.setBrush (color);
+      painter.drawEllipse (m_displayInfo[i].m_rect.topRight ()
+                           + QPoint (-BADGE_SIZE / 2 - 4, BADGE_SIZE / 2 + 4),
+                           BADGE_SIZE / 2, BADGE_SIZE / 2);
+      painter.setBrush (Qt::NoBrush);
+      painter.setPen (defaultPen);
+    }
+
+    QHash<QString, double>::const_iterator dropRate =
+        m_dropRates.constFind (QString (m_displayInfo[i].m_name.c_str ()));
+    if (dropRate != m_dropRates.constEnd ()) {
+      QString text = QString ("%1% dropped").arg (dropRate.value () * 100, 0, 'f', 1);
+      painter.setPen (dropRate.value () >= DROP_RATE_HIGH ? Qt::red
+                      : QColor (255, 160, 0));
+      const QRect &rect = m_displayInfo[i].m_rect;
+      painter.drawText (QRect (rect.left (), rect.bottom () + 2, rect.width (),
+                               painter.fontMetrics ().height ()),
+                        Qt::AlignRight | Qt::AlignTop, text);
+      painter.setPen (defaultPen);
+    }
   }
 
   if (m_moveInfo.m_action == MakeConnect) {
@@ -194,24 +361,33 @@ GraphDisplay::calculateOnePosition (const ElementInfo &info)
   displayInfo.m_name = info.m_name;
   displayInfo.m_isSelected = false;
 
-  int width = 150;
-  int height = 50;
+  QSize size = getElementSize (info);
+  int width = size.width ();
+  int height = size.height ();
 
-  int numInPads, numOutPads;
-  numInPads = numOutPads = 0;
+  int curX, curY;
+  curX = curY = 10;
 
-  for (std::size_t j = 0; j < info.m_pads.size (); j++) {
-    if (info.m_pads[j].m_type == PadInfo::Out)
-      numOutPads++;
-    else if (info.m_pads[j].m_type == PadInfo::In)
-      numInPads++;
-  }
+  /* children of an expanded bin are placed inside of it */
+  std::vector<std::size_t> ancestors;
+  for (std::size_t parentId = info.m_parentId; parentId != ((size_t) -1);) {
+    ElementInfo *parent = getElement (parentId);
+    if (!parent)
+      break;
 
-  if (std::max (numInPads, numOutPads) >= 1)
-    height += (std::max (numInPads, numOutPads) - 1) * 25;
+    ancestors.push_back (parentId);
+    parentId = parent->m_parentId;
+  }
 
-  int curX, curY;
-  curX = curY = 10;
+  if (!ancestors.empty ()) {
+    for (std::size_t i = 0; i < m_displayInfo.size (); i++) {
+      if (m_displayInfo[i].m_id == ancestors[0]) {
+        curX = m_displayInfo[i].m_rect.x () + BIN_MARGIN;
+        curY = m_displayInfo[i].m_rect.y () + BIN_TITLE_HEIGHT;
+        break;
+      }
+    }
+  }
 
   QRect rect (curX, curY, width, height);
 
@@ -220,6 +396,10 @@ GraphDisplay::calculateOnePosition (const ElementInfo &info)
     QRect rectTest (curX, curY - 15, width + 15, height + 15);
     bool noIntersects = true;
     for (std::size_t i = 0; i < m_displayInfo.size (); i++) {
+      if (std::find (ancestors.begin (), ancestors.end (),
+                     m_displayInfo[i].m_id) != ancestors.end ())
+        continue;
+
       if (rectTest.intersects (m_displayInfo[i].m_rect)) {
         noIntersects = false;
         break;
@@ -238,6 +418,82 @@ GraphDisplay::calculateOnePosition (const ElementInfo &info)
 
 }
 
+QSize
+GraphDisplay::getElementSize (const ElementInfo &info)
+{
+  int width = 150;
+  int height = 50;
+
+  int numInPads, numOutPads;
+  numInPads = numOutPads = 0;
+
+  for (std::size_t j = 0; j < info.m_pads.size (); j++) {
+    if (info.m_pads[j].m_type == PadInfo::Out)
+      numOutPads++;
+    else if (info.m_pads[j].m_type == PadInfo::In)
+      numInPads++;
+  }
+
+  if (std::max (numInPads, numOutPads) >= 1)
+    height += (std::max (numInPads, numOutPads) - 1) * 25;
+
+  return QSize (width, height);
+}
+
+bool
+GraphDisplay::isDescendant (std::size_t index, std::size_t ancestorId)
+{
+  std::size_t parentId = m_info[index].m_parentId;
+  while (parentId != ((size_t) -1)) {
+    if (parentId == ancestorId)
+      return true;
+
+    ElementInfo *parent = getElement (parentId);
+    if (!parent)
+      break;
+    parentId = parent->m_parentId;
+  }
+
+  return false;
+}
+
+void
+GraphDisplay::updateBinRects ()
+{
+  /* children always follow their bin, so walking backwards sizes nested
+   * bins before the bins containing them */
+  for (std::size_t i = m_info.size (); i-- > 0;) {
+    if (!m_info[i].m_isBin)
+      continue;
+
+    QRect children;
+    if (m_info[i].m_isExpanded) {
+      for (std::size_t k = i + 1; k < m_info.size (); k++) {
+        if (m_info[k].m_parentId == m_info[i].m_id)
+          children |= m_displayInfo[k].m_rect;
+      }
+    }
+
+    if (children.isEmpty ())
+      m_displayInfo[i].m_rect.setSize (getElementSize (m_info[i]));
+    else
+      m_displayInfo[i].m_rect = children.adjusted (-BIN_MARGIN,
+                                                   -BIN_TITLE_HEIGHT,
+                                                   BIN_MARGIN, BIN_MARGIN);
+  }
+}
+
+void
+GraphDisplay::toggleBin (std::size_t elementId)
+{
+  ElementInfo* element = getElement (elementId);
+  if (!element || !element->m_isBin)
+    return;
+
+  m_pGraph->SetBinExpanded (element->m_name.c_str (), !element->m_isExpanded);
+  update (m_pGraph->GetInfo ());
+}
+
 void
 GraphDisplay::calculatePositions ()
 {
@@ -283,6 +539,7 @@ GraphDisplay::calculatePositions ()
   }
 
   m_displayInfo = reorderedDisplayInfo;
+  updateBinRects ();
 }
 
 void
@@ -378,8 +635,7 @@ GraphDisplay::mouseReleaseEvent (QMouseEvent *event)
         QMessageBox::warning (this, "Connection failed", msg);
       }
 
-      m_info = m_pGraph->GetInfo ();
-      updateDisplayInfoIds ();
+      update (m_pGraph->GetInfo ());
       if (g_str_has_prefix (infoDst.m_name.c_str (), "decodebin")) {
         m_pGraph->Play ();
         LOG_INFO("Launch play to discover the new pad");
@@ -423,6 +679,33 @@ GraphDisplay::mouseReleaseEvent (QMouseEvent *event)
   m_moveInfo.m_startPosition = QPoint ();
   m_moveInfo.m_position = QPoint ();
   repaint ();
+
+  QStringList selected;
+  for (std::size_t i = 0; i < m_displayInfo.size (); i++) {
+    if (m_displayInfo[i].m_isSelected)
+      selected.append (m_displayInfo[i].m_name.c_str ());
+  }
+  emit signalSelectionChanged (selected);
+}
+
+void
+GraphDisplay::setBadges (const QHash<QString, int> &badges)
+{
+  if (badges == m_badges)
+    return;
+
+  m_badges = badges;
+  repaint ();
+}
+
+void
+GraphDisplay::setDropRates (const QHash<QString, double> &rates)
+{
+  if (rates == m_dropRates)
+    return;
+
+  m_dropRates = rates;
+  repaint ();
 }
 
 void
@@ -436,8 +719,30 @@ GraphDisplay::mouseMoveEvent (QMouseEvent *event)
       if (m_displayInfo[i].m_id == m_moveInfo.m_elementId) {
         QRect newRect = m_displayInfo[i].m_rect;
         newRect.adjust (dx, dy, dx, dy);
-        if (contentsRect ().contains (newRect))
-          m_displayInfo[i].m_rect = newRect;
+        if (contentsRect ().contains (newRect)) {
+          /* a bin moves with its children, and the bins around the element
+           * are resized to follow it */
+          QRect changed;
+          for (std::size_t k = 0; k < m_displayInfo.size (); k++) {
+            if (k == i || isDescendant (k, m_moveInfo.m_elementId)
+            || isDescendant (i, m_displayInfo[k].m_id))
+              changed |= getElementRegion (k);
+          }
+
+          for (std::size_t k = 0; k < m_displayInfo.size (); k++) {
+            if (k == i || isDescendant (k, m_moveInfo.m_elementId))
+              m_displayInfo[k].m_rect.translate (dx, dy);
+          }
+          updateBinRects ();
+
+          for (std::size_t k = 0; k < m_displayInfo.size (); k++) {
+            if (k == i || isDescendant (k, m_moveInfo.m_elementId)
+            || isDescendant (i, m_displayInfo[k].m_id))
+              changed |= getElementRegion (k);
+          }
+
+          emit signalRegionChanged (changed);
+        }
         break;
       }
     }
@@ -454,13 +759,27 @@ GraphDisplay::mouseMoveEvent (QMouseEvent *event)
       ElementInfo* element = getElement (elementId);
       PadInfo* pad = getPad (elementId, padId);
       QString caps = m_pGraph->getPadCaps (element, pad, PAD_CAPS_ALL, true);
-      setToolTip (caps);
+      setToolTip (caps + describeAllocation (elementId, padId));
     }
+    else if (getLinkByPosition (event->pos (), elementId, padId))
+      setToolTip (describeAllocation (elementId, padId).trimmed ());
+    else if (elementId != ((size_t) -1))
+      setToolTip (describeCopies (elementId));
     else
       setToolTip ("");
   }
 }
 
+void
+GraphDisplay::mouseDoubleClickEvent (QMouseEvent *event)
+{
+  std::size_t elementId, padId;
+  getIdByPosition (event->pos (), elementId, padId);
+
+  if (elementId != ((size_t) -1) && padId == ((size_t) -1))
+    toggleBin (elementId);
+}
+
 void
 GraphDisplay::keyPressEvent (QKeyEvent* event)
 {
@@ -516,6 +835,15 @@ GraphDisplay::showContextMenu (QMouseEvent *event)
       pact->setDisabled (true);
 
     menu.addAction (new CustomMenuAction ("Request pad...", &menu));
+    menu.addAction (new CustomMenuAction ("Replace element...", &menu));
+
+    ElementInfo* element = getElement (elementId);
+    if (element && element->m_isBin) {
+      if (element->m_isExpanded)
+        menu.addAction (new CustomMenuAction ("Collapse bin", &menu));
+      else
+        menu.addAction (new CustomMenuAction ("Expand bin", &menu));
+    }
   }
   else {
     for (std::size_t i = 0; i < m_info.size (); i++) {
@@ -556,6 +884,8 @@ GraphDisplay::showContextMenu (QMouseEvent *event)
 
             if (isActive)
               pact->setDisabled (true);
+
+            menu.addAction (new CustomMenuAction ("Insert element...", &menu));
             break;
           }
         }
@@ -587,6 +917,13 @@ GraphDisplay::showContextMenu (QMouseEvent *event)
         disconnect (elementId, padId);
       else if (pact->getName () == "Request pad...")
         requestPad (elementId);
+      else if (pact->getName () == "Replace element...")
+        replaceElement (elementId);
+      else if (pact->getName () == "Insert element...")
+        insertElement (elementId, padId);
+      else if (pact->getName () == "Expand bin"
+      || pact->getName () == "Collapse bin")
+        toggleBin (elementId);
       else if (pact->getName () == "Remove selected")
         removeSelected ();
       else if (pact->getName () == "ElementName")
@@ -611,18 +948,30 @@ GraphDisplay::removeSelected ()
   || state == GST_STATE_PLAYING)
     return;
 
-  while (true) {
-    std::size_t i = 0;
-    for (; i < m_displayInfo.size (); i++) {
-      if (m_displayInfo[i].m_isSelected)
+  m_pGraph->BeginTransaction ();
+  for (std::size_t i = 0; i < m_displayInfo.size (); i++) {
+    if (!m_displayInfo[i].m_isSelected)
+      continue;
+
+    /* removing a bin already removes its children */
+    bool parentSelected = false;
+    for (std::size_t k = 0; k < m_displayInfo.size (); k++) {
+      if (m_displayInfo[k].m_isSelected
+      && isDescendant (i, m_displayInfo[k].m_id)) {
+        parentSelected = true;
         break;
+      }
     }
 
-    if (i != m_displayInfo.size ())
-      removePlugin (m_displayInfo[i].m_id);
-    else
-      break;
+    if (!parentSelected)
+      m_pGraph->RemovePlugin (m_displayInfo[i].m_name.c_str ());
   }
+
+  if (!m_pGraph->CommitTransaction ())
+    QMessageBox::warning (this, "Element removing problem",
+                          "Removing of the selected elements was FAILED");
+
+  update (m_pGraph->GetInfo ());
 }
 
 void
@@ -684,7 +1033,9 @@ GraphDisplay::showPadProperties (std::size_t elementId, std::size_t padId)
   if (pad) {
     PadProperties *pprops = new PadProperties (m_pGraph,
                                                element->m_name.c_str (),
-                                               pad->m_name.c_str ());
+                                               pad->m_name.c_str (),
+                                               m_pAllocationInspector,
+                                               m_pTimingAnalyzer);
     pprops->setAttribute (Qt::WA_QuitOnClose, false);
     pprops->show ();
   }
@@ -774,9 +1125,123 @@ GraphDisplay::disconnect (size_t elementId, size_t padId)
   m_pGraph->Disconnect (src.c_str (), srcPad.c_str (), dst.c_str (),
                         dstPad.c_str ());
 
-  m_info = m_pGraph->GetInfo ();
-  updateDisplayInfoIds ();
-  repaint ();
+  update (m_pGraph->GetInfo ());
+}
+
+QString
+GraphDisplay::choosePlugin (const QString &title)
+{
+  QStringList names;
+  PluginsList* pluginList = new PluginsList ();
+  GList* plugins_list = pluginList->getSortedByRank ();
+  for (GList* l = plugins_list; l != NULL; l = l->next)
+    names << ((Plugin*) (l->data))->getName ();
+  delete pluginList;
+
+  bool ok;
+  QString name = QInputDialog::getItem (this, title, "Plugin:", names, 0, true,
+                                        &ok);
+  if (!ok)
+    return QString ();
+
+  return name.trimmed ();
+}
+
+void
+GraphDisplay::showSwapReport (bool res, const SwapReport &report)
+{
+  /* the streaming threads go on with it, the GUI stays responsive */
+  if (res && report.m_pending) {
+    m_pSwapTimer->start ();
+    return;
+  }
+
+  if (!res) {
+    QMessageBox::warning (this, "Live reconfiguration problem",
+                          report.m_error.c_str ());
+    return;
+  }
+
+  QString message;
+  if (report.m_glitch < 0)
+    message = "No data has passed the new element yet";
+  else
+    message = QString ("Data was held for %1 ms, about %2 buffers dropped")
+    .arg (report.m_glitch / 1000.0, 0, 'f', 1)
+    .arg (report.m_droppedBuffers);
+  if (!report.m_drained)
+    message += "\nThe old element was not drained in time, the data it held was dropped";
+
+  QMessageBox::information (this, "Live reconfiguration", message);
+}
+
+void
+GraphDisplay::pollSwap ()
+{
+  bool res;
+  SwapReport report;
+  if (!m_pGraph->PollSwap (res, report))
+    return;
+
+  m_pSwapTimer->stop ();
+  update (m_pGraph->GetInfo ());
+  showSwapReport (res, report);
+}
+
+void
+GraphDisplay::replaceElement (std::size_t elementId)
+{
+  ElementInfo* element = getElement (elementId);
+  if (!element)
+    return;
+
+  QString plugin = choosePlugin ("Replace " + QString (element->m_name.c_str ()));
+  if (plugin.isEmpty ())
+    return;
+
+  SwapReport report;
+  bool res = m_pGraph->ReplaceElement (element->m_name.c_str (),
+                                       plugin.toStdString ().c_str (), report);
+
+  update (m_pGraph->GetInfo ());
+  showSwapReport (res, report);
+}
+
+void
+GraphDisplay::insertElement (std::size_t elementId, std::size_t padId)
+{
+  ElementInfo* element = getElement (elementId);
+  PadInfo* pad = getPad (elementId, padId);
+  if (!element || !pad)
+    return;
+
+  /* the link is changed from its upstream end */
+  if (pad->m_type != PadInfo::Out) {
+    for (std::size_t i = 0; i < element->m_pads.size (); i++) {
+      if (element->m_pads[i].m_id == padId) {
+        std::size_t peerId = element->m_connections[i].m_elementId;
+        std::size_t peerPadId = element->m_connections[i].m_padId;
+        element = getElement (peerId);
+        pad = getPad (peerId, peerPadId);
+        break;
+      }
+    }
+    if (!element || !pad)
+      return;
+  }
+
+  QString plugin = choosePlugin ("Insert after "
+  + QString (element->m_name.c_str ()) + ":" + pad->m_name.c_str ());
+  if (plugin.isEmpty ())
+    return;
+
+  SwapReport report;
+  bool res = m_pGraph->InsertElement (element->m_name.c_str (),
+                                      pad->m_name.c_str (),
+                                      plugin.toStdString ().c_str (), report);
+
+  update (m_pGraph->GetInfo ());
+  showSwapReport (res, report);
 }
 
 void
@@ -889,6 +1354,7 @@ GraphDisplay::getIdByPosition (const QPoint &pos, std::size_t &elementId,
                                std::size_t &padId)
 {
   std::size_t i = 0;
+  std::size_t binId = -1;
   elementId = padId = -1;
   for (; i < m_displayInfo.size (); i++) {
     if (elementId != ((size_t) -1))
@@ -920,11 +1386,152 @@ GraphDisplay::getIdByPosition (const QPoint &pos, std::size_t &elementId,
       }
 
       if (j == m_info[i].m_pads.size ()) {
-        if (m_displayInfo[i].m_rect.contains (pos))
-          elementId = m_displayInfo[i].m_id;
+        if (m_displayInfo[i].m_rect.contains (pos)) {
+          /* keep looking for a child of the bin under the cursor */
+          if (m_info[i].m_isBin && m_info[i].m_isExpanded)
+            binId = m_displayInfo[i].m_id;
+          else
+            elementId = m_displayInfo[i].m_id;
+        }
       }
     }
   }
+
+  if (elementId == ((size_t) -1))
+    elementId = binId;
+}
+
+QString
+GraphDisplay::getLinkSource (std::size_t index, std::size_t padIndex)
+{
+  const ElementInfo &info = m_info[index];
+  if (info.m_pads[padIndex].m_type == PadInfo::Out)
+    return QString ("%1:%2").arg (info.m_name.c_str ())
+        .arg (info.m_pads[padIndex].m_name.c_str ());
+
+  ElementInfo *peer = getElement (info.m_connections[padIndex].m_elementId);
+  PadInfo *peerPad = getPad (info.m_connections[padIndex].m_elementId,
+                             info.m_connections[padIndex].m_padId);
+  if (!peer || !peerPad)
+    return QString ();
+
+  return QString ("%1:%2").arg (peer->m_name.c_str ())
+      .arg (peerPad->m_name.c_str ());
+}
+
+bool
+GraphDisplay::getLinkByPosition (const QPoint &pos, std::size_t &elementId,
+                                 std::size_t &padId)
+{
+  for (std::size_t i = 0; i < m_info.size (); i++) {
+    for (std::size_t j = 0; j < m_info[i].m_pads.size (); j++) {
+      if (m_info[i].m_pads[j].m_type != PadInfo::Out
+      || m_info[i].m_connections[j].m_elementId == ((size_t) -1)
+      || m_info[i].m_connections[j].m_padId == ((size_t) -1))
+        continue;
+
+      QPointF from = getPadPosition (m_info[i].m_id, m_info[i].m_pads[j].m_id);
+      QPointF to = getPadPosition (m_info[i].m_connections[j].m_elementId,
+                                   m_info[i].m_connections[j].m_padId);
+
+      /* distance to the segment */
+      QPointF line = to - from;
+      double length = QPointF::dotProduct (line, line);
+      double t = length > 0 ? QPointF::dotProduct (pos - from, line) / length : 0;
+      QPointF closest = from + qBound (0.0, t, 1.0) * line;
+      if ((pos - closest).manhattanLength () <= PAD_SIZE / 2) {
+        elementId = m_info[i].m_id;
+        padId = m_info[i].m_pads[j].m_id;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+QString
+GraphDisplay::describeAllocation (std::size_t elementId, std::size_t padId)
+{
+  if (!m_pAllocationInspector || !m_pAllocationInspector->isRunning ())
+    return QString ();
+
+  for (std::size_t i = 0; i < m_info.size (); i++) {
+    if (m_info[i].m_id != elementId)
+      continue;
+
+    for (std::size_t j = 0; j < m_info[i].m_pads.size (); j++) {
+      if (m_info[i].m_pads[j].m_id != padId)
+        continue;
+
+      std::map<std::string, LinkAllocation>::const_iterator link =
+          m_pAllocationInspector->links ().find (
+              getLinkSource (i, j).toStdString ());
+      if (link == m_pAllocationInspector->links ().end ())
+        return QString ();
+
+      return "\n\n" + AllocationInspector::describe (link->second.m_answer)
+          + "\n" + AllocationInspector::describe (link->second);
+    }
+  }
+
+  return QString ();
+}
+
+void
+GraphDisplay::setAllocationInspector (AllocationInspector *inspector)
+{
+  m_pAllocationInspector = inspector;
+}
+
+QString
+GraphDisplay::describeCopies (std::size_t elementId)
+{
+  if (!m_pCopyDetector || !m_pCopyDetector->isRunning ())
+    return QString ();
+
+  ElementInfo* element = getElement (elementId);
+  if (!element)
+    return QString ();
+
+  std::map<std::string, ElementCopy>::const_iterator copy =
+      m_pCopyDetector->elements ().find (element->m_name);
+  if (copy == m_pCopyDetector->elements ().end ())
+    return QString ();
+
+  return CopyDetector::describe (copy->second);
+}
+
+void
+GraphDisplay::setCopyDetector (CopyDetector *detector)
+{
+  m_pCopyDetector = detector;
+}
+
+void
+GraphDisplay::setTimingAnalyzer (TimingAnalyzer *analyzer)
+{
+  m_pTimingAnalyzer = analyzer;
+}
+
+void
+GraphDisplay::setCopyCosts (const QHash<QString, double> &costs)
+{
+  if (costs == m_copyCosts)
+    return;
+
+  m_copyCosts = costs;
+  repaint ();
+}
+
+void
+GraphDisplay::setLinkProblems (const QHash<QString, int> &problems)
+{
+  if (problems == m_linkProblems)
+    return;
+
+  m_linkProblems = problems;
+  repaint ();
 }
 
 QPoint
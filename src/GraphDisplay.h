@@ -6,10 +6,19 @@
 #include <QWidget>
 #include <QSharedPointer>
 #include <QPoint>
-
+#include <QRect>
+#include <QLine>
+#include <QHash>
+#include <QStringList>
+
+#include "AllocationInspector.h"
+#include "CopyDetector.h"
+#include "TimingAnalyzer.h"
 #include "GraphManager.h"
 #include <vector>
 
+class QTimer;
+
 class GraphDisplay: public QWidget
 {
   Q_OBJECT
@@ -22,16 +31,37 @@ public:
   void mouseReleaseEvent(QMouseEvent *event);
   void mouseMoveEvent(QMouseEvent *event);
 
+  void mouseDoubleClickEvent(QMouseEvent *event);
+
   void keyPressEvent(QKeyEvent* event);
 
+  void getSceneItems(std::vector <QRect> &elements, std::vector <QLine> &connections);
+  /* element name to GST_LEVEL_ERROR or GST_LEVEL_WARNING */
+  void setBadges(const QHash<QString, int> &badges);
+  /* element name to the part of the buffers it dropped, from 0 to 1 */
+  void setDropRates(const QHash<QString, double> &rates);
+  /* the links are colored and described from its findings while it runs */
+  void setAllocationInspector(AllocationInspector *inspector);
+  /* "element:pad" of the source pad to a LinkAllocation::Problem */
+  void setLinkProblems(const QHash<QString, int> &problems);
+  /* the elements are described from its findings while it runs */
+  void setCopyDetector(CopyDetector *detector);
+  /* element name to the bytes per second it copies or allocates */
+  void setCopyCosts(const QHash<QString, double> &costs);
+  /* the pad properties show its findings while it runs */
+  void setTimingAnalyzer(TimingAnalyzer *analyzer);
+
   QSharedPointer<GraphManager> m_pGraph;
 
 private slots:
   void addRequestPad(int row, int collumn);
+  void pollSwap();
 
 signals:
   void signalAddPlugin();
   void signalClearGraph();
+  void signalRegionChanged(const QRect &rect);
+  void signalSelectionChanged(const QStringList &names);
 
 private:
 
@@ -67,6 +97,10 @@ private:
   void calculatePositions();
   void updateDisplayInfoIds();
   ElementDisplayInfo calculateOnePosition(const ElementInfo &info);
+  QSize getElementSize(const ElementInfo &info);
+  void updateBinRects();
+  bool isDescendant(std::size_t index, std::size_t ancestorId);
+  void toggleBin(std::size_t elementId);
   void showContextMenu(QMouseEvent *event);
   void showElementProperties(std::size_t id);
   void showPadProperties(std::size_t elementId, std::size_t padId);
@@ -75,8 +109,19 @@ private:
   void removeSelected();
   void getIdByPosition(const QPoint &pos, std::size_t &elementId, std::size_t &padId);
   QPoint getPadPosition(std::size_t elementId, std::size_t padId);
+  /* "element:pad" of the source pad of the link of the pad */
+  QString getLinkSource(std::size_t index, std::size_t padIndex);
+  bool getLinkByPosition(const QPoint &pos, std::size_t &elementId,
+      std::size_t &padId);
+  QString describeAllocation(std::size_t elementId, std::size_t padId);
+  QString describeCopies(std::size_t elementId);
+  QRect getElementRegion(std::size_t index);
   void disconnect(std::size_t elementId, std::size_t padId);
   void requestPad(std::size_t elementId);
+  QString choosePlugin(const QString &title);
+  void replaceElement(std::size_t elementId);
+  void insertElement(std::size_t elementId, std::size_t padId);
+  void showSwapReport(bool res, const SwapReport &report);
   void connectPlugin(std::size_t elementId, const QString& destElementName);
   void addPlugin();
   void clearGraph();
@@ -88,6 +133,15 @@ private:
   std::vector <ElementDisplayInfo> m_displayInfo;
 
   MoveInfo m_moveInfo;
+  QHash<QString, int> m_badges;
+  QHash<QString, double> m_dropRates;
+  AllocationInspector *m_pAllocationInspector;
+  QHash<QString, int> m_linkProblems;
+  CopyDetector *m_pCopyDetector;
+  QHash<QString, double> m_copyCosts;
+  TimingAnalyzer *m_pTimingAnalyzer;
+  /* while a live swap runs */
+  QTimer *m_pSwapTimer;
 };
 
 #endif
@@ -38,16 +38,181 @@ typefind_have_type_callback (GstElement * typefind, guint probability,
   thiz->Pause ();
 }
 
+static void
+pad_added_callback (GstElement *element, GstPad *pad, GraphManager *thiz)
+{
+  thiz->LinkPendingPads (element, pad);
+}
+
+/* "src_%u", "video_%02d" or "%s" against a pad name */
+static bool
+pad_name_matches (const char *templ, const char *name)
+{
+  while (*templ) {
+    if (*templ != '%') {
+      if (*templ++ != *name++)
+        return false;
+      continue;
+    }
+
+    templ++;
+    while (g_ascii_isdigit (*templ))
+      templ++;
+    char conversion = *templ;
+    if (!conversion)
+      return false;
+    templ++;
+
+    if (conversion == 's') {
+      if (!*name)
+        return false;
+      for (const char *rest = name + 1;; rest++) {
+        if (pad_name_matches (templ, rest))
+          return true;
+        if (!*rest)
+          return false;
+      }
+    }
+
+    if (conversion == 'd' && *name == '-')
+      name++;
+    if (!g_ascii_isdigit (*name))
+      return false;
+    while (g_ascii_isdigit (*name))
+      name++;
+  }
+
+  return *name == '\0';
+}
+
+/* whether a pad of that name may still be added by the element itself,
+ * request pads are requested before linking */
+static bool
+has_sometimes_template (GstElement *element, const char *pad)
+{
+  GList *templates = gst_element_class_get_pad_template_list (
+      GST_ELEMENT_GET_CLASS (element));
+
+  for (GList *l = templates; l != NULL; l = l->next) {
+    GstPadTemplate *templ = (GstPadTemplate *) l->data;
+    if (GST_PAD_TEMPLATE_PRESENCE (templ) == GST_PAD_SOMETIMES
+    && pad_name_matches (GST_PAD_TEMPLATE_NAME_TEMPLATE (templ), pad))
+      return true;
+  }
+
+  return false;
+}
+
+static bool
+link_pads (GstElement *element1, GstPad *pad1, GstElement *element2,
+           GstPad *pad2)
+{
+  gchar *padName1 = gst_pad_get_name (pad1);
+  gchar *padName2 = gst_pad_get_name (pad2);
+  bool res;
+
+  if (GST_PAD_IS_SRC (pad1))
+    res = gst_element_link_pads (element1, padName1, element2, padName2);
+  else
+    res = gst_element_link_pads (element2, padName2, element1, padName1);
+
+  if (!res)
+    GST_WARNING("Unable to link %s:%s with %s:%s", GST_OBJECT_NAME (element1),
+                padName1, GST_OBJECT_NAME (element2), padName2);
+
+  g_free (padName1);
+  g_free (padName2);
+  return res;
+}
+
+#define QOS_MAX_SAMPLES 512
+
+/* the element feeding the first sink pad, which gets the QoS events */
+static GstElement *
+get_upstream_element (GstElement *element)
+{
+  GstElement *upstream = NULL;
+  GstPad *pad = NULL;
+  GstIterator *iter = gst_element_iterate_sink_pads (element);
+#if GST_VERSION_MAJOR >= 1
+  GValue value = G_VALUE_INIT;
+  if (gst_iterator_next (iter, &value) == GST_ITERATOR_OK) {
+    pad = GST_PAD (gst_object_ref (g_value_get_object (&value)));
+    g_value_reset (&value);
+  }
+#else
+  if (gst_iterator_next (iter, (gpointer *) &pad) != GST_ITERATOR_OK)
+    pad = NULL;
+#endif
+  gst_iterator_free (iter);
+
+  if (!pad)
+    return NULL;
+
+  GstPad *peer = gst_pad_get_peer (pad);
+  if (peer) {
+    upstream = gst_pad_get_parent_element (peer);
+    gst_object_unref (peer);
+  }
+  gst_object_unref (pad);
+  return upstream;
+}
+
+/* the counters start again after a flush or going to READY */
+static guint64
+counter_delta (guint64 previous, guint64 current)
+{
+  return current >= previous ? current - previous : current;
+}
+
+static GstBusSyncReply
+bus_sync_handler (GstBus *bus, GstMessage *message, gpointer data)
+{
+  Q_UNUSED(bus);
+  GraphManager *thiz = (GraphManager *) data;
+  thiz->DispatchBusMessage (message);
+  return GST_BUS_DROP;
+}
+
 GraphManager::GraphManager ()
 {
   m_pGraph = gst_pipeline_new ("pipeline");
   GST_DEBUG_CATEGORY_INIT(pipeviz_debug, "pipeviz", 0, "Pipeline vizualizer");
 
+  g_mutex_init (&m_pendingLinksLock);
+  g_mutex_init (&m_busListenersLock);
+  g_mutex_init (&m_qosLock);
+  m_transactionDepth = 0;
+  m_latencyChanged = true;
+  m_pSwap = NULL;
+
+  GstBus *bus = gst_element_get_bus (m_pGraph);
+#if GST_VERSION_MAJOR >= 1
+  gst_bus_set_sync_handler (bus, bus_sync_handler, this, NULL);
+#else
+  gst_bus_set_sync_handler (bus, bus_sync_handler, this);
+#endif
+  gst_object_unref (bus);
+
   GST_WARNING("init");
 }
 
 GraphManager::~GraphManager ()
 {
+  cancelLiveSwap ();
+
+  ClearPendingLinks ();
+  g_mutex_clear (&m_pendingLinksLock);
+
+  GstBus *bus = gst_element_get_bus (m_pGraph);
+#if GST_VERSION_MAJOR >= 1
+  gst_bus_set_sync_handler (bus, NULL, NULL, NULL);
+#else
+  gst_bus_set_sync_handler (bus, NULL, NULL);
+#endif
+  gst_object_unref (bus);
+  g_mutex_clear (&m_busListenersLock);
+  g_mutex_clear (&m_qosLock);
 }
 
 QString
@@ -176,26 +341,84 @@ GraphManager::AddPlugin (const char *plugin, const char *name)
     }
   }
 
-  bool res = gst_bin_add (GST_BIN (m_pGraph), pel);
-  if (res)
-    gst_element_sync_state_with_parent (pel);
-  else {
-    gst_object_unref (pel);
+  gchar *name = gst_element_get_name (pel);
+
+  if (m_transactionDepth > 0) {
+    GraphOperation operation;
+    operation.m_type = GraphOperation::Add;
+    operation.m_pElement = pel;
+    m_transaction.push_back (operation);
+  }
+  else if (!addElement (pel)) {
+    g_free (name);
     return NULL;
   }
 
-  return gst_element_get_name (pel);
+  return name;
+}
+
+/* Takes the ownership of an element created by the caller. */
+bool
+GraphManager::AddElement (GstElement *element)
+{
+  if (m_transactionDepth > 0) {
+    GraphOperation operation;
+    operation.m_type = GraphOperation::Add;
+    operation.m_pElement = element;
+    m_transaction.push_back (operation);
+    return true;
+  }
+
+  return addElement (element);
+}
+
+bool
+GraphManager::addElement (GstElement *element)
+{
+  bool res = gst_bin_add (GST_BIN (m_pGraph), element);
+  if (res)
+    gst_element_sync_state_with_parent (element);
+  else
+    gst_object_unref (element);
+
+  return res;
 }
 
 bool
 GraphManager::RemovePlugin (const char *name)
+{
+  if (m_transactionDepth > 0) {
+    GstElement *element = gst_bin_get_by_name (GST_BIN (m_pGraph), name);
+    if (!element)
+      return false;
+    gst_object_unref (element);
+
+    GraphOperation operation;
+    operation.m_type = GraphOperation::Remove;
+    operation.m_pElement = NULL;
+    operation.m_element1 = name;
+    m_transaction.push_back (operation);
+    return true;
+  }
+
+  return removeElement (name);
+}
+
+bool
+GraphManager::removeElement (const char *name)
 {
   GstElement *element = gst_bin_get_by_name (GST_BIN (m_pGraph), name);
 
   if (!element)
     return false;
 
-  bool res = gst_bin_remove (GST_BIN (m_pGraph), element);
+  /* nested elements have to be removed from their own bin */
+  GstObject *parent = gst_object_get_parent (GST_OBJECT (element));
+  bool res = false;
+  if (parent) {
+    res = gst_bin_remove (GST_BIN (parent), element);
+    gst_object_unref (parent);
+  }
   gst_object_unref (element);
 
   return res;
@@ -223,6 +446,18 @@ bool
 GraphManager::Connect (const char *srcElement, const char *srcPad,
                        const char *dstElement, const char *dstPad)
 {
+  if (m_transactionDepth > 0) {
+    GraphOperation operation;
+    operation.m_type = GraphOperation::Link;
+    operation.m_pElement = NULL;
+    operation.m_element1 = srcElement;
+    operation.m_pad1 = srcPad;
+    operation.m_element2 = dstElement;
+    operation.m_pad2 = dstPad;
+    m_transaction.push_back (operation);
+    return true;
+  }
+
   GstElement *src = gst_bin_get_by_name (GST_BIN (m_pGraph), srcElement);
   GstElement *dst = gst_bin_get_by_name (GST_BIN (m_pGraph), dstElement);
 
@@ -262,10 +497,199 @@ GraphManager::Connect (const char *srcElement, const char *dstElement)
   return res;
 }
 
+bool
+GraphManager::ConnectWhenReady (const char *element1, const char *pad1,
+                                const char *element2, const char *pad2)
+{
+  GstElement *el1 = gst_bin_get_by_name (GST_BIN (m_pGraph), element1);
+  GstElement *el2 = gst_bin_get_by_name (GST_BIN (m_pGraph), element2);
+
+  if (!el1 || !el2) {
+    if (el1)
+      gst_object_unref (el1);
+    if (el2)
+      gst_object_unref (el2);
+    return false;
+  }
+
+  g_mutex_lock (&m_pendingLinksLock);
+
+  GstPad *srcPad1 = gst_element_get_static_pad (el1, pad1);
+  GstPad *srcPad2 = gst_element_get_static_pad (el2, pad2);
+
+  /* Sometimes pads are linked from pad-added as soon as they appear. The
+   * lock is held across the check so that a pad added meanwhile waits for
+   * its pending link to be registered. */
+  /* a pending link on any other name would wait for ever */
+  bool valid1 = srcPad1 || has_sometimes_template (el1, pad1);
+  bool valid2 = srcPad2 || has_sometimes_template (el2, pad2);
+
+  if (srcPad1 && srcPad2)
+    link_pads (el1, srcPad1, el2, srcPad2);
+  else if (!valid1 || !valid2)
+    LOG_WARNING("Not linking `%s:%s` to `%s:%s`, `%s:%s` does not exist and no sometimes pad template matches it", element1, pad1, element2, pad2, valid1 ? element2 : element1, valid1 ? pad2 : pad1);
+  else {
+    if (!srcPad1)
+      addPendingLink (el1, pad1, element2, pad2);
+    if (!srcPad2)
+      addPendingLink (el2, pad2, element1, pad1);
+  }
+
+  g_mutex_unlock (&m_pendingLinksLock);
+
+  if (srcPad1)
+    gst_object_unref (srcPad1);
+  if (srcPad2)
+    gst_object_unref (srcPad2);
+  gst_object_unref (el1);
+  gst_object_unref (el2);
+
+  return true;
+}
+
+void
+GraphManager::addPendingLink (GstElement *element, const char *pad,
+                              const char *peerElement, const char *peerPad)
+{
+  gchar *name = gst_element_get_name (element);
+  std::vector<PendingLink> &links = m_pendingLinks[name];
+  g_free (name);
+
+  if (links.empty ())
+    g_signal_connect (element, "pad-added", G_CALLBACK (pad_added_callback),
+                      this);
+
+  PendingLink link;
+  link.m_pad = pad;
+  link.m_peerElement = peerElement;
+  link.m_peerPad = peerPad;
+  links.push_back (link);
+}
+
+void
+GraphManager::removePendingLink (const std::string &element,
+                                 const std::string &pad,
+                                 const std::string &peerElement,
+                                 const std::string &peerPad)
+{
+  std::map<std::string, std::vector<PendingLink> >::iterator itr =
+  m_pendingLinks.find (element);
+  if (itr == m_pendingLinks.end ())
+    return;
+
+  std::vector<PendingLink> &links = itr->second;
+  for (std::size_t i = 0; i < links.size (); i++) {
+    if (links[i].m_pad == pad && links[i].m_peerElement == peerElement
+    && links[i].m_peerPad == peerPad) {
+      links.erase (links.begin () + i);
+      break;
+    }
+  }
+
+  if (links.empty ()) {
+    GstElement *el = gst_bin_get_by_name (GST_BIN (m_pGraph), element.c_str ());
+    if (el) {
+      g_signal_handlers_disconnect_by_func (el, (gpointer) pad_added_callback,
+                                            this);
+      gst_object_unref (el);
+    }
+    m_pendingLinks.erase (itr);
+  }
+}
+
+void
+GraphManager::LinkPendingPads (GstElement *element, GstPad *pad)
+{
+  gchar *name = gst_element_get_name (element);
+  gchar *padName = gst_pad_get_name (pad);
+  std::string elementName = name;
+  std::string elementPad = padName;
+  g_free (name);
+  g_free (padName);
+
+  g_mutex_lock (&m_pendingLinksLock);
+
+  std::map<std::string, std::vector<PendingLink> >::iterator itr =
+  m_pendingLinks.find (elementName);
+
+  std::vector<PendingLink> ready;
+  if (itr != m_pendingLinks.end ()) {
+    for (std::size_t i = 0; i < itr->second.size (); i++) {
+      if (itr->second[i].m_pad == elementPad)
+        ready.push_back (itr->second[i]);
+    }
+  }
+
+  for (std::size_t i = 0; i < ready.size (); i++) {
+    GstElement *peer = gst_bin_get_by_name (GST_BIN (m_pGraph),
+                                            ready[i].m_peerElement.c_str ());
+    GstPad *peerPad = NULL;
+    if (peer)
+      peerPad = gst_element_get_static_pad (peer, ready[i].m_peerPad.c_str ());
+
+    /* otherwise the link is made when the peer pad shows up */
+    if (peerPad) {
+      link_pads (element, pad, peer, peerPad);
+      removePendingLink (elementName, elementPad, ready[i].m_peerElement,
+                         ready[i].m_peerPad);
+      removePendingLink (ready[i].m_peerElement, ready[i].m_peerPad,
+                         elementName, elementPad);
+      gst_object_unref (peerPad);
+    }
+
+    if (peer)
+      gst_object_unref (peer);
+  }
+
+  g_mutex_unlock (&m_pendingLinksLock);
+}
+
+bool
+GraphManager::HasPendingLinks ()
+{
+  g_mutex_lock (&m_pendingLinksLock);
+  bool res = !m_pendingLinks.empty ();
+  g_mutex_unlock (&m_pendingLinksLock);
+
+  return res;
+}
+
+void
+GraphManager::ClearPendingLinks ()
+{
+  g_mutex_lock (&m_pendingLinksLock);
+
+  std::map<std::string, std::vector<PendingLink> >::iterator itr;
+  for (itr = m_pendingLinks.begin (); itr != m_pendingLinks.end (); itr++) {
+    GstElement *el = gst_bin_get_by_name (GST_BIN (m_pGraph),
+                                          itr->first.c_str ());
+    if (el) {
+      g_signal_handlers_disconnect_by_func (el, (gpointer) pad_added_callback,
+                                            this);
+      gst_object_unref (el);
+    }
+  }
+  m_pendingLinks.clear ();
+
+  g_mutex_unlock (&m_pendingLinksLock);
+}
+
 bool
 GraphManager::Disconnect (const char *srcElement, const char *srcPad,
                           const char *dstElement, const char *dstPad)
 {
+  if (m_transactionDepth > 0) {
+    GraphOperation operation;
+    operation.m_type = GraphOperation::Unlink;
+    operation.m_pElement = NULL;
+    operation.m_element1 = srcElement;
+    operation.m_pad1 = srcPad;
+    operation.m_element2 = dstElement;
+    operation.m_pad2 = dstPad;
+    m_transaction.push_back (operation);
+    return true;
+  }
+
   GstElement *src = gst_bin_get_by_name (GST_BIN (m_pGraph), srcElement);
   GstElement *dst = gst_bin_get_by_name (GST_BIN (m_pGraph), dstElement);
 
@@ -277,16 +701,45 @@ GraphManager::Disconnect (const char *srcElement, const char *srcPad,
   return true;
 }
 
-std::vector<ElementInfo>
-GraphManager::GetInfo ()
+namespace
 {
-  std::vector<ElementInfo> res;
+  struct PadRef
+  {
+    std::size_t m_elementIndex;
+    std::size_t m_padIndex;
+  };
+
+  typedef std::map<const GstPad *, PadRef> PadRefMap;
+  typedef std::vector<std::pair<PadRef, const GstPad *> > PeerList;
+}
+
+/* Pads linked from inside a bin are linked to the internal proxy pad of a
+ * ghost pad, report them as linked to the ghost pad itself. */
+static const GstPad *
+get_peer_key (GstPad *peerPad)
+{
+  const GstPad *key = peerPad;
+  GstObject *parent = gst_object_get_parent (GST_OBJECT (peerPad));
+
+  if (parent) {
+    if (GST_IS_GHOST_PAD (parent))
+      key = GST_PAD (parent);
+    gst_object_unref (parent);
+  }
 
+  return key;
+}
+
+static void
+collect_elements (GstBin *bin, std::size_t parentId,
+                  const std::set<std::string> &expandedBins,
+                  std::vector<ElementInfo> &res, PadRefMap &padRefs,
+                  PeerList &peers)
+{
   GstIterator *iter;
-  iter = gst_bin_iterate_elements (GST_BIN (m_pGraph));
+  iter = gst_bin_iterate_elements (bin);
   GstElement* element = NULL;
   bool done = false;
-  size_t id = 0;
   while (!done) {
 #if GST_VERSION_MAJOR >= 1
     GValue value = G_VALUE_INIT;
@@ -300,21 +753,32 @@ GraphManager::GetInfo ()
       case GST_ITERATOR_OK: {
 #endif
         ElementInfo elementInfo;
-        elementInfo.m_id = id;
-        id++;
+        elementInfo.m_id = res.size ();
+        elementInfo.m_parentId = parentId;
 
         gchar *name = gst_element_get_name (element);
         elementInfo.m_name = name;
         g_free (name);
 
         GstElementFactory *pfactory = gst_element_get_factory (element);
-
-        elementInfo.m_pluginName = gst_plugin_feature_get_name (
-        GST_PLUGIN_FEATURE (pfactory));
+        if (pfactory)
+          elementInfo.m_pluginName = gst_plugin_feature_get_name (
+          GST_PLUGIN_FEATURE (pfactory));
+        else
+          elementInfo.m_pluginName = G_OBJECT_TYPE_NAME (element);
+
+        elementInfo.m_isBin = GST_IS_BIN (element);
+        elementInfo.m_isExpanded = elementInfo.m_isBin
+        && expandedBins.count (elementInfo.m_name);
+        elementInfo.m_childCount = 0;
+        if (elementInfo.m_isBin) {
+          GST_OBJECT_LOCK (element);
+          elementInfo.m_childCount = GST_BIN_NUMCHILDREN (element);
+          GST_OBJECT_UNLOCK (element);
+        }
 
         GstIterator *padItr = gst_element_iterate_pads (element);
         bool padDone = FALSE;
-        std::size_t padId = 0;
         GstPad *pad;
         while (!padDone) {
 #if GST_VERSION_MAJOR >= 1
@@ -329,7 +793,7 @@ GraphManager::GetInfo ()
             case GST_ITERATOR_OK: {
 #endif
               PadInfo padInfo;
-              padInfo.m_id = padId;
+              padInfo.m_id = elementInfo.m_pads.size ();
 
               gchar *pad_name = gst_pad_get_name (pad);
               padInfo.m_name = pad_name;
@@ -343,6 +807,17 @@ GraphManager::GetInfo ()
               else
                 padInfo.m_type = PadInfo::None;
 
+              PadRef ref;
+              ref.m_elementIndex = res.size ();
+              ref.m_padIndex = elementInfo.m_pads.size ();
+              padRefs[pad] = ref;
+
+              GstPad *peerPad = gst_pad_get_peer (pad);
+              if (peerPad) {
+                peers.push_back (std::make_pair (ref, get_peer_key (peerPad)));
+                gst_object_unref (peerPad);
+              }
+
               elementInfo.m_pads.push_back (padInfo);
 #if GST_VERSION_MAJOR >= 1
               g_value_reset (&padVal);
@@ -355,12 +830,18 @@ GraphManager::GetInfo ()
               padDone = TRUE;
               break;
           };
-          padId++;
         }
+        gst_iterator_free (padItr);
+
+        res.push_back (elementInfo);
+
+        /* Collapsed bins are only summarized by their children count */
+        if (elementInfo.m_isExpanded)
+          collect_elements (GST_BIN (element), elementInfo.m_id, expandedBins,
+                            res, padRefs, peers);
 #if GST_VERSION_MAJOR >= 1
         g_value_reset (&value);
 #endif
-        res.push_back (elementInfo);
         break;
       }
       case GST_ITERATOR_DONE:
@@ -373,55 +854,729 @@ GraphManager::GetInfo ()
   }
 
   gst_iterator_free (iter);
+}
+
+std::vector<ElementInfo>
+GraphManager::GetInfo ()
+{
+  std::vector<ElementInfo> res;
+  PadRefMap padRefs;
+  PeerList peers;
+
+  collect_elements (GST_BIN (m_pGraph), -1, m_expandedBins, res, padRefs,
+                    peers);
 
   for (std::size_t i = 0; i < res.size (); i++) {
     res[i].m_connections.resize (res[i].m_pads.size ());
 
-    GstElement *element = gst_bin_get_by_name (GST_BIN (m_pGraph),
-                                               res[i].m_name.c_str ());
-
     for (std::size_t j = 0; j < res[i].m_pads.size (); j++) {
       res[i].m_connections[j].m_elementId = -1;
       res[i].m_connections[j].m_padId = -1;
+    }
+  }
 
-      GstPad *pad = gst_element_get_static_pad (
-      element, res[i].m_pads[j].m_name.c_str ());
-      GstPad *peerPad = gst_pad_get_peer (pad);
+  for (std::size_t i = 0; i < peers.size (); i++) {
+    PadRefMap::const_iterator peer = padRefs.find (peers[i].second);
+    if (peer == padRefs.end ())
+      continue;
 
-      if (peerPad) {
-        GstElement *peerElement = GST_ELEMENT (gst_pad_get_parent (peerPad));
+    const PadRef &ref = peers[i].first;
+    const ElementInfo &peerElement = res[peer->second.m_elementIndex];
 
-        gchar *peerName = gst_element_get_name (peerElement);
-        gchar *peerPadName = gst_pad_get_name (peerPad);
+    res[ref.m_elementIndex].m_connections[ref.m_padIndex].m_elementId =
+    peerElement.m_id;
+    res[ref.m_elementIndex].m_connections[ref.m_padIndex].m_padId =
+    peerElement.m_pads[peer->second.m_padIndex].m_id;
+  }
 
-        for (std::size_t k = 0; k < res.size (); k++) {
-          if (res[k].m_name == peerName) {
-            for (std::size_t l = 0; l < res[k].m_pads.size (); l++) {
-              if (res[k].m_pads[l].m_name == peerPadName) {
-                res[i].m_connections[j].m_elementId = res[k].m_id;
-                res[i].m_connections[j].m_padId = res[k].m_pads[l].m_id;
-                break;
-              }
-            }
-          }
-        }
+  return res;
+}
+
+void
+GraphManager::BeginTransaction ()
+{
+  m_transactionDepth++;
+}
+
+bool
+GraphManager::CommitTransaction ()
+{
+  if (m_transactionDepth == 0 || --m_transactionDepth > 0)
+    return true;
+
+  std::vector<GraphOperation> operations;
+  operations.swap (m_transaction);
+
+  bool res = true;
+  bool linked = false;
+  for (std::size_t i = 0; i < operations.size (); i++) {
+    if (!applyOperation (operations[i])) {
+      GST_WARNING("operation %d on `%s` was FAILED", operations[i].m_type,
+                  operations[i].m_element1.c_str ());
+      res = false;
+    }
+    else if (operations[i].m_type == GraphOperation::Link)
+      linked = true;
+  }
+
+  /* a single flush for all the links of the transaction */
+  if (linked)
+    gst_element_seek_simple (m_pGraph, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH, 0);
+
+  return res;
+}
+
+bool
+GraphManager::applyOperation (const GraphOperation &operation)
+{
+  if (operation.m_type == GraphOperation::Add)
+    return addElement (operation.m_pElement);
+
+  if (operation.m_type == GraphOperation::Remove)
+    return removeElement (operation.m_element1.c_str ());
+
+  GstElement *src = gst_bin_get_by_name (GST_BIN (m_pGraph),
+                                         operation.m_element1.c_str ());
+  GstElement *dst = gst_bin_get_by_name (GST_BIN (m_pGraph),
+                                         operation.m_element2.c_str ());
+  bool res = false;
+
+  if (src && dst) {
+    if (operation.m_type == GraphOperation::Link)
+      res = gst_element_link_pads (src, operation.m_pad1.c_str (), dst,
+                                   operation.m_pad2.c_str ());
+    else {
+      gst_element_unlink_pads (src, operation.m_pad1.c_str (), dst,
+                               operation.m_pad2.c_str ());
+      res = true;
+    }
+  }
+
+  if (src)
+    gst_object_unref (src);
+  if (dst)
+    gst_object_unref (dst);
+
+  return res;
+}
+
+bool
+GraphManager::Clear ()
+{
+  ClearPendingLinks ();
+  ResetQos ();
+
+  /* collect the children with a single iterator, then remove them */
+  std::vector<GstElement *> elements;
+  GstIterator *iter = gst_bin_iterate_elements (GST_BIN (m_pGraph));
+  bool done = false;
+  while (!done) {
+#if GST_VERSION_MAJOR >= 1
+    GValue value = G_VALUE_INIT;
+    switch (gst_iterator_next (iter, &value)) {
+      case GST_ITERATOR_OK:
+        elements.push_back (
+        GST_ELEMENT (gst_object_ref (g_value_get_object (&value))));
+        g_value_reset (&value);
+        break;
+#else
+    GstElement *element = NULL;
+    switch (gst_iterator_next (iter, (gpointer *) &element)) {
+      case GST_ITERATOR_OK:
+        elements.push_back (element);
+        break;
+#endif
+      case GST_ITERATOR_RESYNC:
+        for (std::size_t i = 0; i < elements.size (); i++)
+          gst_object_unref (elements[i]);
+        elements.clear ();
+        gst_iterator_resync (iter);
+        break;
+      case GST_ITERATOR_DONE:
+      case GST_ITERATOR_ERROR:
+        done = true;
+        break;
+    };
+  }
+  gst_iterator_free (iter);
+
+  bool res = true;
+  for (std::size_t i = 0; i < elements.size (); i++) {
+    if (!gst_bin_remove (GST_BIN (m_pGraph), elements[i]))
+      res = false;
+    gst_object_unref (elements[i]);
+  }
+
+  return res;
+}
+
+#define LIVE_SWAP_TIMEOUT (5 * G_TIME_SPAN_SECOND)
+
+/* Shared between the caller and the streaming threads running the
+ * probes, every installed probe holds a reference. */
+struct LiveSwap
+{
+  gint          m_refCount;
+  GMutex        m_lock;
+
+  GstElement   *m_pBin;
+  /* NULL when a new element is inserted into a link */
+  GstElement   *m_pOld;
+  GstElement   *m_pNew;
+  /* upstream and downstream pads which are kept */
+  GstPad       *m_pSrcPad;
+  GstPad       *m_pSinkPad;
+  /* 0 once removed */
+  gulong        m_blockId;
+  gint64        m_deadline;
+
+  gint64        m_blockTime;
+  gint64        m_resumeTime;
+  GstClockTime  m_lastPts;
+  GstClockTime  m_lastDuration;
+  GstClockTime  m_firstPts;
+
+  bool          m_cancelled;
+  /* taken by the thread which changes the links */
+  bool          m_relinking;
+  bool          m_swapped;
+  bool          m_resumed;
+  bool          m_drained;
+  std::string   m_error;
+};
+
+static LiveSwap *
+live_swap_ref (LiveSwap *swap)
+{
+  g_atomic_int_inc (&swap->m_refCount);
+  return swap;
+}
+
+static void
+live_swap_unref (gpointer data)
+{
+  LiveSwap *swap = (LiveSwap *) data;
+  if (!g_atomic_int_dec_and_test (&swap->m_refCount))
+    return;
+
+  if (swap->m_pOld)
+    gst_object_unref (swap->m_pOld);
+  gst_object_unref (swap->m_pNew);
+  gst_object_unref (swap->m_pSrcPad);
+  gst_object_unref (swap->m_pSinkPad);
+  gst_object_unref (swap->m_pBin);
+
+  g_mutex_clear (&swap->m_lock);
+  delete swap;
+}
+
+/* Only one thread changes the links, and none once cancelled. */
+static bool
+live_swap_claim (LiveSwap *swap)
+{
+  g_mutex_lock (&swap->m_lock);
+  bool res = !swap->m_cancelled && !swap->m_relinking;
+  swap->m_relinking = true;
+  g_mutex_unlock (&swap->m_lock);
+  return res;
+}
+
+static void
+live_swap_unblock (LiveSwap *swap)
+{
+  g_mutex_lock (&swap->m_lock);
+  if (swap->m_blockId)
+    gst_pad_remove_probe (swap->m_pSrcPad, swap->m_blockId);
+  swap->m_blockId = 0;
+  g_mutex_unlock (&swap->m_lock);
+}
+
+/* Unlinks the old element or the link and puts the new element in its
+ * place. The old element is shut down later by the caller, it may be
+ * running this very thread. */
+static bool
+live_swap_relink (LiveSwap *swap, std::string &error)
+{
+  if (swap->m_pOld) {
+    GstPad *oldSink = gst_pad_get_peer (swap->m_pSrcPad);
+    GstPad *oldSrc = gst_pad_get_peer (swap->m_pSinkPad);
+    if (oldSink) {
+      gst_pad_unlink (swap->m_pSrcPad, oldSink);
+      gst_object_unref (oldSink);
+    }
+    if (oldSrc) {
+      gst_pad_unlink (oldSrc, swap->m_pSinkPad);
+      gst_object_unref (oldSrc);
+    }
+  }
+  else
+    gst_pad_unlink (swap->m_pSrcPad, swap->m_pSinkPad);
+
+  if (!gst_bin_add (GST_BIN (swap->m_pBin), swap->m_pNew)) {
+    error = "Could not add the new element to the pipeline";
+    return false;
+  }
+
+  GstPad *newSink = gst_element_get_compatible_pad (swap->m_pNew,
+                                                    swap->m_pSrcPad, NULL);
+  GstPad *newSrc = gst_element_get_compatible_pad (swap->m_pNew,
+                                                   swap->m_pSinkPad, NULL);
+
+  bool res = newSink && newSrc
+  && GST_PAD_LINK_SUCCESSFUL (gst_pad_link (swap->m_pSrcPad, newSink))
+  && GST_PAD_LINK_SUCCESSFUL (gst_pad_link (newSrc, swap->m_pSinkPad));
+
+  if (newSink)
+    gst_object_unref (newSink);
+  if (newSrc)
+    gst_object_unref (newSrc);
+
+  if (!res)
+    error = "Could not link the new element";
+
+  gst_element_sync_state_with_parent (swap->m_pNew);
+  return res;
+}
+
+static void
+live_swap_finish (LiveSwap *swap, bool res, const std::string &error)
+{
+  g_mutex_lock (&swap->m_lock);
+  swap->m_swapped = true;
+  if (!res)
+    swap->m_error = error;
+  g_mutex_unlock (&swap->m_lock);
+}
+
+/* Watches the downstream pad: the timestamps before the swap and the
+ * first buffer after it give the glitch and the dropped buffers. */
+static GstPadProbeReturn
+live_swap_track_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+  Q_UNUSED(pad);
+  LiveSwap *swap = (LiveSwap *) data;
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstPadProbeReturn res = GST_PAD_PROBE_OK;
+
+  g_mutex_lock (&swap->m_lock);
+  if (swap->m_cancelled)
+    res = GST_PAD_PROBE_REMOVE;
+  else if (!swap->m_swapped) {
+    swap->m_lastPts = GST_BUFFER_PTS (buffer);
+    swap->m_lastDuration = GST_BUFFER_DURATION (buffer);
+  }
+  else {
+    swap->m_firstPts = GST_BUFFER_PTS (buffer);
+    swap->m_resumeTime = g_get_monotonic_time ();
+    swap->m_resumed = true;
+    res = GST_PAD_PROBE_REMOVE;
+  }
+  g_mutex_unlock (&swap->m_lock);
+
+  return res;
+}
+
+/* The EOS sent into the old element has come out, so everything it held
+ * has been pushed downstream. */
+static GstPadProbeReturn
+live_swap_eos_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+  Q_UNUSED(pad);
+  LiveSwap *swap = (LiveSwap *) data;
 
-        g_free (peerName);
-        g_free (peerPadName);
+  if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) != GST_EVENT_EOS)
+    return GST_PAD_PROBE_PASS;
+
+  /* too late, the caller gave up draining */
+  if (!live_swap_claim (swap))
+    return GST_PAD_PROBE_DROP;
+
+  std::string error;
+  bool res = live_swap_relink (swap, error);
+  live_swap_unblock (swap);
+  live_swap_finish (swap, res, error);
+
+  return GST_PAD_PROBE_DROP;
+}
 
-        gst_object_unref (peerPad);
-        gst_object_unref (peerElement);
+static GstPadProbeReturn
+live_swap_block_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+  Q_UNUSED(info);
+  LiveSwap *swap = (LiveSwap *) data;
+
+  g_mutex_lock (&swap->m_lock);
+  if (swap->m_cancelled) {
+    g_mutex_unlock (&swap->m_lock);
+    return GST_PAD_PROBE_REMOVE;
+  }
+  /* stays blocked until the old element is drained */
+  if (swap->m_blockTime) {
+    g_mutex_unlock (&swap->m_lock);
+    return GST_PAD_PROBE_OK;
+  }
+  swap->m_blockTime = g_get_monotonic_time ();
+  g_mutex_unlock (&swap->m_lock);
+
+  GstPad *oldSrc = gst_pad_get_peer (swap->m_pSinkPad);
+  GstPad *oldSink = gst_pad_get_peer (pad);
+
+  if (oldSrc && oldSink) {
+    gst_pad_add_probe (oldSrc, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                       live_swap_eos_probe, live_swap_ref (swap),
+                       live_swap_unref);
+    gst_pad_send_event (oldSink, gst_event_new_eos ());
+  }
+  else {
+    live_swap_unblock (swap);
+    live_swap_finish (swap, false, "The element was unlinked meanwhile");
+  }
+
+  if (oldSrc)
+    gst_object_unref (oldSrc);
+  if (oldSink)
+    gst_object_unref (oldSink);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Nothing has to be drained for an insertion, the link is only changed
+ * while no data passes it. */
+static GstPadProbeReturn
+live_swap_idle_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+  Q_UNUSED(pad);
+  Q_UNUSED(info);
+  LiveSwap *swap = (LiveSwap *) data;
+
+  if (live_swap_claim (swap)) {
+    g_mutex_lock (&swap->m_lock);
+    swap->m_blockTime = g_get_monotonic_time ();
+    g_mutex_unlock (&swap->m_lock);
+
+    std::string error;
+    bool res = live_swap_relink (swap, error);
+    live_swap_finish (swap, res, error);
+  }
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+/* Returns the peer of the only linked pad of the given direction. */
+static GstPad *
+get_single_peer (GstElement *element, GstPadDirection direction)
+{
+  GstPad *res = NULL;
+  bool single = true;
+
+  GstIterator *iter = (direction == GST_PAD_SRC) ?
+  gst_element_iterate_src_pads (element) :
+  gst_element_iterate_sink_pads (element);
+
+  GValue value = G_VALUE_INIT;
+  while (gst_iterator_next (iter, &value) == GST_ITERATOR_OK) {
+    GstPad *peer = gst_pad_get_peer (GST_PAD (g_value_get_object (&value)));
+    if (peer) {
+      if (res) {
+        single = false;
+        gst_object_unref (peer);
       }
+      else
+        res = peer;
+    }
+    g_value_reset (&value);
+  }
+  g_value_unset (&value);
+  gst_iterator_free (iter);
 
-      gst_object_unref (pad);
+  if (res && !single) {
+    gst_object_unref (res);
+    res = NULL;
+  }
+
+  return res;
+}
+
+bool
+GraphManager::runLiveSwap (GstElement *oldElement, GstPad *srcPad,
+                           GstPad *sinkPad, const char *plugin,
+                           SwapReport &report)
+{
+  if (m_pSwap) {
+    report.m_error = "Another live reconfiguration is still running";
+    return false;
+  }
+
+  GstState state;
+  gst_element_get_state (m_pGraph, &state, NULL, 0);
+
+  if (state == GST_STATE_PAUSED) {
+    report.m_error = "The pipeline is paused, play or stop it first";
+    return false;
+  }
+
+  GstElement *newElement = gst_element_factory_make (plugin, NULL);
+  if (!newElement) {
+    report.m_error = std::string ("Could not create element of `") + plugin
+    + "`";
+    return false;
+  }
+
+  LiveSwap *swap = new LiveSwap;
+  swap->m_refCount = 1;
+  g_mutex_init (&swap->m_lock);
+  swap->m_pBin = GST_ELEMENT (gst_object_ref (m_pGraph));
+  swap->m_pOld = oldElement ?
+  GST_ELEMENT (gst_object_ref (oldElement)) : NULL;
+  swap->m_pNew = GST_ELEMENT (gst_object_ref_sink (newElement));
+  swap->m_pSrcPad = GST_PAD (gst_object_ref (srcPad));
+  swap->m_pSinkPad = GST_PAD (gst_object_ref (sinkPad));
+  swap->m_blockId = 0;
+  swap->m_deadline = g_get_monotonic_time () + LIVE_SWAP_TIMEOUT;
+  swap->m_blockTime = 0;
+  swap->m_resumeTime = 0;
+  swap->m_lastPts = GST_CLOCK_TIME_NONE;
+  swap->m_lastDuration = GST_CLOCK_TIME_NONE;
+  swap->m_firstPts = GST_CLOCK_TIME_NONE;
+  swap->m_cancelled = false;
+  swap->m_relinking = false;
+  swap->m_swapped = false;
+  swap->m_resumed = false;
+  swap->m_drained = true;
+
+  if (state != GST_STATE_PLAYING) {
+    /* no data flows, the graph is simply edited */
+    swap->m_relinking = true;
+    std::string error;
+    bool res = live_swap_relink (swap, error);
+    live_swap_finish (swap, res, error);
+    report.m_glitch = 0;
+    return endLiveSwap (swap, report);
+  }
+
+  gst_pad_add_probe (sinkPad, GST_PAD_PROBE_TYPE_BUFFER,
+                     live_swap_track_probe, live_swap_ref (swap),
+                     live_swap_unref);
+
+  if (oldElement) {
+    /* the lock makes the probe wait until its id is known */
+    g_mutex_lock (&swap->m_lock);
+    swap->m_blockId = gst_pad_add_probe (srcPad,
+                                         GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM,
+                                         live_swap_block_probe,
+                                         live_swap_ref (swap),
+                                         live_swap_unref);
+    g_mutex_unlock (&swap->m_lock);
+  }
+  else
+    gst_pad_add_probe (srcPad, GST_PAD_PROBE_TYPE_IDLE, live_swap_idle_probe,
+                       live_swap_ref (swap), live_swap_unref);
+
+  /* the streaming threads go on with it, see PollSwap */
+  m_pSwap = swap;
+  report.m_pending = true;
+  return true;
+}
+
+bool
+GraphManager::PollSwap (bool &res, SwapReport &report)
+{
+  LiveSwap *swap = m_pSwap;
+  if (!swap) {
+    report.m_error = "No live reconfiguration is running";
+    res = false;
+    return true;
+  }
+
+  /* wait for the first buffer after the swap, unless the swap failed */
+  g_mutex_lock (&swap->m_lock);
+  bool done = swap->m_resumed || (swap->m_swapped && !swap->m_error.empty ());
+  if (!done && (g_get_monotonic_time () < swap->m_deadline
+                || (swap->m_relinking && !swap->m_swapped))) {
+    /* a streaming thread may be changing the links right now */
+    g_mutex_unlock (&swap->m_lock);
+    return false;
+  }
+
+  bool relink = false;
+  if (!swap->m_swapped) {
+    if (swap->m_blockTime) {
+      /* the old element holds on to its data, drop it; upstream stays
+       * blocked until the new element is linked */
+      swap->m_relinking = true;
+      swap->m_drained = false;
+      relink = true;
     }
-    gst_object_unref (element);
+    else {
+      /* nothing was changed, let the data through again */
+      swap->m_cancelled = true;
+      if (swap->m_blockId)
+        gst_pad_remove_probe (swap->m_pSrcPad, swap->m_blockId);
+      swap->m_blockId = 0;
+      report.m_error = "Timed out waiting for data, is the pipeline running?";
+    }
+  }
+  g_mutex_unlock (&swap->m_lock);
+
+  if (relink) {
+    std::string error;
+    bool relinked = live_swap_relink (swap, error);
+    live_swap_unblock (swap);
+    live_swap_finish (swap, relinked, error);
+  }
+
+  res = endLiveSwap (swap, report);
+  m_pSwap = NULL;
+  return true;
+}
+
+/* Fills the report, removes the old element once swapped and drops the
+ * reference of the caller. */
+bool
+GraphManager::endLiveSwap (LiveSwap *swap, SwapReport &report)
+{
+  g_mutex_lock (&swap->m_lock);
+  bool swapped = swap->m_swapped;
+  bool res = swapped && swap->m_error.empty ();
+  if (swapped)
+    report.m_error = swap->m_error;
+  report.m_drained = swap->m_drained;
+
+  if (swap->m_resumed) {
+    report.m_glitch = swap->m_resumeTime - swap->m_blockTime;
+
+    if (GST_CLOCK_TIME_IS_VALID (swap->m_lastPts)
+    && GST_CLOCK_TIME_IS_VALID (swap->m_lastDuration)
+    && GST_CLOCK_TIME_IS_VALID (swap->m_firstPts)
+    && swap->m_lastDuration > 0
+    && swap->m_firstPts > swap->m_lastPts + swap->m_lastDuration)
+      report.m_droppedBuffers = (swap->m_firstPts - swap->m_lastPts
+      - swap->m_lastDuration) / swap->m_lastDuration;
+  }
+  else if (swapped)
+    /* no data after the swap yet, stop waiting for it */
+    swap->m_cancelled = true;
+  g_mutex_unlock (&swap->m_lock);
+
+  if (swap->m_pOld && swapped) {
+    gst_element_set_state (swap->m_pOld, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (m_pGraph), swap->m_pOld);
+  }
+
+  if (res) {
+    gchar *newName = gst_element_get_name (swap->m_pNew);
+    LOG_INFO("%s `%s` in %lld us, about %llu buffers dropped", swap->m_pOld ? "swapped in" : "inserted", newName, (long long) report.m_glitch, (unsigned long long) report.m_droppedBuffers);
+    g_free (newName);
+  }
+  if (!swap->m_drained)
+    LOG_INFO("the old element was not drained in time, the data it held was dropped");
+
+  live_swap_unref (swap);
+  return res;
+}
+
+/* The probes still running see it cancelled and leave the links alone. */
+void
+GraphManager::cancelLiveSwap ()
+{
+  if (!m_pSwap)
+    return;
+
+  g_mutex_lock (&m_pSwap->m_lock);
+  m_pSwap->m_cancelled = true;
+  if (m_pSwap->m_blockId)
+    gst_pad_remove_probe (m_pSwap->m_pSrcPad, m_pSwap->m_blockId);
+  m_pSwap->m_blockId = 0;
+  g_mutex_unlock (&m_pSwap->m_lock);
+
+  live_swap_unref (m_pSwap);
+  m_pSwap = NULL;
+}
+
+bool
+GraphManager::ReplaceElement (const char *name, const char *plugin,
+                              SwapReport &report)
+{
+  GstElement *element = gst_bin_get_by_name (GST_BIN (m_pGraph), name);
+  if (!element) {
+    report.m_error = std::string ("No element `") + name + "`";
+    return false;
+  }
+
+  GstPad *srcPad = get_single_peer (element, GST_PAD_SINK);
+  GstPad *sinkPad = get_single_peer (element, GST_PAD_SRC);
+
+  bool res = false;
+  if (srcPad && sinkPad)
+    res = runLiveSwap (element, srcPad, sinkPad, plugin, report);
+  else
+    report.m_error = "Only elements with one linked input and one linked "
+    "output can be replaced";
+
+  if (srcPad)
+    gst_object_unref (srcPad);
+  if (sinkPad)
+    gst_object_unref (sinkPad);
+  gst_object_unref (element);
+
+  return res;
+}
 
+bool
+GraphManager::InsertElement (const char *srcElement, const char *srcPad,
+                             const char *plugin, SwapReport &report)
+{
+  GstElement *element = gst_bin_get_by_name (GST_BIN (m_pGraph), srcElement);
+  if (!element) {
+    report.m_error = std::string ("No element `") + srcElement + "`";
+    return false;
   }
 
+  GstPad *pad = gst_element_get_static_pad (element, srcPad);
+  GstPad *peer = pad ? gst_pad_get_peer (pad) : NULL;
+
+  bool res = false;
+  if (peer)
+    res = runLiveSwap (NULL, pad, peer, plugin, report);
+  else
+    report.m_error = std::string ("Pad `") + srcPad + "` is not linked";
+
+  if (peer)
+    gst_object_unref (peer);
+  if (pad)
+    gst_object_unref (pad);
+  gst_object_unref (element);
+
   return res;
 }
 
+bool
+GraphManager::SetBinExpanded (const char *name, bool expanded)
+{
+  GstElement *element = gst_bin_get_by_name (GST_BIN (m_pGraph), name);
+  if (!element)
+    return false;
+
+  bool isBin = GST_IS_BIN (element);
+  gst_object_unref (element);
+
+  if (!isBin)
+    return false;
+
+  if (expanded)
+    m_expandedBins.insert (name);
+  else
+    m_expandedBins.erase (name);
+
+  return true;
+}
+
+bool
+GraphManager::IsBinExpanded (const char *name)
+{
+  return m_expandedBins.count (name) != 0;
+}
+
 bool
 GraphManager::Play ()
 {
@@ -462,6 +1617,309 @@ GraphManager::Stop ()
   return res == GST_STATE_CHANGE_SUCCESS;
 }
 
+void
+GraphManager::AddBusListener (BusListener listener, gpointer data)
+{
+  g_mutex_lock (&m_busListenersLock);
+  m_busListeners.push_back (std::make_pair (listener, data));
+  g_mutex_unlock (&m_busListenersLock);
+}
+
+void
+GraphManager::RemoveBusListener (BusListener listener, gpointer data)
+{
+  /* waits for a dispatch in progress */
+  g_mutex_lock (&m_busListenersLock);
+  for (std::size_t i = 0; i < m_busListeners.size (); i++) {
+    if (m_busListeners[i].first == listener
+    && m_busListeners[i].second == data) {
+      m_busListeners.erase (m_busListeners.begin () + i);
+      break;
+    }
+  }
+  g_mutex_unlock (&m_busListenersLock);
+}
+
+void
+GraphManager::DispatchBusMessage (GstMessage *message)
+{
+  if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_QOS)
+    recordQos (message);
+  else if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_LATENCY
+  || (GST_MESSAGE_TYPE (message) == GST_MESSAGE_STATE_CHANGED
+      && GST_MESSAGE_SRC (message) == GST_OBJECT (m_pGraph)))
+    m_latencyChanged = true;
+
+  g_mutex_lock (&m_busListenersLock);
+  for (std::size_t i = 0; i < m_busListeners.size (); i++)
+    m_busListeners[i].first (message, m_busListeners[i].second);
+  g_mutex_unlock (&m_busListenersLock);
+}
+
+void
+GraphManager::recordQos (GstMessage *message)
+{
+  GstFormat format;
+  guint64 processed, dropped;
+  gint64 jitter;
+  gdouble proportion;
+  gint quality;
+
+  gst_message_parse_qos_stats (message, &format, &processed, &dropped);
+  gst_message_parse_qos_values (message, &jitter, &proportion, &quality);
+
+  /* -1 when the element does not know */
+  if (processed == (guint64) -1)
+    processed = 0;
+  if (dropped == (guint64) -1)
+    dropped = 0;
+
+  GstObject *src = GST_MESSAGE_SRC (message);
+  GstElement *upstream = NULL;
+#if GST_VERSION_MAJOR >= 1
+  if (GST_IS_ELEMENT (src) && GST_OBJECT_FLAG_IS_SET (src, GST_ELEMENT_FLAG_SINK))
+#else
+  if (GST_IS_ELEMENT (src) && GST_OBJECT_FLAG_IS_SET (src, GST_ELEMENT_IS_SINK))
+#endif
+    upstream = get_upstream_element (GST_ELEMENT (src));
+
+  g_mutex_lock (&m_qosLock);
+  QosHistory &history = m_qos[GST_OBJECT_NAME (src)];
+  QosStats &last = history.m_last;
+
+  /* the first message counts from the start of the stream */
+  QosSample sample;
+  sample.m_time = g_get_monotonic_time ();
+  sample.m_processed = counter_delta (history.m_processed, processed);
+  sample.m_dropped = counter_delta (history.m_dropped, dropped);
+  sample.m_jitter = jitter;
+  sample.m_proportion = proportion;
+  history.m_processed = processed;
+  history.m_dropped = dropped;
+
+  last.m_totalProcessed += sample.m_processed;
+  last.m_totalDropped += sample.m_dropped;
+
+  history.m_samples.push_back (sample);
+  if (history.m_samples.size () > QOS_MAX_SAMPLES)
+    history.m_samples.pop_front ();
+
+  last.m_jitter = jitter;
+  last.m_proportion = proportion;
+  if (upstream)
+    last.m_upstream = GST_OBJECT_NAME (upstream);
+  g_mutex_unlock (&m_qosLock);
+
+  if (upstream)
+    gst_object_unref (upstream);
+}
+
+std::map<std::string, QosStats>
+GraphManager::GetQos (gint64 window)
+{
+  std::map<std::string, QosStats> stats;
+  gint64 since = g_get_monotonic_time () - window;
+
+  g_mutex_lock (&m_qosLock);
+  std::map<std::string, QosHistory>::iterator it;
+  for (it = m_qos.begin (); it != m_qos.end (); ++it) {
+    std::deque<QosSample> &samples = it->second.m_samples;
+
+    while (!samples.empty () && samples.front ().m_time < since)
+      samples.pop_front ();
+
+    QosStats item = it->second.m_last;
+    for (std::size_t i = 0; i < samples.size (); i++) {
+      const QosSample &sample = samples[i];
+      item.m_processed += sample.m_processed;
+      item.m_dropped += sample.m_dropped;
+      item.m_messages++;
+      item.m_maxJitter = MAX (item.m_maxJitter, sample.m_jitter);
+      item.m_minProportion = MIN (item.m_minProportion, sample.m_proportion);
+    }
+
+    stats[it->first] = item;
+  }
+  g_mutex_unlock (&m_qosLock);
+
+  return stats;
+}
+
+void
+GraphManager::ResetQos ()
+{
+  /* the counters stay, the next message counts from them */
+  g_mutex_lock (&m_qosLock);
+  std::map<std::string, QosHistory>::iterator it;
+  for (it = m_qos.begin (); it != m_qos.end (); ++it) {
+    it->second.m_samples.clear ();
+    it->second.m_last = QosStats ();
+  }
+  g_mutex_unlock (&m_qosLock);
+}
+
+static void
+query_latency (GstQuery *query, LatencyInfo &info)
+{
+  gboolean live;
+  GstClockTime min, max;
+
+  gst_query_parse_latency (query, &live, &min, &max);
+  info.m_valid = true;
+  info.m_live = live;
+  info.m_min = min;
+  info.m_max = max;
+}
+
+void
+GraphManager::queryBranch (GstElement *element, int depth,
+                           std::set<GstElement *> &visited,
+                           std::vector<LatencyInfo> &branch)
+{
+  /* a loop in the graph, or a very long chain */
+  if (!visited.insert (element).second || depth > 64)
+    return;
+
+  std::vector<GstPad *> pads;
+  GstIterator *iter = gst_element_iterate_sink_pads (element);
+  bool done = false;
+  while (!done) {
+#if GST_VERSION_MAJOR >= 1
+    GValue value = G_VALUE_INIT;
+    switch (gst_iterator_next (iter, &value)) {
+      case GST_ITERATOR_OK:
+        pads.push_back (GST_PAD (gst_object_ref (g_value_get_object (&value))));
+        g_value_reset (&value);
+        break;
+#else
+    GstPad *pad = NULL;
+    switch (gst_iterator_next (iter, (gpointer *) &pad)) {
+      case GST_ITERATOR_OK:
+        pads.push_back (pad);
+        break;
+#endif
+      case GST_ITERATOR_RESYNC:
+        for (std::size_t i = 0; i < pads.size (); i++)
+          gst_object_unref (pads[i]);
+        pads.clear ();
+        gst_iterator_resync (iter);
+        break;
+      default:
+        done = true;
+        break;
+    }
+  }
+  gst_iterator_free (iter);
+
+  for (std::size_t i = 0; i < pads.size (); i++) {
+    GstPad *peer = gst_pad_get_peer (pads[i]);
+    GstElement *upstream = peer ? gst_pad_get_parent_element (peer) : NULL;
+
+    if (upstream) {
+      /* what the branch reports up to this link */
+      LatencyInfo info;
+      info.m_element = GST_OBJECT_NAME (upstream);
+      info.m_pad = GST_OBJECT_NAME (peer);
+      info.m_depth = depth;
+
+      GstQuery *query = gst_query_new_latency ();
+      if (gst_pad_peer_query (pads[i], query))
+        query_latency (query, info);
+      gst_query_unref (query);
+
+      branch.push_back (info);
+      queryBranch (upstream, depth + 1, visited, branch);
+      gst_object_unref (upstream);
+    }
+
+    if (peer)
+      gst_object_unref (peer);
+    gst_object_unref (pads[i]);
+  }
+}
+
+PipelineLatency
+GraphManager::GetLatency (bool force)
+{
+  if (!m_latencyChanged.exchange (false) && !force)
+    return m_latency;
+
+  PipelineLatency latency;
+  latency.m_queriedAt = g_get_monotonic_time ();
+  latency.m_pipeline.m_element = GST_OBJECT_NAME (m_pGraph);
+#if GST_CHECK_VERSION(1,6,0)
+  latency.m_configured = gst_pipeline_get_latency (GST_PIPELINE (m_pGraph));
+#endif
+
+  GstQuery *query = gst_query_new_latency ();
+  if (gst_element_query (m_pGraph, query))
+    query_latency (query, latency.m_pipeline);
+  gst_query_unref (query);
+
+  std::vector<GstElement *> sinks;
+  GstIterator *iter = gst_bin_iterate_sinks (GST_BIN (m_pGraph));
+  bool done = false;
+  while (!done) {
+#if GST_VERSION_MAJOR >= 1
+    GValue value = G_VALUE_INIT;
+    switch (gst_iterator_next (iter, &value)) {
+      case GST_ITERATOR_OK:
+        sinks.push_back (GST_ELEMENT (gst_object_ref (g_value_get_object (&value))));
+        g_value_reset (&value);
+        break;
+#else
+    GstElement *sink = NULL;
+    switch (gst_iterator_next (iter, (gpointer *) &sink)) {
+      case GST_ITERATOR_OK:
+        sinks.push_back (sink);
+        break;
+#endif
+      case GST_ITERATOR_RESYNC:
+        for (std::size_t i = 0; i < sinks.size (); i++)
+          gst_object_unref (sinks[i]);
+        sinks.clear ();
+        gst_iterator_resync (iter);
+        break;
+      default:
+        done = true;
+        break;
+    }
+  }
+  gst_iterator_free (iter);
+
+  for (std::size_t i = 0; i < sinks.size (); i++) {
+    SinkLatency sink;
+    sink.m_sink.m_element = GST_OBJECT_NAME (sinks[i]);
+
+    query = gst_query_new_latency ();
+    if (gst_element_query (sinks[i], query))
+      query_latency (query, sink.m_sink);
+    gst_query_unref (query);
+
+    std::set<GstElement *> visited;
+    queryBranch (sinks[i], 1, visited, sink.m_branch);
+
+    latency.m_sinks.push_back (sink);
+    gst_object_unref (sinks[i]);
+  }
+
+  m_latency = latency;
+  return latency;
+}
+
+bool
+GraphManager::SetPipelineLatency (GstClockTime latency)
+{
+#if GST_CHECK_VERSION(1,6,0)
+  gst_pipeline_set_latency (GST_PIPELINE (m_pGraph), latency);
+  m_latencyChanged = true;
+  return true;
+#else
+  Q_UNUSED(latency);
+  return false;
+#endif
+}
+
 double
 GraphManager::GetPosition ()
 {
@@ -5,6 +5,10 @@
 
 #include <gst/gst.h>
 
+#include <atomic>
+#include <deque>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -74,13 +78,112 @@ struct ElementInfo
 
 
 	size_t                       m_id;
+	size_t                       m_parentId;
 	std::string                  m_name;
 	std::string                  m_pluginName;
+	bool                         m_isBin;
+	bool                         m_isExpanded;
+	size_t                       m_childCount;
 	std::vector<PadInfo>         m_pads;
 	std::vector<Connection>      m_connections;
 };
 
 
+/* Outcome of a live reconfiguration, see GraphManager::ReplaceElement */
+struct SwapReport
+{
+	SwapReport(): m_glitch(-1), m_droppedBuffers(0), m_pending(false),
+		m_drained(true) {}
+
+	/* time without data downstream in microseconds, -1 if unknown */
+	gint64        m_glitch;
+	/* estimated from the timestamp gap across the swap */
+	guint64       m_droppedBuffers;
+	/* still running in the streaming threads, see GraphManager::PollSwap */
+	bool          m_pending;
+	/* false when the old element did not drain in time and what it held
+	 * was dropped */
+	bool          m_drained;
+	std::string   m_error;
+};
+
+/* QoS messages of one element within a window, see GraphManager::GetQos.
+ * Processed and dropped are in whatever unit the element reports,
+ * frames for video sinks. */
+struct QosStats
+{
+	QosStats(): m_processed(0), m_dropped(0), m_messages(0), m_maxJitter(0),
+		m_minProportion(1.0), m_totalProcessed(0), m_totalDropped(0),
+		m_jitter(0), m_proportion(1.0) {}
+
+	double DropRate() const
+	{
+		guint64 total = m_processed + m_dropped;
+		return total ? (double) m_dropped / total : 0;
+	}
+
+	/* within the window */
+	guint64       m_processed;
+	guint64       m_dropped;
+	guint64       m_messages;
+	/* in nanoseconds, positive when the buffers came late */
+	gint64        m_maxJitter;
+	double        m_minProportion;
+	/* since the element was first seen */
+	guint64       m_totalProcessed;
+	guint64       m_totalDropped;
+	/* of the last message */
+	gint64        m_jitter;
+	double        m_proportion;
+	/* for a sink, the element which got its QoS events */
+	std::string   m_upstream;
+};
+
+#define QOS_WINDOW (5 * G_USEC_PER_SEC)
+
+/* Answer of a latency query, at a sink or at a link upstream of it */
+struct LatencyInfo
+{
+	LatencyInfo(): m_depth(0), m_valid(false), m_live(false), m_min(0),
+		m_max(GST_CLOCK_TIME_NONE) {}
+
+	/* the element and pad answering, the sink for a sink */
+	std::string   m_element;
+	std::string   m_pad;
+	/* links from the sink */
+	int           m_depth;
+	bool          m_valid;
+	bool          m_live;
+	GstClockTime  m_min;
+	GstClockTime  m_max;
+};
+
+struct SinkLatency
+{
+	LatencyInfo               m_sink;
+	/* every link upstream of the sink, depth first, so that the latency
+	 * each element adds is the difference with its downstream link */
+	std::vector<LatencyInfo>  m_branch;
+};
+
+struct PipelineLatency
+{
+	PipelineLatency(): m_configured(GST_CLOCK_TIME_NONE), m_queriedAt(0) {}
+
+	/* what the pipeline distributes to its sinks */
+	LatencyInfo               m_pipeline;
+	/* set with SetPipelineLatency, GST_CLOCK_TIME_NONE when automatic */
+	GstClockTime              m_configured;
+	std::vector<SinkLatency>  m_sinks;
+	/* monotonic time of the queries, in microseconds */
+	gint64                    m_queriedAt;
+};
+
+struct LiveSwap;
+
+/* Called from the thread which posts the message, see AddBusListener */
+typedef void (*BusListener)(GstMessage *message, gpointer data);
+
 class GraphManager
 {
 
@@ -89,14 +192,39 @@ public:
 	~GraphManager();
 
 	gchar* AddPlugin(const char *plugin, const char *name);
+	bool AddElement(GstElement *element);
 	bool RemovePlugin(const char *name);
 	bool Connect(const char *srcElement, const char *srcPad,
 		const char *dstElement, const char *dstPad);
 	bool Connect(const char *srcElement, const char *dstElement);
+	bool ConnectWhenReady(const char *element1, const char *pad1,
+		const char *element2, const char *pad2);
+	bool HasPendingLinks();
+	void ClearPendingLinks();
+	void LinkPendingPads(GstElement *element, GstPad *pad);
 	bool Disconnect(const char *srcElement, const char *srcPad,
 		const char *dstElement, const char *dstPad);
 	std::vector <ElementInfo> GetInfo();
 
+	void BeginTransaction();
+	bool CommitTransaction();
+	bool Clear();
+
+	/* These work on a PLAYING pipeline too, the data is held back by
+	 * pad probes while the graph is changed. There the report is pending
+	 * and the swap goes on in the streaming threads, one at a time. */
+	bool ReplaceElement(const char *name, const char *plugin,
+		SwapReport &report);
+	bool InsertElement(const char *srcElement, const char *srcPad,
+		const char *plugin, SwapReport &report);
+	/* Does not block: false while the pending swap runs, true once it is
+	 * over, with its outcome. An old element which does not drain in time
+	 * is swapped anyway, a link without data is left as it was. */
+	bool PollSwap(bool &res, SwapReport &report);
+
+	bool SetBinExpanded(const char *name, bool expanded);
+	bool IsBinExpanded(const char *name);
+
 	bool OpenUri(const char *uri, const char *name);
 
 	double GetPosition();
@@ -109,9 +237,114 @@ public:
 	bool Pause();
 	bool Stop();
 
+	/* Every message of the pipeline bus goes through the listeners, in the
+	 * posting thread, and is dropped afterwards since nothing pops the bus.
+	 * Once RemoveBusListener returns the listener is not running anymore. */
+	void AddBusListener(BusListener listener, gpointer data);
+	void RemoveBusListener(BusListener listener, gpointer data);
+	void DispatchBusMessage(GstMessage *message);
+
+	/* element name to its QoS within the last window microseconds */
+	std::map<std::string, QosStats> GetQos(gint64 window = QOS_WINDOW);
+	void ResetQos();
+
+	/* The queries are only run again after a LATENCY message or a state
+	 * change of the pipeline, the answers are cached meanwhile. Not
+	 * thread safe, call from one thread. */
+	PipelineLatency GetLatency(bool force = false);
+	bool SetPipelineLatency(GstClockTime latency);
+
 	QString getPadCaps(ElementInfo* elementInfo, PadInfo* padInfo, ePadCapsSubset subset, bool afTruncated = false);
 
 	GstElement       *m_pGraph;
+
+private:
+	struct PendingLink
+	{
+		std::string m_pad;
+		std::string m_peerElement;
+		std::string m_peerPad;
+	};
+
+	struct GraphOperation
+	{
+		enum Type
+		{
+			Add,
+			Remove,
+			Link,
+			Unlink
+		};
+
+		Type          m_type;
+		GstElement   *m_pElement;
+		std::string   m_element1;
+		std::string   m_pad1;
+		std::string   m_element2;
+		std::string   m_pad2;
+	};
+
+	struct QosSample
+	{
+		gint64        m_time;
+		/* since the previous message */
+		guint64       m_processed;
+		guint64       m_dropped;
+		gint64        m_jitter;
+		double        m_proportion;
+	};
+
+	/* The samples only hold deltas, taken from the counters of the
+	 * previous message, which outlive its sample once it is evicted. */
+	struct QosHistory
+	{
+		QosHistory(): m_processed(0), m_dropped(0) {}
+
+		std::deque<QosSample> m_samples;
+		guint64       m_processed;
+		guint64       m_dropped;
+		QosStats      m_last;
+	};
+
+	void recordQos(GstMessage *message);
+	void queryBranch(GstElement *element, int depth,
+		std::set<GstElement *> &visited, std::vector<LatencyInfo> &branch);
+
+	bool runLiveSwap(GstElement *oldElement, GstPad *srcPad, GstPad *sinkPad,
+		const char *plugin, SwapReport &report);
+	bool endLiveSwap(LiveSwap *swap, SwapReport &report);
+	void cancelLiveSwap();
+	bool addElement(GstElement *element);
+	bool removeElement(const char *name);
+	bool applyOperation(const GraphOperation &operation);
+
+	void addPendingLink(GstElement *element, const char *pad,
+		const char *peerElement, const char *peerPad);
+	void removePendingLink(const std::string &element, const std::string &pad,
+		const std::string &peerElement, const std::string &peerPad);
+
+	std::set<std::string> m_expandedBins;
+
+	/* the pending live swap, a reference */
+	LiveSwap         *m_pSwap;
+
+	/* operations queued until the outermost transaction is committed */
+	std::vector<GraphOperation> m_transaction;
+	int m_transactionDepth;
+
+	/* links waiting for a sometimes pad, by the element owning the pad */
+	std::map<std::string, std::vector<PendingLink> > m_pendingLinks;
+	GMutex m_pendingLinksLock;
+
+	std::vector<std::pair<BusListener, gpointer> > m_busListeners;
+	GMutex m_busListenersLock;
+
+	std::map<std::string, QosHistory> m_qos;
+	GMutex m_qosLock;
+
+	PipelineLatency m_latency;
+	/* set from the bus, in any thread */
+	std::atomic<bool> m_latencyChanged;
 };
 
 #endif
@@ -0,0 +1,220 @@
+#include "LatencyPanel.h"
+
+#include <QDoubleSpinBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#define LATENCY_REFRESH_INTERVAL 1000
+
+enum {
+  NAME_COLUMN,
+  LIVE_COLUMN,
+  MIN_COLUMN,
+  MAX_COLUMN,
+  ADDED_COLUMN
+};
+
+namespace
+{
+  QString
+  formatTime (GstClockTime time)
+  {
+    if (!GST_CLOCK_TIME_IS_VALID (time))
+      return "none";
+
+    return QString::number ((double) time / GST_MSECOND, 'f', 3);
+  }
+
+  QTreeWidgetItem *
+  createItem (const QString &name, const LatencyInfo &info)
+  {
+    QTreeWidgetItem *pitem = new QTreeWidgetItem;
+    pitem->setText (NAME_COLUMN, name);
+
+    if (!info.m_valid) {
+      pitem->setText (LIVE_COLUMN, "no answer");
+      pitem->setForeground (LIVE_COLUMN, Qt::gray);
+      return pitem;
+    }
+
+    pitem->setText (LIVE_COLUMN, info.m_live ? "yes" : "no");
+    pitem->setText (MIN_COLUMN, formatTime (info.m_min));
+    pitem->setText (MAX_COLUMN, formatTime (info.m_max));
+    /* more latency than the branch can buffer */
+    if (GST_CLOCK_TIME_IS_VALID (info.m_max) && info.m_max < info.m_min)
+      pitem->setForeground (MAX_COLUMN, Qt::red);
+    return pitem;
+  }
+
+  /* what the element of the item adds to the links upstream of it */
+  void
+  fillAdded (QTreeWidgetItem *item, const LatencyInfo &info,
+             GstClockTime upstream)
+  {
+    if (info.m_valid)
+      item->setText (ADDED_COLUMN, formatTime (
+          info.m_min > upstream ? info.m_min - upstream : 0));
+  }
+}
+
+LatencyPanel::LatencyPanel (GraphManager *graph, QWidget *parent)
+: QWidget (parent),
+m_pGraph (graph),
+m_shownAt (-1)
+{
+  m_pPipeline = new QLabel;
+  m_pPipeline->setTextInteractionFlags (Qt::TextSelectableByMouse);
+
+  m_pLatency = new QDoubleSpinBox;
+  m_pLatency->setRange (0, 60000);
+  m_pLatency->setDecimals (3);
+  m_pLatency->setSuffix (" ms");
+  QPushButton *pset = new QPushButton ("Set");
+  pset->setToolTip ("Set the latency of the pipeline with gst_pipeline_set_latency");
+  QPushButton *pautomatic = new QPushButton ("Automatic");
+  pautomatic->setToolTip ("Let the pipeline use the minimum latency its sinks report");
+  QPushButton *prequery = new QPushButton ("Query");
+  prequery->setToolTip ("Query the latency again now");
+
+  QHBoxLayout *phblayPipeline = new QHBoxLayout;
+  phblayPipeline->addWidget (m_pPipeline, 1);
+  phblayPipeline->addWidget (m_pLatency);
+  phblayPipeline->addWidget (pset);
+  phblayPipeline->addWidget (pautomatic);
+  phblayPipeline->addWidget (prequery);
+
+  m_pSinks = new QTreeWidget;
+  m_pSinks->setHeaderLabels (QStringList () << "Sink / link" << "Live"
+                             << "Min (ms)" << "Max (ms)" << "Added (ms)");
+  m_pSinks->setUniformRowHeights (true);
+  m_pSinks->header ()->setSectionResizeMode (NAME_COLUMN, QHeaderView::Stretch);
+  m_pSinks->header ()->setStretchLastSection (false);
+
+  QVBoxLayout *playout = new QVBoxLayout;
+  playout->setContentsMargins (0, 0, 0, 0);
+  playout->addLayout (phblayPipeline);
+  playout->addWidget (m_pSinks, 1);
+  setLayout (playout);
+
+  m_pRefreshTimer = new QTimer (this);
+  m_pRefreshTimer->setInterval (LATENCY_REFRESH_INTERVAL);
+  m_pRefreshTimer->start ();
+
+  connect (pset, SIGNAL (clicked ()), SLOT (setLatency ()));
+  connect (pautomatic, SIGNAL (clicked ()), SLOT (setAutomatic ()));
+  connect (prequery, SIGNAL (clicked ()), SLOT (requery ()));
+  connect (m_pRefreshTimer, SIGNAL (timeout ()), SLOT (refresh ()));
+}
+
+void
+LatencyPanel::refresh ()
+{
+  if (!isVisible ())
+    return;
+
+  showLatency (m_pGraph->GetLatency ());
+}
+
+void
+LatencyPanel::requery ()
+{
+  showLatency (m_pGraph->GetLatency (true));
+}
+
+void
+LatencyPanel::showLatency (const PipelineLatency &latency)
+{
+  /* the answers are cached until the latency changes */
+  if (latency.m_queriedAt == m_shownAt)
+    return;
+  m_shownAt = latency.m_queriedAt;
+
+  QString text = "Pipeline: ";
+  if (latency.m_pipeline.m_valid)
+    text += QString ("%1, min %2 ms, max %3 ms")
+        .arg (latency.m_pipeline.m_live ? "live" : "not live")
+        .arg (formatTime (latency.m_pipeline.m_min))
+        .arg (formatTime (latency.m_pipeline.m_max));
+  else
+    text += "no answer";
+  text += ", configured: ";
+  text += GST_CLOCK_TIME_IS_VALID (latency.m_configured)
+      ? formatTime (latency.m_configured) + " ms" : QString ("automatic");
+  m_pPipeline->setText (text);
+
+  m_pSinks->clear ();
+  for (std::size_t i = 0; i < latency.m_sinks.size (); i++) {
+    const SinkLatency &sink = latency.m_sinks[i];
+
+    QTreeWidgetItem *psink = createItem (sink.m_sink.m_element.c_str (),
+                                         sink.m_sink);
+    m_pSinks->addTopLevelItem (psink);
+
+    /* the branch comes depth first, the parent of a link is the last one
+     * seen a level closer to the sink */
+    std::vector<const LatencyInfo *> infos (1, &sink.m_sink);
+    std::vector<QTreeWidgetItem *> items (1, psink);
+    /* the slowest input of each item's element */
+    std::vector<GstClockTime> inputs (1, 0);
+    std::vector<std::size_t> path (1, 0);
+
+    for (std::size_t j = 0; j < sink.m_branch.size (); j++) {
+      const LatencyInfo &info = sink.m_branch[j];
+      if (info.m_depth < 1 || (std::size_t) info.m_depth > path.size ())
+        continue;
+
+      path.resize (info.m_depth);
+      std::size_t parent = path.back ();
+
+      QTreeWidgetItem *pitem = createItem (
+          QString ("%1:%2").arg (info.m_element.c_str ()).arg (info.m_pad.c_str ()),
+          info);
+      items[parent]->addChild (pitem);
+      if (info.m_valid)
+        inputs[parent] = MAX (inputs[parent], info.m_min);
+
+      path.push_back (items.size ());
+      infos.push_back (&info);
+      items.push_back (pitem);
+      inputs.push_back (0);
+    }
+
+    for (std::size_t j = 0; j < items.size (); j++)
+      fillAdded (items[j], *infos[j], inputs[j]);
+  }
+
+  m_pSinks->expandAll ();
+  for (int i = 0; i < m_pSinks->columnCount (); i++)
+    if (i != NAME_COLUMN)
+      m_pSinks->resizeColumnToContents (i);
+}
+
+void
+LatencyPanel::setLatency ()
+{
+  if (!m_pGraph->SetPipelineLatency (m_pLatency->value () * GST_MSECOND)) {
+    QMessageBox::warning (this, "Pipeline latency",
+                          "Setting the latency needs GStreamer 1.6");
+    return;
+  }
+
+  requery ();
+}
+
+void
+LatencyPanel::setAutomatic ()
+{
+  if (!m_pGraph->SetPipelineLatency (GST_CLOCK_TIME_NONE)) {
+    QMessageBox::warning (this, "Pipeline latency",
+                          "Setting the latency needs GStreamer 1.6");
+    return;
+  }
+
+  requery ();
+}
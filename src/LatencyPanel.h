@@ -0,0 +1,41 @@
+#ifndef LATENCY_PANEL_H_
+#define LATENCY_PANEL_H_
+
+#include <QWidget>
+
+#include "GraphManager.h"
+
+class QDoubleSpinBox;
+class QLabel;
+class QTimer;
+class QTreeWidget;
+
+/* Latency of each sink and of every link upstream of it, so that what a
+ * queue or a jitterbuffer adds to the budget shows as the difference with
+ * the link before it. */
+class LatencyPanel: public QWidget
+{
+  Q_OBJECT
+
+public:
+  LatencyPanel(GraphManager *graph, QWidget *parent = 0);
+
+private slots:
+  void refresh();
+  void requery();
+  void setLatency();
+  void setAutomatic();
+
+private:
+  void showLatency(const PipelineLatency &latency);
+
+  GraphManager *m_pGraph;
+  gint64 m_shownAt;
+
+  QLabel *m_pPipeline;
+  QDoubleSpinBox *m_pLatency;
+  QTreeWidget *m_pSinks;
+  QTimer *m_pRefreshTimer;
+};
+
+#endif
@@ -0,0 +1,336 @@
+#include "LogAnalyzer.h"
+
+#include <QBrush>
+#include <QComboBox>
+#include <QCompleter>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QSplitter>
+#include <QStringListModel>
+#include <QTableView>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <gst/gst.h>
+
+LogIndexModel::LogIndexModel (const LogIndex *index, QObject *parent)
+: QAbstractTableModel (parent),
+m_pIndex (index)
+{
+}
+
+int
+LogIndexModel::rowCount (const QModelIndex &parent) const
+{
+  if (parent.isValid ())
+    return 0;
+
+  return m_lines.size ();
+}
+
+int
+LogIndexModel::columnCount (const QModelIndex &parent) const
+{
+  if (parent.isValid ())
+    return 0;
+
+  return ColumnCount;
+}
+
+QVariant
+LogIndexModel::data (const QModelIndex &index, int role) const
+{
+  if (!index.isValid () || index.row () >= (int) m_lines.size ())
+    return QVariant ();
+
+  quint32 line = m_lines[index.row ()];
+  const LogIndexEntry &entry = m_pIndex->entry (line);
+
+  if (role == Qt::ForegroundRole) {
+    if (entry.m_level == GST_LEVEL_ERROR)
+      return QBrush (Qt::red);
+    if (entry.m_level == GST_LEVEL_WARNING)
+      return QBrush (Qt::darkYellow);
+    return QVariant ();
+  }
+
+  if (role != Qt::DisplayRole)
+    return QVariant ();
+
+  switch (index.column ()) {
+    case TimeColumn:
+      return LogParser::formatTimestamp (entry.m_timestamp);
+    case ThreadColumn:
+      return m_pIndex->thread (entry.m_thread);
+    case LevelColumn:
+      if (entry.m_level == GST_LEVEL_NONE)
+        return QVariant ();
+      return QString (gst_debug_level_get_name ((GstDebugLevel) entry.m_level));
+    case CategoryColumn:
+      return m_pIndex->category (entry.m_category);
+    case ObjectColumn:
+      return m_pIndex->object (entry.m_object);
+    case MessageColumn: {
+      GstLogFields fields;
+      if (entry.m_category && m_pIndex->fields (line, fields))
+        return fields.m_message.toString ();
+      return m_pIndex->text (line).toString ();
+    }
+  }
+
+  return QVariant ();
+}
+
+QVariant
+LogIndexModel::headerData (int section, Qt::Orientation orientation,
+                           int role) const
+{
+  static const char *titles[ColumnCount] = {
+    "Time", "Thread", "Level", "Category", "Object", "Message"
+  };
+
+  if (role != Qt::DisplayRole)
+    return QVariant ();
+
+  if (orientation == Qt::Horizontal)
+    return QString (titles[section]);
+
+  return QString::number (m_lines[section] + 1);
+}
+
+void
+LogIndexModel::setLines (std::vector<quint32> &lines)
+{
+  beginResetModel ();
+  m_lines.swap (lines);
+  endResetModel ();
+}
+
+namespace
+{
+  bool
+  openIndex (LogIndex *index, const QString &fileName, QString *error)
+  {
+    return index->open (fileName, *error);
+  }
+}
+
+LogAnalyzer::LogAnalyzer (QWidget *pwgt, Qt::WindowFlags f)
+: QDialog (pwgt, f)
+{
+  setWindowTitle ("GStreamer log");
+
+  m_pLevel = new QComboBox;
+  m_pLevel->addItem ("Any", -1);
+  for (int level = GST_LEVEL_ERROR; level <= GST_LEVEL_TRACE; level++)
+    m_pLevel->addItem (gst_debug_level_get_name ((GstDebugLevel) level), level);
+
+  m_pCategory = new QComboBox;
+  /* a log may name hundreds of thousands of objects, they are only
+   * looked up as the name is typed */
+  m_pObjects = new QStringListModel (this);
+  QCompleter *pcompleter = new QCompleter (m_pObjects, this);
+  pcompleter->setCaseSensitivity (Qt::CaseInsensitive);
+  pcompleter->setFilterMode (Qt::MatchContains);
+  m_pObject = new QLineEdit;
+  m_pObject->setPlaceholderText ("Any");
+  m_pObject->setCompleter (pcompleter);
+  m_pThread = new QComboBox;
+
+  m_pText = new QLineEdit;
+  m_pText->setPlaceholderText ("Text");
+
+  m_pTime = new QLineEdit;
+  m_pTime->setPlaceholderText ("Go to h:mm:ss.ns");
+
+  QHBoxLayout *phblayFilter = new QHBoxLayout;
+  phblayFilter->addWidget (new QLabel ("Level"));
+  phblayFilter->addWidget (m_pLevel);
+  phblayFilter->addWidget (new QLabel ("Category"));
+  phblayFilter->addWidget (m_pCategory);
+  phblayFilter->addWidget (new QLabel ("Object"));
+  phblayFilter->addWidget (m_pObject);
+  phblayFilter->addWidget (new QLabel ("Thread"));
+  phblayFilter->addWidget (m_pThread);
+  phblayFilter->addWidget (m_pText, 1);
+  phblayFilter->addWidget (m_pTime);
+
+  m_pModel = new LogIndexModel (&m_index, this);
+
+  m_pView = new QTableView;
+  m_pView->setModel (m_pModel);
+  m_pView->setSelectionBehavior (QAbstractItemView::SelectRows);
+  m_pView->setWordWrap (false);
+  m_pView->horizontalHeader ()->setStretchLastSection (true);
+  /* millions of rows, none of them may be measured */
+  m_pView->verticalHeader ()->setSectionResizeMode (QHeaderView::Fixed);
+  m_pView->verticalHeader ()->setDefaultSectionSize (
+      m_pView->fontMetrics ().height () + 4);
+
+  m_pCategories = new QTreeWidget;
+  m_pCategories->setHeaderLabels (QStringList () << "Category" << "Lines");
+  m_pCategories->setRootIsDecorated (false);
+  m_pCategories->setSortingEnabled (true);
+
+  QSplitter *psplitter = new QSplitter;
+  psplitter->addWidget (m_pView);
+  psplitter->addWidget (m_pCategories);
+  psplitter->setStretchFactor (0, 4);
+  psplitter->setStretchFactor (1, 1);
+
+  m_pStatus = new QLabel;
+
+  QVBoxLayout *pvblay = new QVBoxLayout;
+  pvblay->addLayout (phblayFilter);
+  pvblay->addWidget (psplitter, 1);
+  pvblay->addWidget (m_pStatus);
+  setLayout (pvblay);
+
+  resize (1200, 700);
+
+  connect (&m_watcher, SIGNAL (finished ()), SLOT (indexReady ()));
+  connect (m_pLevel, SIGNAL (currentIndexChanged (int)), SLOT (applyFilter ()));
+  connect (m_pCategory, SIGNAL (currentIndexChanged (int)), SLOT (applyFilter ()));
+  connect (m_pObject, SIGNAL (editingFinished ()), SLOT (applyFilter ()));
+  connect (pcompleter, SIGNAL (activated (QString)), SLOT (applyFilter ()));
+  connect (m_pThread, SIGNAL (currentIndexChanged (int)), SLOT (applyFilter ()));
+  connect (m_pText, SIGNAL (returnPressed ()), SLOT (applyFilter ()));
+  connect (m_pTime, SIGNAL (returnPressed ()), SLOT (goToTime ()));
+  connect (m_pCategories, SIGNAL (itemActivated (QTreeWidgetItem *, int)),
+           SLOT (categoryActivated (QTreeWidgetItem *)));
+}
+
+LogAnalyzer::~LogAnalyzer ()
+{
+  m_watcher.waitForFinished ();
+}
+
+void
+LogAnalyzer::openFile (const QString &fileName)
+{
+  if (m_watcher.isRunning ())
+    return;
+
+  std::vector<quint32> none;
+  m_pModel->setLines (none);
+
+  setWindowTitle ("GStreamer log - " + fileName);
+  m_pStatus->setText ("Indexing " + fileName + "...");
+  setEnabled (false);
+
+  m_watcher.setFuture (QtConcurrent::run (openIndex, &m_index, fileName,
+                                          &m_error));
+}
+
+void
+LogAnalyzer::indexReady ()
+{
+  setEnabled (true);
+
+  if (!m_watcher.result ()) {
+    m_pStatus->setText ("Cannot open the log: " + m_error);
+    return;
+  }
+
+  fillFilters ();
+  applyFilter ();
+}
+
+void
+LogAnalyzer::fillFilters ()
+{
+  /* the filter is applied once, when everything is filled */
+  m_pCategory->blockSignals (true);
+  m_pThread->blockSignals (true);
+
+  m_pCategory->clear ();
+  m_pCategory->addItem ("Any", -1);
+  m_pCategories->clear ();
+  for (int i = 1; i < m_index.categoryCount (); i++) {
+    m_pCategory->addItem (m_index.category (i), i);
+
+    QTreeWidgetItem *pitem = new QTreeWidgetItem (m_pCategories);
+    pitem->setText (0, m_index.category (i));
+    pitem->setData (1, Qt::DisplayRole, m_index.categoryLines (i));
+    pitem->setData (0, Qt::UserRole, i);
+  }
+  m_pCategories->sortItems (1, Qt::DescendingOrder);
+  m_pCategories->resizeColumnToContents (0);
+
+  /* the row is the id minus one */
+  QStringList objects;
+  objects.reserve (m_index.objectCount ());
+  for (int i = 1; i < m_index.objectCount (); i++)
+    objects.append (m_index.object (i));
+  m_pObjects->setStringList (objects);
+  m_pObject->clear ();
+
+  m_pThread->clear ();
+  m_pThread->addItem ("Any", -1);
+  for (int i = 1; i < m_index.threadCount (); i++)
+    m_pThread->addItem (m_index.thread (i), i);
+
+  m_pCategory->blockSignals (false);
+  m_pThread->blockSignals (false);
+}
+
+void
+LogAnalyzer::applyFilter ()
+{
+  if (!m_index.isOpen ())
+    return;
+
+  LogIndex::Filter filter;
+  filter.m_maxLevel = m_pLevel->currentData ().toInt ();
+  filter.m_category = m_pCategory->currentData ().toInt ();
+  QString object = m_pObject->text ().trimmed ();
+  if (!object.isEmpty ()) {
+    int row = m_pObjects->stringList ().indexOf (object);
+    /* an unknown name matches no line */
+    filter.m_object = row >= 0 ? row + 1 : m_index.objectCount ();
+  }
+  filter.m_thread = m_pThread->currentData ().toInt ();
+  filter.m_text = m_pText->text ().toUtf8 ();
+
+  std::vector<quint32> lines;
+  m_index.filter (filter, lines);
+  m_pModel->setLines (lines);
+
+  m_pStatus->setText (QString ("%1 of %2 lines")
+                      .arg (m_pModel->rowCount ())
+                      .arg (m_index.lineCount ()));
+}
+
+void
+LogAnalyzer::goToTime ()
+{
+  QByteArray text = m_pTime->text ().trimmed ().toUtf8 ();
+  qint64 timestamp = LogParser::parseTimestamp (
+      LogToken (text.constData (), text.size ()));
+
+  if (timestamp < 0) {
+    m_pStatus->setText ("The time should look like 0:01:23.456");
+    return;
+  }
+
+  size_t row = m_index.findTime (m_pModel->lines (), timestamp);
+  if (row >= m_pModel->lines ().size ()) {
+    m_pStatus->setText ("No line after " + m_pTime->text ());
+    return;
+  }
+
+  QModelIndex index = m_pModel->index (row, LogIndexModel::TimeColumn);
+  m_pView->scrollTo (index, QAbstractItemView::PositionAtTop);
+  m_pView->setCurrentIndex (index);
+}
+
+void
+LogAnalyzer::categoryActivated (QTreeWidgetItem *item)
+{
+  int index = m_pCategory->findData (item->data (0, Qt::UserRole));
+  if (index >= 0)
+    m_pCategory->setCurrentIndex (index);
+}
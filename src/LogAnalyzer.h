@@ -0,0 +1,89 @@
+#ifndef LOG_ANALYZER_H_
+#define LOG_ANALYZER_H_
+
+#include <QAbstractTableModel>
+#include <QDialog>
+#include <QFutureWatcher>
+
+#include <vector>
+
+#include "LogIndex.h"
+
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QStringListModel;
+class QTableView;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+/* The filtered lines of a LogIndex, the columns are parsed from the
+ * mapping when they are shown. */
+class LogIndexModel: public QAbstractTableModel
+{
+public:
+  enum Column
+  {
+    TimeColumn,
+    ThreadColumn,
+    LevelColumn,
+    CategoryColumn,
+    ObjectColumn,
+    MessageColumn,
+    ColumnCount
+  };
+
+  LogIndexModel(const LogIndex *index, QObject *parent = 0);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  QVariant headerData(int section, Qt::Orientation orientation,
+      int role = Qt::DisplayRole) const;
+
+  /* takes the content of lines */
+  void setLines(std::vector<quint32> &lines);
+  const std::vector<quint32> &lines() const { return m_lines; }
+
+private:
+  const LogIndex *m_pIndex;
+  std::vector<quint32> m_lines;
+};
+
+/* Offline viewer for GST_DEBUG log files, whatever their size */
+class LogAnalyzer: public QDialog
+{
+  Q_OBJECT
+public:
+  LogAnalyzer(QWidget *pwgt = NULL, Qt::WindowFlags f = Qt::Window);
+  ~LogAnalyzer();
+
+  void openFile(const QString &fileName);
+
+private slots:
+  void indexReady();
+  void applyFilter();
+  void goToTime();
+  void categoryActivated(QTreeWidgetItem *item);
+
+private:
+  void fillFilters();
+
+  LogIndex m_index;
+  LogIndexModel *m_pModel;
+  QFutureWatcher<bool> m_watcher;
+  QString m_error;
+
+  QComboBox *m_pLevel;
+  QComboBox *m_pCategory;
+  QLineEdit *m_pObject;
+  QStringListModel *m_pObjects;
+  QComboBox *m_pThread;
+  QLineEdit *m_pText;
+  QLineEdit *m_pTime;
+  QTableView *m_pView;
+  QTreeWidget *m_pCategories;
+  QLabel *m_pStatus;
+};
+
+#endif
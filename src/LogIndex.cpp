@@ -0,0 +1,405 @@
+#include "LogIndex.h"
+
+#include <QByteArrayMatcher>
+#include <QThread>
+
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+#include <gst/gst.h>
+
+#include "Logger.h"
+
+/* smaller chunks are not worth a thread */
+#define LOG_INDEX_MIN_CHUNK (4 * 1024 * 1024)
+
+namespace
+{
+  struct TokenHash
+  {
+    size_t
+    operator() (const LogToken &token) const
+    {
+      /* FNV-1a */
+      size_t hash = 2166136261u;
+      for (int i = 0; i < token.m_size; i++)
+        hash = (hash ^ (uchar) token.m_data[i]) * 16777619u;
+      return hash;
+    }
+  };
+
+  struct TokenEqual
+  {
+    bool
+    operator() (const LogToken &a, const LogToken &b) const
+    {
+      return a.m_size == b.m_size && memcmp (a.m_data, b.m_data, a.m_size) == 0;
+    }
+  };
+
+  /* Names are interned by their position in the mapping, nothing is copied.
+   * Runs of lines from the same thread or category are common, so the last
+   * lookup is checked before hashing. */
+  class NameTable
+  {
+  public:
+    NameTable ()
+    : m_last (0)
+    {
+      add (LogToken ());
+    }
+
+    quint32
+    intern (const LogToken &token)
+    {
+      if (TokenEqual () (token, m_names[m_last]))
+        return m_last;
+
+      std::unordered_map<LogToken, quint32, TokenHash, TokenEqual>::iterator it
+          = m_ids.find (token);
+      m_last = (it != m_ids.end ()) ? it->second : add (token);
+      return m_last;
+    }
+
+    const std::vector<LogToken> &
+    names () const
+    {
+      return m_names;
+    }
+
+  private:
+    quint32
+    add (const LogToken &token)
+    {
+      quint32 id = m_names.size ();
+      m_names.push_back (token);
+      m_ids[token] = id;
+      return id;
+    }
+
+    std::unordered_map<LogToken, quint32, TokenHash, TokenEqual> m_ids;
+    std::vector<LogToken> m_names;
+    quint32 m_last;
+  };
+
+  struct Chunk
+  {
+    const char *m_begin;
+    const char *m_end;
+    std::vector<LogIndexEntry> m_entries;
+    NameTable m_categories;
+    NameTable m_objects;
+    NameTable m_threads;
+  };
+
+  void
+  indexChunk (const char *data, Chunk *chunk)
+  {
+    GstLogFields fields;
+    qint64 timestamp = -1;
+
+    /* a rough guess of 150 bytes per line saves most reallocations */
+    chunk->m_entries.reserve ((chunk->m_end - chunk->m_begin) / 150);
+
+    for (const char *line = chunk->m_begin; line < chunk->m_end;) {
+      const char *end = LogParser::findLineEnd (line, chunk->m_end);
+      LogIndexEntry entry;
+
+      entry.m_offset = line - data;
+      entry.m_length = end - line;
+
+      if (LogParser::parseLine (line, end - line, fields)) {
+        qint64 parsed = LogParser::parseTimestamp (fields.m_timestamp);
+        if (parsed >= 0)
+          timestamp = parsed;
+        entry.m_level = LogParser::parseLevel (fields.m_level);
+        entry.m_category = chunk->m_categories.intern (fields.m_category);
+        entry.m_object = chunk->m_objects.intern (fields.m_object);
+        entry.m_thread = chunk->m_threads.intern (fields.m_thread);
+      }
+      else {
+        entry.m_level = GST_LEVEL_NONE;
+        entry.m_category = 0;
+        entry.m_object = 0;
+        entry.m_thread = 0;
+      }
+      entry.m_timestamp = timestamp;
+
+      chunk->m_entries.push_back (entry);
+      if (end == chunk->m_end)
+        break;
+      line = end + 1;
+    }
+  }
+
+  /* local id of a chunk to the id of the whole index */
+  std::vector<quint32>
+  mergeNames (const NameTable &local, NameTable &global)
+  {
+    const std::vector<LogToken> &names = local.names ();
+    std::vector<quint32> ids (names.size ());
+
+    for (size_t i = 0; i < names.size (); i++)
+      ids[i] = global.intern (names[i]);
+    return ids;
+  }
+
+  int
+  threadCount (qint64 size)
+  {
+    qint64 count = qMax<qint64> (1, size / LOG_INDEX_MIN_CHUNK);
+    return qMin<qint64> (count, qMax (1, QThread::idealThreadCount ()));
+  }
+}
+
+LogIndex::LogIndex ()
+: m_data (NULL),
+m_size (0)
+{
+}
+
+LogIndex::~LogIndex ()
+{
+  close ();
+}
+
+bool
+LogIndex::open (const QString &fileName, QString &error)
+{
+  close ();
+
+  m_file.setFileName (fileName);
+  if (!m_file.open (QIODevice::ReadOnly)) {
+    error = m_file.errorString ();
+    return false;
+  }
+
+  m_size = m_file.size ();
+  if (m_size > 0) {
+    m_data = (const char *) m_file.map (0, m_size);
+    if (!m_data) {
+      error = "Cannot map the file: " + m_file.errorString ();
+      m_file.close ();
+      return false;
+    }
+  }
+  else
+    m_data = "";
+
+#ifdef Q_OS_UNIX
+  /* every page is read once, in order */
+  if (m_size > 0)
+    posix_madvise ((void *) m_data, m_size, POSIX_MADV_SEQUENTIAL);
+#endif
+
+  /* split on line boundaries, one chunk per thread */
+  int count = threadCount (m_size);
+  std::vector<Chunk> chunks (count);
+  const char *end = m_data + m_size;
+  const char *pos = m_data;
+
+  for (int i = 0; i < count; i++) {
+    chunks[i].m_begin = pos;
+    if (i == count - 1)
+      pos = end;
+    else {
+      pos = std::max (pos, m_data + m_size / count * (i + 1));
+      pos = LogParser::findLineEnd (pos, end);
+      if (pos < end)
+        pos++;
+    }
+    chunks[i].m_end = pos;
+  }
+
+  std::vector<std::thread> workers;
+  for (int i = 1; i < count; i++)
+    workers.push_back (std::thread (indexChunk, m_data, &chunks[i]));
+  indexChunk (m_data, &chunks[0]);
+  for (size_t i = 0; i < workers.size (); i++)
+    workers[i].join ();
+
+  size_t total = 0;
+  for (int i = 0; i < count; i++)
+    total += chunks[i].m_entries.size ();
+  m_entries.reserve (total);
+
+  NameTable categories;
+  NameTable objects;
+  NameTable threads;
+  qint64 timestamp = -1;
+
+  for (int i = 0; i < count; i++) {
+    Chunk &chunk = chunks[i];
+    std::vector<quint32> categoryIds = mergeNames (chunk.m_categories, categories);
+    std::vector<quint32> objectIds = mergeNames (chunk.m_objects, objects);
+    std::vector<quint32> threadIds = mergeNames (chunk.m_threads, threads);
+
+    for (size_t j = 0; j < chunk.m_entries.size (); j++) {
+      LogIndexEntry entry = chunk.m_entries[j];
+      entry.m_category = categoryIds[entry.m_category];
+      entry.m_object = objectIds[entry.m_object];
+      entry.m_thread = threadIds[entry.m_thread];
+
+      /* the leading lines of a chunk which are not records take the time
+       * of the end of the previous one */
+      if (entry.m_timestamp < 0)
+        entry.m_timestamp = timestamp;
+      else
+        timestamp = entry.m_timestamp;
+
+      m_entries.push_back (entry);
+    }
+
+    std::vector<LogIndexEntry> ().swap (chunk.m_entries);
+  }
+
+  m_categories = categories.names ();
+  m_objects = objects.names ();
+  m_threads = threads.names ();
+
+  m_categoryLines.assign (m_categories.size (), 0);
+  for (size_t i = 0; i < m_entries.size (); i++)
+    m_categoryLines[m_entries[i].m_category]++;
+
+#ifdef Q_OS_UNIX
+  /* lines are read back in any order from now on */
+  if (m_size > 0)
+    posix_madvise ((void *) m_data, m_size, POSIX_MADV_RANDOM);
+#endif
+
+  LOG_INFO("Indexed %u lines of %s on %d threads", (unsigned) m_entries.size (),
+           fileName.toStdString ().c_str (), count);
+
+  return true;
+}
+
+void
+LogIndex::close ()
+{
+  std::vector<LogIndexEntry> ().swap (m_entries);
+  m_categories.clear ();
+  m_categoryLines.clear ();
+  m_objects.clear ();
+  m_threads.clear ();
+
+  if (m_file.isOpen ())
+    m_file.close ();
+  m_data = NULL;
+  m_size = 0;
+}
+
+LogToken
+LogIndex::text (quint32 line) const
+{
+  const LogIndexEntry &item = m_entries[line];
+  return LogToken (m_data + item.m_offset, item.m_length);
+}
+
+bool
+LogIndex::fields (quint32 line, GstLogFields &fields) const
+{
+  LogToken token = text (line);
+  return LogParser::parseLine (token.m_data, token.m_size, fields);
+}
+
+namespace
+{
+  struct FilterSlice
+  {
+    const LogIndex *m_index;
+    const LogIndex::Filter *m_filter;
+    quint32 m_begin;
+    quint32 m_end;
+    std::vector<quint32> m_lines;
+  };
+
+  void
+  filterSlice (FilterSlice *slice)
+  {
+    const LogIndex::Filter &filter = *slice->m_filter;
+    QByteArrayMatcher matcher (filter.m_text);
+
+    for (quint32 i = slice->m_begin; i < slice->m_end; i++) {
+      const LogIndexEntry &entry = slice->m_index->entry (i);
+
+      if (filter.m_maxLevel >= 0 && entry.m_level > filter.m_maxLevel)
+        continue;
+      if (filter.m_category >= 0
+          && (int) entry.m_category != filter.m_category)
+        continue;
+      if (filter.m_object >= 0 && (int) entry.m_object != filter.m_object)
+        continue;
+      if (filter.m_thread >= 0 && (int) entry.m_thread != filter.m_thread)
+        continue;
+      if (!filter.m_text.isEmpty ()) {
+        LogToken text = slice->m_index->text (i);
+        if (matcher.indexIn (text.m_data, text.m_size) < 0)
+          continue;
+      }
+
+      slice->m_lines.push_back (i);
+    }
+  }
+}
+
+void
+LogIndex::filter (const Filter &filter, std::vector<quint32> &lines) const
+{
+  quint32 total = lineCount ();
+  int count = qMax (1, qMin<int> (QThread::idealThreadCount (),
+                                  total / (64 * 1024)));
+  std::vector<FilterSlice> slices (count);
+
+  for (int i = 0; i < count; i++) {
+    slices[i].m_index = this;
+    slices[i].m_filter = &filter;
+    slices[i].m_begin = (quint64) total * i / count;
+    slices[i].m_end = (quint64) total * (i + 1) / count;
+  }
+
+  std::vector<std::thread> workers;
+  for (int i = 1; i < count; i++)
+    workers.push_back (std::thread (filterSlice, &slices[i]));
+  filterSlice (&slices[0]);
+  for (size_t i = 0; i < workers.size (); i++)
+    workers[i].join ();
+
+  lines.clear ();
+  size_t matched = 0;
+  for (int i = 0; i < count; i++)
+    matched += slices[i].m_lines.size ();
+  lines.reserve (matched);
+
+  for (int i = 0; i < count; i++)
+    lines.insert (lines.end (), slices[i].m_lines.begin (),
+                  slices[i].m_lines.end ());
+}
+
+namespace
+{
+  struct TimestampLess
+  {
+    TimestampLess (const LogIndex *index): m_index (index) {}
+
+    bool
+    operator() (quint32 line, qint64 timestamp) const
+    {
+      return m_index->entry (line).m_timestamp < timestamp;
+    }
+
+    const LogIndex *m_index;
+  };
+}
+
+size_t
+LogIndex::findTime (const std::vector<quint32> &lines, qint64 timestamp) const
+{
+  /* the records of a log are written in time order */
+  return std::lower_bound (lines.begin (), lines.end (), timestamp,
+                           TimestampLess (this)) - lines.begin ();
+}
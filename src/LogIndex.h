@@ -0,0 +1,83 @@
+#ifndef LOG_INDEX_H_
+#define LOG_INDEX_H_
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+
+#include <vector>
+
+#include "LogParser.h"
+
+/* One line of the file, the text itself stays in the mapping */
+struct LogIndexEntry
+{
+  quint64 m_offset;
+  qint64 m_timestamp;   /* nanoseconds, the previous one for other lines */
+  quint32 m_length;
+  quint32 m_object;     /* 0 for none */
+  quint32 m_category;   /* 0 for lines which are not debug records */
+  quint32 m_thread;
+  quint8 m_level;       /* GstDebugLevel */
+};
+
+/* Index of a GST_DEBUG log file. The file is mapped rather than read, and
+ * it is indexed in chunks on all the cores, so multi-GB logs only cost the
+ * index in memory: 40 bytes per line. */
+class LogIndex
+{
+public:
+  struct Filter
+  {
+    Filter(): m_maxLevel(-1), m_category(-1), m_object(-1), m_thread(-1) {}
+
+    int m_maxLevel;     /* -1 for any level */
+    int m_category;     /* ids, -1 for any */
+    int m_object;
+    int m_thread;
+    QByteArray m_text;  /* case sensitive substring of the line */
+  };
+
+  LogIndex();
+  ~LogIndex();
+
+  bool open(const QString &fileName, QString &error);
+  void close();
+  bool isOpen() const { return m_data != NULL; }
+  QString fileName() const { return m_file.fileName(); }
+
+  quint32 lineCount() const { return m_entries.size(); }
+  const LogIndexEntry &entry(quint32 line) const { return m_entries[line]; }
+  LogToken text(quint32 line) const;
+  bool fields(quint32 line, GstLogFields &fields) const;
+
+  int categoryCount() const { return m_categories.size(); }
+  QString category(int id) const { return m_categories[id].toString(); }
+  quint64 categoryLines(int id) const { return m_categoryLines[id]; }
+  int objectCount() const { return m_objects.size(); }
+  QString object(int id) const { return m_objects[id].toString(); }
+  int threadCount() const { return m_threads.size(); }
+  QString thread(int id) const { return m_threads[id].toString(); }
+
+  /* the lines matching the filter, in file order */
+  void filter(const Filter &filter, std::vector<quint32> &lines) const;
+  /* position in lines of the first one at or after timestamp */
+  size_t findTime(const std::vector<quint32> &lines, qint64 timestamp) const;
+
+private:
+  LogIndex(const LogIndex &);
+  LogIndex &operator=(const LogIndex &);
+
+  QFile m_file;
+  const char *m_data;
+  qint64 m_size;
+
+  std::vector<LogIndexEntry> m_entries;
+  /* the names point into the mapping, id 0 is the empty name */
+  std::vector<LogToken> m_categories;
+  std::vector<quint64> m_categoryLines;
+  std::vector<LogToken> m_objects;
+  std::vector<LogToken> m_threads;
+};
+
+#endif
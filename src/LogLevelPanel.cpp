@@ -0,0 +1,253 @@
+#include "LogLevelPanel.h"
+
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include <gst/gst.h>
+
+#include "CustomSettings.h"
+
+#define BURST_DEFAULT_DURATION 10
+
+enum {
+  CATEGORY_COLUMN,
+  LEVEL_COLUMN,
+  RATE_COLUMN,
+  DESCRIPTION_COLUMN
+};
+
+LogLevelPanel::LogLevelPanel (QWidget *parent)
+: QWidget (parent)
+{
+  m_threshold = CustomSettings::lastGstDebugString ().section ('=', 1);
+
+  m_pThreshold = new QLineEdit (m_threshold);
+  m_pThreshold->setToolTip ("GST_DEBUG thresholds, e.g. *:2,queue:5");
+  QPushButton *papply = new QPushButton ("Apply");
+
+  QHBoxLayout *phblayThreshold = new QHBoxLayout;
+  phblayThreshold->addWidget (new QLabel ("GST_DEBUG"));
+  phblayThreshold->addWidget (m_pThreshold, 1);
+  phblayThreshold->addWidget (papply);
+
+  m_pCategories = new QTreeWidget;
+  m_pCategories->setHeaderLabels (QStringList () << "Category" << "Level"
+                                  << "Records/s" << "Description");
+  m_pCategories->setRootIsDecorated (false);
+  m_pCategories->setSelectionMode (QAbstractItemView::ExtendedSelection);
+  m_pCategories->setUniformRowHeights (true);
+  m_pCategories->setSortingEnabled (true);
+  m_pCategories->sortItems (RATE_COLUMN, Qt::DescendingOrder);
+
+  m_pLevel = new QComboBox;
+  for (int level = GST_LEVEL_NONE; level <= GST_LEVEL_TRACE; level++)
+    m_pLevel->addItem (gst_debug_level_get_name ((GstDebugLevel) level), level);
+  m_pLevel->setCurrentIndex (m_pLevel->findData (GST_LEVEL_LOG));
+
+  QPushButton *pset = new QPushButton ("Set Selected");
+  pset->setToolTip ("Set the level of the selected categories");
+
+  m_pBurstDuration = new QSpinBox;
+  m_pBurstDuration->setRange (1, 3600);
+  m_pBurstDuration->setValue (BURST_DEFAULT_DURATION);
+  m_pBurstDuration->setSuffix (" s");
+
+  m_pBurst = new QPushButton ("Burst");
+  m_pBurst->setToolTip ("Raise the selected categories, or all of them, "
+                        "to the level for a while");
+  m_pBurstStatus = new QLabel;
+
+  QHBoxLayout *phblayLevel = new QHBoxLayout;
+  phblayLevel->addWidget (m_pLevel);
+  phblayLevel->addWidget (pset);
+  phblayLevel->addStretch (1);
+  phblayLevel->addWidget (m_pBurstDuration);
+  phblayLevel->addWidget (m_pBurst);
+  phblayLevel->addWidget (m_pBurstStatus);
+
+  QVBoxLayout *playout = new QVBoxLayout;
+  playout->setContentsMargins (0, 0, 0, 0);
+  playout->addLayout (phblayThreshold);
+  playout->addWidget (m_pCategories, 1);
+  playout->addLayout (phblayLevel);
+  setLayout (playout);
+
+  m_pBurstTimer = new QTimer (this);
+  m_pBurstTimer->setSingleShot (true);
+  m_pBurstTick = new QTimer (this);
+  m_pBurstTick->setInterval (1000);
+
+  connect (papply, SIGNAL (clicked ()), SLOT (applyThreshold ()));
+  connect (m_pThreshold, SIGNAL (returnPressed ()), SLOT (applyThreshold ()));
+  connect (pset, SIGNAL (clicked ()), SLOT (setSelectedLevel ()));
+  connect (m_pBurst, SIGNAL (clicked ()), SLOT (startBurst ()));
+  connect (m_pBurstTimer, SIGNAL (timeout ()), SLOT (endBurst ()));
+  connect (m_pBurstTick, SIGNAL (timeout ()), SLOT (burstTick ()));
+
+  refreshCategories ();
+}
+
+void
+LogLevelPanel::refreshCategories ()
+{
+  /* plugins register their categories when they are loaded */
+  GSList *categories = gst_debug_get_all_categories ();
+
+  for (GSList *l = categories; l != NULL; l = l->next) {
+    GstDebugCategory *category = (GstDebugCategory *) l->data;
+    QString name = gst_debug_category_get_name (category);
+
+    QTreeWidgetItem *pitem = m_items.value (name);
+    if (!pitem) {
+      pitem = new QTreeWidgetItem (m_pCategories);
+      pitem->setText (CATEGORY_COLUMN, name);
+      pitem->setData (RATE_COLUMN, Qt::DisplayRole, 0);
+      pitem->setText (DESCRIPTION_COLUMN,
+                      gst_debug_category_get_description (category));
+      m_items[name] = pitem;
+    }
+
+    pitem->setText (LEVEL_COLUMN, gst_debug_level_get_name (
+                        gst_debug_category_get_threshold (category)));
+  }
+
+  g_slist_free (categories);
+}
+
+void
+LogLevelPanel::updateRates (const CategoryRates &rates)
+{
+  refreshCategories ();
+
+  QHash<QString, QTreeWidgetItem *>::iterator it;
+  for (it = m_items.begin (); it != m_items.end (); ++it)
+    it.value ()->setData (RATE_COLUMN, Qt::DisplayRole, rates.value (it.key ()));
+
+  /* categories outside of GStreamer, pipeviz's own */
+  CategoryRates::const_iterator rate;
+  for (rate = rates.begin (); rate != rates.end (); ++rate) {
+    if (m_items.contains (rate.key ()))
+      continue;
+
+    QTreeWidgetItem *pitem = new QTreeWidgetItem (m_pCategories);
+    pitem->setText (CATEGORY_COLUMN, rate.key ());
+    pitem->setData (RATE_COLUMN, Qt::DisplayRole, rate.value ());
+    m_items[rate.key ()] = pitem;
+  }
+}
+
+QStringList
+LogLevelPanel::selectedCategories () const
+{
+  QStringList names;
+  QList<QTreeWidgetItem *> items = m_pCategories->selectedItems ();
+
+  for (int i = 0; i < items.size (); i++) {
+    if (!items[i]->text (LEVEL_COLUMN).isEmpty ())
+      names.append (items[i]->text (CATEGORY_COLUMN));
+  }
+
+  return names;
+}
+
+void
+LogLevelPanel::restoreThresholds ()
+{
+  gst_debug_set_threshold_from_string (m_threshold.toUtf8 ().constData (),
+                                       TRUE);
+  for (int i = 0; i < m_overrides.size (); i++)
+    gst_debug_set_threshold_for_name (m_overrides[i].first.toUtf8 ().constData (),
+                                      (GstDebugLevel) m_overrides[i].second);
+  Logger::instance ().applyPinnedThresholds ();
+
+  refreshCategories ();
+}
+
+void
+LogLevelPanel::applyThreshold ()
+{
+  m_threshold = m_pThreshold->text ().trimmed ();
+  m_overrides.clear ();
+
+  CustomSettings::saveGstDebugString ("GST_DEBUG=" + m_threshold);
+
+  /* a burst in progress ends with the new thresholds */
+  if (!m_pBurstTimer->isActive ())
+    restoreThresholds ();
+
+  LOG_INFO("GStreamer debug thresholds set to %s",
+           m_threshold.toStdString ().c_str ());
+}
+
+void
+LogLevelPanel::setSelectedLevel ()
+{
+  int level = m_pLevel->currentData ().toInt ();
+  QStringList names = selectedCategories ();
+
+  for (int i = 0; i < names.size (); i++) {
+    for (int j = m_overrides.size () - 1; j >= 0; j--) {
+      if (m_overrides[j].first == names[i])
+        m_overrides.removeAt (j);
+    }
+
+    m_overrides.append (qMakePair (names[i], level));
+    if (!m_pBurstTimer->isActive ())
+      gst_debug_set_threshold_for_name (names[i].toUtf8 ().constData (),
+                                        (GstDebugLevel) level);
+  }
+
+  refreshCategories ();
+}
+
+void
+LogLevelPanel::startBurst ()
+{
+  int level = m_pLevel->currentData ().toInt ();
+  QStringList names = selectedCategories ();
+
+  if (names.isEmpty ()) {
+    gst_debug_set_threshold_from_string (
+        QString ("*:%1").arg (level).toUtf8 ().constData (), TRUE);
+    Logger::instance ().applyPinnedThresholds ();
+  }
+  else {
+    for (int i = 0; i < names.size (); i++)
+      gst_debug_set_threshold_for_name (names[i].toUtf8 ().constData (),
+                                        (GstDebugLevel) level);
+  }
+
+  /* a second click extends the burst */
+  m_pBurstTimer->start (m_pBurstDuration->value () * 1000);
+  m_pBurstTick->start ();
+  burstTick ();
+  refreshCategories ();
+
+  LOG_INFO("Debug burst at level %d for %d s", level,
+           m_pBurstDuration->value ());
+}
+
+void
+LogLevelPanel::endBurst ()
+{
+  m_pBurstTick->stop ();
+  m_pBurstStatus->clear ();
+  restoreThresholds ();
+
+  LOG_INFO("Debug burst ended");
+}
+
+void
+LogLevelPanel::burstTick ()
+{
+  m_pBurstStatus->setText (QString ("%1 s left")
+                           .arg ((m_pBurstTimer->remainingTime () + 999) / 1000));
+}
@@ -0,0 +1,59 @@
+#ifndef LOG_LEVEL_PANEL_H_
+#define LOG_LEVEL_PANEL_H_
+
+#include <QWidget>
+#include <QHash>
+#include <QList>
+#include <QPair>
+
+#include "Logger.h"
+
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QSpinBox;
+class QTimer;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+/* Changes the GStreamer debug thresholds of the running process and
+ * shows how many records each category produces. */
+class LogLevelPanel: public QWidget
+{
+  Q_OBJECT
+
+public:
+  LogLevelPanel(QWidget *parent = 0);
+
+public slots:
+  void updateRates(const CategoryRates &rates);
+
+private slots:
+  void applyThreshold();
+  void setSelectedLevel();
+  void startBurst();
+  void endBurst();
+  void burstTick();
+
+private:
+  void restoreThresholds();
+  void refreshCategories();
+  QStringList selectedCategories() const;
+
+  /* what was applied from the panel, restored after a burst */
+  QString m_threshold;
+  QList<QPair<QString, int> > m_overrides;
+
+  QLineEdit *m_pThreshold;
+  QTreeWidget *m_pCategories;
+  QHash<QString, QTreeWidgetItem *> m_items;
+  QComboBox *m_pLevel;
+  QSpinBox *m_pBurstDuration;
+  QPushButton *m_pBurst;
+  QLabel *m_pBurstStatus;
+  QTimer *m_pBurstTimer;
+  QTimer *m_pBurstTick;
+};
+
+#endif
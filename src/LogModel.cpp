@@ -0,0 +1,318 @@
+#include "LogModel.h"
+
+#include <QBrush>
+#include <QTimer>
+
+#include <algorithm>
+#include <iterator>
+
+#include <gst/gst.h>
+
+#define LOG_MODEL_FLUSH_INTERVAL 16
+
+namespace
+{
+  /* "queue3:src" belongs to queue3 */
+  QString
+  elementOf (const QString &object)
+  {
+    int colon = object.indexOf (':');
+    return colon < 0 ? object : object.left (colon);
+  }
+}
+
+LogModel::LogModel (int capacity, QObject *parent)
+: QAbstractListModel (parent),
+m_capacity (capacity),
+m_entries (capacity),
+m_first (0),
+m_count (0),
+m_firstSequence (0),
+m_nextSequence (0),
+m_pFilterRows (NULL)
+{
+  m_pFlushTimer = new QTimer (this);
+  m_pFlushTimer->setSingleShot (true);
+  m_pFlushTimer->setInterval (LOG_MODEL_FLUSH_INTERVAL);
+  connect (m_pFlushTimer, SIGNAL (timeout ()), SLOT (flush ()));
+}
+
+int
+LogModel::rowCount (const QModelIndex &parent) const
+{
+  if (parent.isValid ())
+    return 0;
+
+  if (m_filter.isEmpty ())
+    return m_count;
+
+  return m_pFilterRows ? (int) m_pFilterRows->size () : 0;
+}
+
+const LogModel::Entry &
+LogModel::at (quint64 sequence) const
+{
+  return m_entries[(m_first + (sequence - m_firstSequence)) % m_capacity];
+}
+
+const LogModel::Entry &
+LogModel::entry (int row) const
+{
+  if (m_filter.isEmpty ())
+    return m_entries[(m_first + row) % m_capacity];
+
+  return at ((*m_pFilterRows)[row]);
+}
+
+QVariant
+LogModel::data (const QModelIndex &index, int role) const
+{
+  if (!index.isValid () || index.row () >= rowCount ())
+    return QVariant ();
+
+  const Entry &item = entry (index.row ());
+
+  if (role == Qt::DisplayRole)
+    return item.m_text;
+
+  if (role == Qt::ForegroundRole) {
+    switch (item.m_category) {
+      case eLOG_CATEGORY_INTERNAL:
+        return QBrush (Qt::blue);
+      case eLOG_CATEGORY_GST:
+        return QBrush (Qt::red);
+      default:
+        return QBrush (Qt::black);
+    }
+  }
+
+  return QVariant ();
+}
+
+bool
+LogModel::matchesFilter (const QString &object) const
+{
+  if (m_filter.isEmpty ())
+    return true;
+
+  return m_filter.contains (object) || m_filter.contains (elementOf (object));
+}
+
+void
+LogModel::indexEntry (const Entry &item)
+{
+  if (item.m_object.isEmpty ())
+    return;
+
+  m_objectIndex[item.m_object].push_back (item.m_sequence);
+
+  QString element = elementOf (item.m_object);
+  if (element != item.m_object)
+    m_objectIndex[element].push_back (item.m_sequence);
+}
+
+void
+LogModel::unindexEntry (const Entry &item)
+{
+  if (item.m_object.isEmpty ())
+    return;
+
+  QString keys[2] = { item.m_object, elementOf (item.m_object) };
+  int count = (keys[0] == keys[1]) ? 1 : 2;
+
+  for (int i = 0; i < count; i++) {
+    QHash<QString, std::deque<quint64> >::iterator it = m_objectIndex.find (keys[i]);
+    if (it == m_objectIndex.end ())
+      continue;
+
+    /* records are evicted oldest first, so this one is at the front */
+    it->pop_front ();
+    if (it->empty ())
+      m_objectIndex.erase (it);
+  }
+}
+
+void
+LogModel::updateFilterRows ()
+{
+  m_pFilterRows = NULL;
+  if (m_filter.isEmpty ())
+    return;
+
+  if (m_filter.size () > 1) {
+    m_pFilterRows = &m_mergedRows;
+    return;
+  }
+
+  QHash<QString, std::deque<quint64> >::const_iterator it =
+      m_objectIndex.constFind (*m_filter.begin ());
+  if (it != m_objectIndex.constEnd ())
+    m_pFilterRows = &it.value ();
+}
+
+/* a record of a pad is listed under the pad and its element, both may
+ * be in the filter */
+void
+LogModel::mergeFilterRows ()
+{
+  m_mergedRows.clear ();
+  if (m_filter.size () < 2)
+    return;
+
+  QSet<QString>::const_iterator name;
+  for (name = m_filter.begin (); name != m_filter.end (); ++name) {
+    QHash<QString, std::deque<quint64> >::const_iterator it =
+        m_objectIndex.constFind (*name);
+    if (it == m_objectIndex.constEnd ())
+      continue;
+
+    std::deque<quint64> merged;
+    std::set_union (m_mergedRows.begin (), m_mergedRows.end (),
+                    it->begin (), it->end (), std::back_inserter (merged));
+    m_mergedRows.swap (merged);
+  }
+}
+
+void
+LogModel::setObjectFilter (const QStringList &names)
+{
+  QSet<QString> filter = names.toSet ();
+  if (filter == m_filter)
+    return;
+
+  beginResetModel ();
+  m_filter = filter;
+  mergeFilterRows ();
+  updateFilterRows ();
+  endResetModel ();
+}
+
+QHash<QString, int>
+LogModel::recentProblems (gint64 window)
+{
+  QHash<QString, int> problems;
+  gint64 since = g_get_monotonic_time () - window;
+
+  QHash<QString, Problem>::iterator it = m_problems.begin ();
+  while (it != m_problems.end ()) {
+    if (it->m_error >= since)
+      problems[it.key ()] = GST_LEVEL_ERROR;
+    else if (it->m_warning >= since)
+      problems[it.key ()] = GST_LEVEL_WARNING;
+    else {
+      it = m_problems.erase (it);
+      continue;
+    }
+    ++it;
+  }
+
+  return problems;
+}
+
+void
+LogModel::appendRecords (const QVector<LogRecord> &records)
+{
+  m_pending += records;
+
+  /* only the newest records can end up in the model anyway */
+  if (m_pending.size () > 2 * m_capacity)
+    m_pending.remove (0, m_pending.size () - m_capacity);
+
+  if (!m_pFlushTimer->isActive ())
+    m_pFlushTimer->start ();
+}
+
+void
+LogModel::clear ()
+{
+  beginResetModel ();
+  m_first = 0;
+  m_count = 0;
+  m_firstSequence = m_nextSequence;
+  m_objectIndex.clear ();
+  m_mergedRows.clear ();
+  /* no badge for a record which is gone */
+  m_problems.clear ();
+  m_pending.clear ();
+  updateFilterRows ();
+  endResetModel ();
+}
+
+void
+LogModel::flush ()
+{
+  if (m_pending.isEmpty ())
+    return;
+
+  int skipped = std::max (0, m_pending.size () - m_capacity);
+  int incoming = m_pending.size () - skipped;
+
+  int evicted = std::max (0, m_count + incoming - m_capacity);
+  if (evicted > 0) {
+    int removed = 0;
+    for (int i = 0; i < evicted; i++) {
+      if (matchesFilter (m_entries[(m_first + i) % m_capacity].m_object))
+        removed++;
+    }
+
+    if (removed)
+      beginRemoveRows (QModelIndex (), 0, removed - 1);
+    for (int i = 0; i < evicted; i++)
+      unindexEntry (m_entries[(m_first + i) % m_capacity]);
+    m_first = (m_first + evicted) % m_capacity;
+    m_count -= evicted;
+    m_firstSequence += evicted;
+    while (!m_mergedRows.empty () && m_mergedRows.front () < m_firstSequence)
+      m_mergedRows.pop_front ();
+    updateFilterRows ();
+    if (removed)
+      endRemoveRows ();
+  }
+
+  std::vector<QString> objects;
+  objects.reserve (incoming);
+  int inserted = 0;
+  for (int i = skipped; i < m_pending.size (); i++) {
+    objects.push_back (QString::fromUtf8 (m_pending[i].m_object));
+    if (matchesFilter (objects.back ()))
+      inserted++;
+  }
+
+  const Logger &logger = Logger::instance ();
+  gint64 now = g_get_monotonic_time ();
+  int first = rowCount ();
+
+  if (inserted)
+    beginInsertRows (QModelIndex (), first, first + inserted - 1);
+  for (int i = skipped; i < m_pending.size (); i++) {
+    const LogRecord &record = m_pending[i];
+    Entry &item = m_entries[(m_first + m_count) % m_capacity];
+
+    item.m_sequence = m_nextSequence++;
+    item.m_level = record.m_level;
+    item.m_category = record.m_category;
+    item.m_object = objects[i - skipped];
+    item.m_text = logger.formatRecord (record);
+    indexEntry (item);
+    if (m_filter.size () > 1 && matchesFilter (item.m_object))
+      m_mergedRows.push_back (item.m_sequence);
+    m_count++;
+
+    if (!item.m_object.isEmpty () && (record.m_level == GST_LEVEL_ERROR
+                                      || record.m_level == GST_LEVEL_WARNING)) {
+      Problem &problem = m_problems[elementOf (item.m_object)];
+      gint64 time = (record.m_timestamp >= 0) ? record.m_timestamp : now;
+      if (record.m_level == GST_LEVEL_ERROR)
+        problem.m_error = std::max (problem.m_error, time);
+      else
+        problem.m_warning = std::max (problem.m_warning, time);
+    }
+  }
+  updateFilterRows ();
+  if (inserted)
+    endInsertRows ();
+
+  m_pending.clear ();
+  if (inserted)
+    emit rowsAppended ();
+}
@@ -0,0 +1,100 @@
+#ifndef LOG_MODEL_H_
+#define LOG_MODEL_H_
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include <QString>
+
+#include <deque>
+#include <vector>
+
+#include "Logger.h"
+
+class QTimer;
+
+/* Keeps the last records only, so that the memory stays bounded however
+ * long the pipeline runs. Incoming records are queued and added to the
+ * model in one batch per frame. */
+class LogModel: public QAbstractListModel
+{
+  Q_OBJECT
+
+public:
+  struct Entry
+  {
+    quint64 m_sequence;
+    int m_level;
+    int m_category;
+    QString m_object;
+    QString m_text;
+  };
+
+  LogModel(int capacity, QObject *parent = 0);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+  const Entry &entry(int row) const;
+  int capacity() const { return m_capacity; }
+
+  /* only the records of the objects, or of the elements and their pads,
+   * are shown. Empty shows everything. */
+  void setObjectFilter(const QStringList &names);
+  QStringList objectFilter() const { return m_filter.toList(); }
+
+  /* the worst level, warning or error, each element logged within the
+   * last window microseconds */
+  QHash<QString, int> recentProblems(gint64 window);
+
+public slots:
+  void appendRecords(const QVector<LogRecord> &records);
+  void clear();
+
+signals:
+  void rowsAppended();
+
+private slots:
+  void flush();
+
+private:
+  struct Problem
+  {
+    gint64 m_warning;
+    gint64 m_error;
+  };
+
+  const Entry &at(quint64 sequence) const;
+  bool matchesFilter(const QString &object) const;
+  void indexEntry(const Entry &item);
+  void unindexEntry(const Entry &item);
+  void updateFilterRows();
+  void mergeFilterRows();
+
+  int m_capacity;
+  /* the oldest row is at m_first, the sequences in the ring follow each
+   * other from m_firstSequence */
+  std::vector<Entry> m_entries;
+  int m_first;
+  int m_count;
+  quint64 m_firstSequence;
+  quint64 m_nextSequence;
+
+  /* object and element names to the sequences of their records, oldest
+   * first. Evicting a record only pops the front of its lists. */
+  QHash<QString, std::deque<quint64> > m_objectIndex;
+  QSet<QString> m_filter;
+  const std::deque<quint64> *m_pFilterRows;
+  /* the lists of the names merged, when filtering on several, and kept
+   * up to date as records come and go */
+  std::deque<quint64> m_mergedRows;
+
+  QHash<QString, Problem> m_problems;
+
+  QVector<LogRecord> m_pending;
+  QTimer *m_pFlushTimer;
+};
+
+#endif
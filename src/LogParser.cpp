@@ -0,0 +1,487 @@
+#include "LogParser.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+
+#include <stdio.h>
+
+#include <gst/gst.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LOG_PARSER_X86 1
+#include <immintrin.h>
+#endif
+
+#define LOG_BENCHMARK_SIZE (256 * 1024 * 1024)
+#define LOG_BENCHMARK_RUNS 5
+
+namespace
+{
+  typedef const char *(*FindByteFunc) (const char *, const char *, char);
+
+  /* a plain loop, the reference for the vector ones */
+  inline const char *
+  findByteScalar (const char *begin, const char *end, char c)
+  {
+    for (; begin < end; begin++) {
+      if (*begin == c)
+        return begin;
+    }
+    return end;
+  }
+
+  inline const char *
+  findByteMemchr (const char *begin, const char *end, char c)
+  {
+    const char *found = (const char *) memchr (begin, c, end - begin);
+    return found ? found : end;
+  }
+
+#ifdef LOG_PARSER_X86
+  __attribute__ ((target ("sse2"))) inline const char *
+  findByteSse2 (const char *begin, const char *end, char c)
+  {
+    const __m128i needle = _mm_set1_epi8 (c);
+
+    for (; end - begin >= 16; begin += 16) {
+      __m128i block = _mm_loadu_si128 ((const __m128i *) begin);
+      int mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (block, needle));
+      if (mask)
+        return begin + __builtin_ctz (mask);
+    }
+
+    return findByteScalar (begin, end, c);
+  }
+
+  __attribute__ ((target ("avx2"))) inline const char *
+  findByteAvx2 (const char *begin, const char *end, char c)
+  {
+    const __m256i needle = _mm256_set1_epi8 (c);
+
+    for (; end - begin >= 32; begin += 32) {
+      __m256i block = _mm256_loadu_si256 ((const __m256i *) begin);
+      unsigned mask = _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (block, needle));
+      if (mask)
+        return begin + __builtin_ctz (mask);
+    }
+
+    return findByteSse2 (begin, end, c);
+  }
+#endif
+
+  LogParser::Implementation
+  bestImplementation ()
+  {
+#ifdef LOG_PARSER_X86
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+      return LogParser::Avx2;
+    if (__builtin_cpu_supports ("sse2"))
+      return LogParser::Sse2;
+#endif
+    return LogParser::Memchr;
+  }
+
+  LogParser::Implementation currentImplementation = bestImplementation ();
+
+  Q_ALWAYS_INLINE const char *
+  skipSpaces (const char *pos, const char *end)
+  {
+    while (pos < end && *pos == ' ')
+      pos++;
+    return pos;
+  }
+
+  /* the next space separated word, pos is moved after it */
+  template <FindByteFunc findByte>
+  Q_ALWAYS_INLINE LogToken
+  nextWord (const char *&pos, const char *end)
+  {
+    pos = skipSpaces (pos, end);
+    const char *stop = findByte (pos, end, ' ');
+    LogToken token (pos, stop - pos);
+    pos = stop;
+    return token;
+  }
+
+  Q_ALWAYS_INLINE bool
+  isDigit (char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  /* inlined into one function per implementation, so that the delimiter
+   * searches are inlined as well, with the instructions they need */
+  template <FindByteFunc findByte>
+  Q_ALWAYS_INLINE bool
+  parseLineWith (const char *line, int size, GstLogFields &fields)
+  {
+    const char *pos = line;
+    const char *end = line + size;
+
+    while (end > pos && (end[-1] == '\r' || end[-1] == '\n'))
+      end--;
+
+    fields.m_timestamp = nextWord<findByte> (pos, end);
+    if (fields.m_timestamp.isEmpty () || !isDigit (fields.m_timestamp.m_data[0]))
+      return false;
+
+    LogToken word = nextWord<findByte> (pos, end);
+    if (word.m_size > 2 && word.m_data[0] == '0' && word.m_data[1] == 'x') {
+      fields.m_pid = LogToken ();
+      fields.m_thread = word;
+    }
+    else {
+      fields.m_pid = word;
+      fields.m_thread = nextWord<findByte> (pos, end);
+    }
+
+    fields.m_level = nextWord<findByte> (pos, end);
+    fields.m_category = nextWord<findByte> (pos, end);
+    if (fields.m_category.isEmpty ())
+      return false;
+
+    /* file:line:function:<object> message, the function and the object
+     * may both contain colons */
+    pos = skipSpaces (pos, end);
+    const char *colon = findByte (pos, end, ':');
+    if (colon == end)
+      return false;
+    fields.m_file = LogToken (pos, colon - pos);
+
+    pos = colon + 1;
+    const char *digits = pos;
+    while (pos < end && isDigit (*pos))
+      pos++;
+    if (pos == end || *pos != ':')
+      return false;
+    fields.m_line = LogToken (digits, pos - digits);
+
+    const char *function = ++pos;
+    while (pos < end) {
+      pos = findByte (pos, end, ':');
+      if (pos == end || pos + 1 == end || pos[1] == '<' || pos[1] == ' ')
+        break;
+      pos++;
+    }
+    fields.m_function = LogToken (function, pos - function);
+    if (pos < end)
+      pos++;
+
+    fields.m_object = LogToken ();
+    if (pos < end && *pos == '<') {
+      const char *object = pos + 1;
+      const char *close = object;
+      while ((close = findByte (close, end, '>')) < end) {
+        if (close + 1 == end || close[1] == ' ')
+          break;
+        close++;
+      }
+
+      if (close < end) {
+        fields.m_object = LogToken (object, close - object);
+        pos = close + 1;
+      }
+    }
+
+    pos = skipSpaces (pos, end);
+    fields.m_message = LogToken (pos, end - pos);
+    return true;
+  }
+
+  bool
+  parseLineScalar (const char *line, int size, GstLogFields &fields)
+  {
+    return parseLineWith<findByteScalar> (line, size, fields);
+  }
+
+  bool
+  parseLineMemchr (const char *line, int size, GstLogFields &fields)
+  {
+    return parseLineWith<findByteMemchr> (line, size, fields);
+  }
+
+#ifdef LOG_PARSER_X86
+  __attribute__ ((target ("sse2"))) bool
+  parseLineSse2 (const char *line, int size, GstLogFields &fields)
+  {
+    return parseLineWith<findByteSse2> (line, size, fields);
+  }
+
+  __attribute__ ((target ("avx2"))) bool
+  parseLineAvx2 (const char *line, int size, GstLogFields &fields)
+  {
+    return parseLineWith<findByteAvx2> (line, size, fields);
+  }
+#endif
+}
+
+bool
+LogParser::parseLine (const char *line, int size, GstLogFields &fields)
+{
+  switch (currentImplementation) {
+#ifdef LOG_PARSER_X86
+    case Avx2:
+      return parseLineAvx2 (line, size, fields);
+    case Sse2:
+      return parseLineSse2 (line, size, fields);
+#endif
+    case Memchr:
+      return parseLineMemchr (line, size, fields);
+    default:
+      return parseLineScalar (line, size, fields);
+  }
+}
+
+qint64
+LogParser::parseTimestamp (const LogToken &token)
+{
+  const char *pos = token.m_data;
+  const char *end = token.m_data + token.m_size;
+  qint64 parts[3] = { 0, 0, 0 };
+
+  for (int i = 0; i < 3; i++) {
+    if (pos == end || !isDigit (*pos))
+      return -1;
+    while (pos < end && isDigit (*pos))
+      parts[i] = parts[i] * 10 + (*pos++ - '0');
+
+    char separator = (i < 2) ? ':' : '.';
+    if (pos < end && *pos == separator)
+      pos++;
+    else if (i < 2 || pos != end)
+      return -1;
+  }
+
+  qint64 fraction = 0;
+  int digits = 0;
+  for (; pos < end && isDigit (*pos); pos++, digits++) {
+    if (digits < 9)
+      fraction = fraction * 10 + (*pos - '0');
+  }
+  if (pos != end)
+    return -1;
+  for (; digits < 9; digits++)
+    fraction *= 10;
+
+  return ((parts[0] * 60 + parts[1]) * 60 + parts[2]) * GST_SECOND + fraction;
+}
+
+int
+LogParser::parseLevel (const LogToken &token)
+{
+  static const struct
+  {
+    const char *m_name;
+    int m_level;
+  } levels[] = {
+    { "ERROR", GST_LEVEL_ERROR },
+    { "WARN", GST_LEVEL_WARNING },
+    { "FIXME", GST_LEVEL_FIXME },
+    { "INFO", GST_LEVEL_INFO },
+    { "DEBUG", GST_LEVEL_DEBUG },
+    { "LOG", GST_LEVEL_LOG },
+    { "TRACE", GST_LEVEL_TRACE },
+    { "MEMDUMP", GST_LEVEL_MEMDUMP },
+  };
+
+  for (size_t i = 0; i < G_N_ELEMENTS (levels); i++) {
+    if (token == levels[i].m_name)
+      return levels[i].m_level;
+  }
+
+  return GST_LEVEL_NONE;
+}
+
+QString
+LogParser::formatTimestamp (qint64 timestamp)
+{
+  if (timestamp < 0)
+    return QString ();
+
+  return QString::asprintf ("%u:%02u:%02u.%09u", GST_TIME_ARGS (timestamp));
+}
+
+const char *
+LogParser::findLineEnd (const char *begin, const char *end)
+{
+  return findByte (begin, end, '\n');
+}
+
+const char *
+LogParser::findByte (const char *begin, const char *end, char c)
+{
+  switch (currentImplementation) {
+#ifdef LOG_PARSER_X86
+    case Avx2:
+      return findByteAvx2 (begin, end, c);
+    case Sse2:
+      return findByteSse2 (begin, end, c);
+#endif
+    case Memchr:
+      return findByteMemchr (begin, end, c);
+    default:
+      return findByteScalar (begin, end, c);
+  }
+}
+
+bool
+LogParser::isSupported (Implementation implementation)
+{
+  return implementation <= bestImplementation ();
+}
+
+bool
+LogParser::setImplementation (Implementation implementation)
+{
+  if (!isSupported (implementation))
+    return false;
+
+  currentImplementation = implementation;
+  return true;
+}
+
+LogParser::Implementation
+LogParser::implementation ()
+{
+  return currentImplementation;
+}
+
+const char *
+LogParser::implementationName (Implementation implementation)
+{
+  switch (implementation) {
+    case Avx2:
+      return "avx2";
+    case Sse2:
+      return "sse2";
+    case Memchr:
+      return "memchr";
+    default:
+      return "scalar";
+  }
+}
+
+namespace
+{
+  /* lines shaped like the output of a playing decode pipeline */
+  QByteArray
+  generateLog (int size)
+  {
+    static const char *lines[] = {
+      "%u:%02u:%02u.%09u 12345 0x7f3a2c00a4f0 DEBUG          GST_SCHEDULING "
+      "gstpad.c:4327:gst_pad_chain_data_unchecked:<queue%d:sink> calling "
+      "chainfunction &gst_queue_chain with buffer buffer: 0x7f3a1c0b6d80, "
+      "pts 0:00:01.%09d, dts 99:99:99.999999999, dur 0:00:00.033333333, "
+      "size 4096, offset none, offset_end none, flags 0x0\n",
+      "%u:%02u:%02u.%09u 12345 0x7f3a2c00a640 LOG                  basesink "
+      "gstbasesink.c:3097:gst_base_sink_is_too_late:<videosink%d> object was "
+      "scheduled in time, 0:00:01.%09d\n",
+      "%u:%02u:%02u.%09u 12345 0x7f3a2c00a4f0 INFO            GST_EVENT "
+      "gstevent.c:814:gst_event_new_segment:<demux%d> creating segment event "
+      "time segment start=0:00:00.000000000, offset=0:00:00.000000000, "
+      "stop=99:99:99.999999999, rate=1.000000, time=0:00:00.%09d\n",
+      "%u:%02u:%02u.%09u 12345 0x7f3a2c00a640 WARN         videodecoder "
+      "gstvideodecoder.c:2775:gst_video_decoder_prepare_finish_frame:"
+      "<avdec_h264-%d> decreasing timestamp (0:00:01.%09d < "
+      "0:00:01.200000000)\n",
+    };
+
+    QByteArray data;
+    data.reserve (size + 1024);
+
+    char line[1024];
+    guint64 timestamp = 0;
+    for (int i = 0; data.size () < size; i++) {
+      timestamp += 33333 + (i % 7) * 1000;
+      int len = g_snprintf (line, sizeof(line), lines[i % G_N_ELEMENTS (lines)],
+                            GST_TIME_ARGS (timestamp), i % 4,
+                            (int) (timestamp % GST_SECOND));
+      data.append (line, qMin<int> (len, sizeof(line) - 1));
+    }
+
+    return data;
+  }
+
+  /* returns the number of debug lines, so that nothing is optimized away */
+  quint64
+  tokenize (const char *data, qint64 size)
+  {
+    GstLogFields fields;
+    quint64 records = 0;
+    const char *end = data + size;
+
+    for (const char *line = data; line < end;) {
+      const char *stop = LogParser::findLineEnd (line, end);
+      if (LogParser::parseLine (line, stop - line, fields)
+          && LogParser::parseTimestamp (fields.m_timestamp) >= 0
+          && LogParser::parseLevel (fields.m_level) != GST_LEVEL_NONE)
+        records++;
+
+      if (stop == end)
+        break;
+      line = stop + 1;
+    }
+
+    return records;
+  }
+}
+
+int
+LogParser::benchmark (const QString &fileName)
+{
+  QByteArray generated;
+  QFile file;
+  const char *data;
+  qint64 size;
+
+  if (fileName == "-") {
+    generated = generateLog (LOG_BENCHMARK_SIZE);
+    data = generated.constData ();
+    size = generated.size ();
+  }
+  else {
+    file.setFileName (fileName);
+    if (!file.open (QIODevice::ReadOnly)) {
+      fprintf (stderr, "Cannot open %s\n", fileName.toStdString ().c_str ());
+      return 1;
+    }
+
+    size = file.size ();
+    data = (const char *) file.map (0, size);
+    if (!data) {
+      fprintf (stderr, "Cannot map %s\n", fileName.toStdString ().c_str ());
+      return 1;
+    }
+  }
+
+  Implementation initial = implementation ();
+  /* the first pass brings the file into memory */
+  quint64 records = tokenize (data, size);
+
+  printf ("%lld bytes, %llu records\n", (long long) size,
+          (unsigned long long) records);
+
+  for (int i = Scalar; i <= Avx2; i++) {
+    if (!setImplementation ((Implementation) i))
+      continue;
+
+    qint64 best = -1;
+    for (int run = 0; run < LOG_BENCHMARK_RUNS; run++) {
+      QElapsedTimer timer;
+      timer.start ();
+      if (tokenize (data, size) != records)
+        fprintf (stderr, "%s: records differ\n",
+                 implementationName ((Implementation) i));
+      qint64 elapsed = timer.nsecsElapsed ();
+      if (best < 0 || elapsed < best)
+        best = elapsed;
+    }
+
+    printf ("%-8s %8.3f GB/s\n", implementationName ((Implementation) i),
+            best > 0 ? (double) size / best : 0.0);
+  }
+
+  setImplementation (initial);
+  return 0;
+}
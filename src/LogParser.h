@@ -0,0 +1,80 @@
+#ifndef LOG_PARSER_H_
+#define LOG_PARSER_H_
+
+#include <QString>
+#include <QtGlobal>
+
+#include <string.h>
+
+/* Part of a line, it points into the parsed buffer and owns nothing */
+struct LogToken
+{
+  LogToken(): m_data(0), m_size(0) {}
+  LogToken(const char *data, int size): m_data(data), m_size(size) {}
+
+  bool isEmpty() const { return m_size == 0; }
+  bool operator==(const char *str) const
+  {
+    return (int) strlen(str) == m_size && memcmp(m_data, str, m_size) == 0;
+  }
+  QString toString() const { return QString::fromUtf8(m_data, m_size); }
+
+  const char *m_data;
+  int m_size;
+};
+
+/* The fields of a GST_DEBUG line, as written by gst_debug_log_default:
+ * 0:00:01.234567890 12345 0x1a2b3c WARN category file.c:42:function:<obj> message
+ * The pid is optional, pipeviz's own log file has none. */
+struct GstLogFields
+{
+  LogToken m_timestamp;
+  LogToken m_pid;
+  LogToken m_thread;
+  LogToken m_level;
+  LogToken m_category;
+  LogToken m_file;
+  LogToken m_line;
+  LogToken m_function;
+  LogToken m_object;
+  LogToken m_message;
+};
+
+namespace LogParser
+{
+  /* false if the line does not look like a GStreamer debug line */
+  bool parseLine(const char *line, int size, GstLogFields &fields);
+
+  /* nanoseconds, -1 if the token is not a h:mm:ss.fraction time */
+  qint64 parseTimestamp(const LogToken &token);
+  /* GstDebugLevel, GST_LEVEL_NONE if unknown */
+  int parseLevel(const LogToken &token);
+  QString formatTimestamp(qint64 timestamp);
+
+  /* end of the line starting at begin, end if it is the last one */
+  const char *findLineEnd(const char *begin, const char *end);
+  /* first c in [begin, end), end if there is none */
+  const char *findByte(const char *begin, const char *end, char c);
+
+  /* The delimiters are searched 16 or 32 bytes at a time when the cpu
+   * allows it, with memchr otherwise, the best implementation is picked
+   * at startup. Scalar is a byte loop, for the benchmark. */
+  enum Implementation
+  {
+    Scalar,
+    Memchr,
+    Sse2,
+    Avx2
+  };
+
+  bool isSupported(Implementation implementation);
+  bool setImplementation(Implementation implementation);
+  Implementation implementation();
+  const char *implementationName(Implementation implementation);
+
+  /* Tokenizes every line of the file with each supported implementation
+   * and prints the throughput. "-" tokenizes generated GST_DEBUG output. */
+  int benchmark(const QString &fileName);
+}
+
+#endif
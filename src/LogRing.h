@@ -0,0 +1,94 @@
+#ifndef LOG_RING_H_
+#define LOG_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+/* Bounded ring with any number of producers and a single consumer. A push
+ * never blocks and never allocates: it claims a cell with one compare and
+ * swap and fails when the ring is full. Every cell carries a sequence
+ * number which tells whether it is free for the current lap of the
+ * producers or filled for the consumer. Capacity has to be a power of 2. */
+template <typename T, std::size_t Capacity>
+class MpscRing
+{
+public:
+  MpscRing ()
+  : m_tail (0), m_head (0)
+  {
+    static_assert ((Capacity & (Capacity - 1)) == 0,
+                   "capacity must be a power of 2");
+
+    for (std::size_t i = 0; i < Capacity; i++)
+      m_cells[i].m_sequence.store (i, std::memory_order_relaxed);
+  }
+
+  bool
+  push (const T &value)
+  {
+    Cell *cell;
+    std::size_t pos = m_tail.load (std::memory_order_relaxed);
+
+    for (;;) {
+      cell = &m_cells[pos & (Capacity - 1)];
+      std::size_t sequence = cell->m_sequence.load (std::memory_order_acquire);
+      intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+
+      if (diff == 0) {
+        if (m_tail.compare_exchange_weak (pos, pos + 1,
+                                          std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+        return false;
+      else
+        pos = m_tail.load (std::memory_order_relaxed);
+    }
+
+    cell->m_value = value;
+    cell->m_sequence.store (pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /* only ever called from the consumer thread */
+  bool
+  pop (T &value)
+  {
+    Cell &cell = m_cells[m_head & (Capacity - 1)];
+    std::size_t sequence = cell.m_sequence.load (std::memory_order_acquire);
+
+    if ((intptr_t) sequence - (intptr_t) (m_head + 1) < 0)
+      return false;
+
+    value = cell.m_value;
+    cell.m_sequence.store (m_head + Capacity, std::memory_order_release);
+    m_head++;
+    return true;
+  }
+
+  bool
+  empty () const
+  {
+    const Cell &cell = m_cells[m_head & (Capacity - 1)];
+    return (intptr_t) cell.m_sequence.load (std::memory_order_acquire)
+    - (intptr_t) (m_head + 1) < 0;
+  }
+
+private:
+  struct Cell
+  {
+    std::atomic<std::size_t> m_sequence;
+    T m_value;
+  };
+
+  MpscRing (const MpscRing &);
+  MpscRing &operator= (const MpscRing &);
+
+  Cell m_cells[Capacity];
+  /* producers and the consumer work on separate cache lines */
+  alignas(64) std::atomic<std::size_t> m_tail;
+  alignas(64) std::size_t m_head;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "LogView.h"
+
+#include <QCheckBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QListView>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+#include "LogModel.h"
+
+#define LOG_VIEW_CAPACITY 50000
+
+LogView::LogView (QWidget *parent)
+: QWidget (parent)
+{
+  m_pModel = new LogModel (LOG_VIEW_CAPACITY, this);
+
+  m_pView = new QListView;
+  m_pView->setModel (m_pModel);
+  /* every row has the same height, the view does not measure them */
+  m_pView->setUniformItemSizes (true);
+  m_pView->setSelectionMode (QAbstractItemView::ExtendedSelection);
+
+  m_pFollowTail = new QCheckBox ("Follow tail");
+  m_pFollowTail->setChecked (true);
+
+  QPushButton *pclear = new QPushButton ("Clear");
+
+  m_pFilter = new QLabel;
+
+  QHBoxLayout *ptools = new QHBoxLayout;
+  ptools->addWidget (m_pFollowTail);
+  ptools->addWidget (m_pFilter);
+  ptools->addStretch (1);
+  ptools->addWidget (pclear);
+
+  QVBoxLayout *playout = new QVBoxLayout;
+  playout->setContentsMargins (0, 0, 0, 0);
+  playout->addLayout (ptools);
+  playout->addWidget (m_pView);
+  setLayout (playout);
+
+  connect (m_pModel, SIGNAL (rowsAppended ()), SLOT (rowsAppended ()));
+  connect (m_pFollowTail, SIGNAL (toggled (bool)),
+           SLOT (followTailToggled (bool)));
+  connect (pclear, SIGNAL (clicked ()), m_pModel, SLOT (clear ()));
+}
+
+void
+LogView::appendRecords (const QVector<LogRecord> &records)
+{
+  m_pModel->appendRecords (records);
+}
+
+void
+LogView::rowsAppended ()
+{
+  if (m_pFollowTail->isChecked ())
+    m_pView->scrollToBottom ();
+}
+
+void
+LogView::followTailToggled (bool checked)
+{
+  if (checked)
+    m_pView->scrollToBottom ();
+}
+
+QHash<QString, int>
+LogView::recentProblems (gint64 window)
+{
+  return m_pModel->recentProblems (window);
+}
+
+void
+LogView::setObjectFilter (const QStringList &names)
+{
+  m_pModel->setObjectFilter (names);
+  m_pFilter->setText (names.isEmpty () ? QString ()
+                      : "Showing " + names.join (", "));
+
+  if (m_pFollowTail->isChecked ())
+    m_pView->scrollToBottom ();
+}
@@ -0,0 +1,41 @@
+#ifndef LOG_VIEW_H_
+#define LOG_VIEW_H_
+
+#include <QWidget>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+#include "Logger.h"
+
+class QCheckBox;
+class QLabel;
+class QListView;
+class LogModel;
+
+class LogView: public QWidget
+{
+  Q_OBJECT
+
+public:
+  LogView(QWidget *parent = 0);
+
+  QHash<QString, int> recentProblems(gint64 window);
+
+public slots:
+  void appendRecords(const QVector<LogRecord> &records);
+  /* shows the records of these elements only, all of them if empty */
+  void setObjectFilter(const QStringList &names);
+
+private slots:
+  void rowsAppended();
+  void followTailToggled(bool checked);
+
+private:
+  LogModel *m_pModel;
+  QListView *m_pView;
+  QCheckBox *m_pFollowTail;
+  QLabel *m_pFilter;
+};
+
+#endif
@@ -10,17 +10,17 @@
 
 #include <QDebug>
 #include <QStringList>
-#include <QTime>
 
-#include <assert.h>
-#include <unistd.h>
-#include <thread>
+#include <string.h>
 
-G_LOCK_DEFINE_STATIC(logger);
+#include <gst/gst.h>
+
+#define LOG_BATCH_SIZE 256
+#define LOG_IDLE_WAIT 100
+#define LOG_FILE_BUFFER_SIZE (1024 * 1024)
+#define LOG_LINE_SIZE (LOG_RECORD_MESSAGE_SIZE + 4 * LOG_RECORD_NAME_SIZE + 64)
+#define LOG_RATE_INTERVAL G_USEC_PER_SEC
 
-static long int getThreadID() {
-    return quintptr(QThread::currentThreadId());
-}
 
 void
 Logger::configure_logger ()
@@ -29,14 +29,120 @@ Logger::configure_logger ()
   qputenv(lastGstDebugString.split("=").at(0).toStdString ().c_str(),
           lastGstDebugString.split("=").at(1).toLocal8Bit());
   qputenv("GST_DEBUG_NO_COLOR", QByteArray("1"));
-  qputenv("GST_DEBUG_FILE",     QByteArray("gst_pipeviz.txt"));
+}
+
+static bool
+is_tracer_record (const LogRecord &record)
+{
+  return record.m_category == eLOG_CATEGORY_GST
+      && record.m_level == GST_LEVEL_TRACE
+      && !strcmp (record.m_source, "GST_TRACER");
+}
+
+/* Runs in the thread which logs, so it only copies the record into the
+ * ring and never blocks, the output is left to the logger thread. */
+static void
+gst_log_hook (GstDebugCategory *category, GstDebugLevel level,
+              const gchar *file, const gchar *function, gint line,
+              GObject *object, GstDebugMessage *message, gpointer user_data)
+{
+  Logger *logger = static_cast<Logger*>(user_data);
+  LogRecord record;
+
+  record.m_timestamp = g_get_monotonic_time ();
+  record.m_thread = (quintptr) g_thread_self ();
+  record.m_level = level;
+  record.m_category = eLOG_CATEGORY_GST;
+  record.m_line = line;
+  record.m_sourceId = (quintptr) category;
+
+  g_strlcpy (record.m_source, gst_debug_category_get_name (category),
+             sizeof(record.m_source));
+  g_strlcpy (record.m_file, file ? file : "", sizeof(record.m_file));
+  g_strlcpy (record.m_function, function ? function : "",
+             sizeof(record.m_function));
+
+  record.m_object[0] = '\0';
+  if (object && GST_IS_PAD (object) && GST_OBJECT_PARENT (object))
+    g_snprintf (record.m_object, sizeof(record.m_object), "%s:%s",
+                GST_OBJECT_NAME (GST_OBJECT_PARENT (object)),
+                GST_OBJECT_NAME (object));
+  else if (object && GST_IS_OBJECT (object) && GST_OBJECT_NAME (object))
+    g_strlcpy (record.m_object, GST_OBJECT_NAME (object),
+               sizeof(record.m_object));
+
+  /* GStreamer formats the message into a string it allocates, the
+   * message is opaque so it cannot be formatted into the record */
+  const gchar *text = gst_debug_message_get (message);
+  record.m_truncated = g_strlcpy (record.m_message, text ? text : "",
+                                  sizeof(record.m_message))
+      >= sizeof(record.m_message);
+
+  logger->pushRecord (record);
 }
 
 Logger::Logger()
 : QThread(),
 m_fExit(false),
-m_level(MAX_LOG_LEVEL)
+m_level(MAX_LOG_LEVEL),
+m_dropped(0),
+m_tracerDropped(0),
+m_waiting(false),
+m_rateStart(g_get_monotonic_time ()),
+m_startTime(g_get_monotonic_time ()),
+m_logFile(NULL)
+{
+  qRegisterMetaType<LogRecord>("LogRecord");
+  qRegisterMetaType<QVector<LogRecord> >("QVector<LogRecord>");
+  qRegisterMetaType<CategoryRates>("CategoryRates");
+}
+
+void Logger::attachGstDebug()
+{
+  gst_debug_remove_log_function (gst_debug_log_default);
+  gst_debug_add_log_function (gst_log_hook, this, NULL);
+}
+
+void Logger::setLogFile(const QString& fileName)
+{
+  m_logFileName = fileName;
+}
+
+void Logger::pushRecord(const LogRecord& record)
+{
+  if (!m_ring.push (record)) {
+    m_dropped++;
+    if (is_tracer_record (record))
+      m_tracerDropped++;
+    return;
+  }
+
+  if (m_waiting) {
+    m_wakeLock.lock ();
+    m_wake.wakeOne ();
+    m_wakeLock.unlock ();
+  }
+}
+
+void Logger::pinThreshold(const QString& category, int level)
+{
+  for (int i = 0; i < m_pinnedThresholds.size (); i++) {
+    if (m_pinnedThresholds[i].first == category) {
+      m_pinnedThresholds.removeAt (i);
+      break;
+    }
+  }
+
+  m_pinnedThresholds.append (qMakePair (category, level));
+  applyPinnedThresholds ();
+}
+
+void Logger::applyPinnedThresholds()
 {
+  for (int i = 0; i < m_pinnedThresholds.size (); i++)
+    gst_debug_set_threshold_for_name (
+        m_pinnedThresholds[i].first.toUtf8 ().constData (),
+        (GstDebugLevel) m_pinnedThresholds[i].second);
 }
 
 Logger& Logger::instance()
@@ -47,241 +153,225 @@ Logger& Logger::instance()
 
 void Logger::Quit()
 {
+    gst_debug_remove_log_function (gst_log_hook);
+
     m_fExit = true;
+    m_wakeLock.lock ();
+    m_wake.wakeOne ();
+    m_wakeLock.unlock ();
     wait();
 }
 
-void Logger::createLog(TimeStampFlag flag, const char* format, ...)
-{
-    // first check if we should add the timestamp before the string
-    char* new_fmt = NULL;
-    if (flag == Logger::UseTimeStamp) {
-        QString szTimestamp(QTime::currentTime().toString("HH:mm:ss:zzz"));
-
-        const char* fmt_template = "%s %d 0x%x %s";
-        int len = snprintf(NULL, 0, fmt_template, szTimestamp.toStdString().c_str(), getThreadID(), std::this_thread::get_id(), format);
-        if (len < 0) {
-            // cannot parse the string
-            return;
-        }
-        len++; // add 1 byte for the additional terminating null character
-        new_fmt = static_cast<char*>(malloc(sizeof(char) * len));
-        snprintf(new_fmt, len, fmt_template, szTimestamp.toStdString().c_str(), getThreadID(), std::this_thread::get_id(), format);
-    }
-
-    // create the actual string (timestamp + format...)
-    const char* formatString = new_fmt ? new_fmt : format;
-    assert(formatString);
-
-    va_list aptr;
-    va_start(aptr, format);
-    va_list argcopy; // copy the va_list and use vsnprintf to get the length of the final string
-    va_copy(argcopy, aptr);
-    int len = vsnprintf(NULL, 0, formatString , argcopy);
-    va_end(argcopy);
-    if (len < 0) {
-        // cannot parse the string
-        g_free(new_fmt);
-        va_end(aptr);
-        return;
-    }
-
-    len++; // add 1 byte for the additional terminating null character.
-    char* buffer = static_cast<char*>(malloc(sizeof(char) * len));
-    int actualLen = vsprintf(buffer, formatString, aptr);
-    va_end(aptr);
-    formatString = 0;
-    g_free (new_fmt);
-    if (actualLen < 0) {
-        g_free (buffer);
-        return;
-    }
-    // if lengths are different, our code is bugged
-    assert((actualLen + 1) == len);
-
-    // dump the final string
-    G_LOCK(logger);
-    processLog(buffer);
-    G_UNLOCK(logger);
+/* The level of the LOG_* macros as a GstDebugLevel */
+static const int internalLevels[MAX_LOG_LEVEL + 1] = {
+  GST_LEVEL_ERROR, GST_LEVEL_WARNING, GST_LEVEL_INFO, GST_LEVEL_DEBUG
+};
 
-    // free the buffer and flush the logs
-    g_free(buffer);
+void Logger::createLog(TimeStampFlag flag, int level, const char* file,
+                       int line, const char* function, const char* format, ...)
+{
+    /* formatted in place, nothing is allocated on this path */
+    static thread_local LogRecord record;
+
+    record.m_timestamp = (flag == Logger::UseTimeStamp) ?
+        g_get_monotonic_time () : -1;
+    record.m_thread = quintptr(QThread::currentThreadId());
+    record.m_level = internalLevels[CLAMP (level, 0, MAX_LOG_LEVEL)];
+    record.m_category = eLOG_CATEGORY_INTERNAL;
+    record.m_line = line;
+    record.m_sourceId = 0;
+    g_strlcpy (record.m_source, "pipeviz", sizeof(record.m_source));
+    g_strlcpy (record.m_file, file, sizeof(record.m_file));
+    g_strlcpy (record.m_function, function, sizeof(record.m_function));
+    record.m_object[0] = '\0';
+
+    va_list args;
+    va_start(args, format);
+    /* longer messages are truncated */
+    record.m_truncated = g_vsnprintf (record.m_message, sizeof(record.m_message),
+                                      format, args)
+        >= (int) sizeof(record.m_message);
+    va_end(args);
+
+    pushRecord (record);
 }
 
 void Logger::incrementLogLevel() {
     m_level++;
     if (m_level > MAX_LOG_LEVEL)
         m_level = MAX_LOG_LEVEL;
-    char buffer[32];
-    sprintf(buffer,"logger log level %d\n",m_level);
-    processLog(buffer);
+    LOG_IMPORTANT("logger log level %d", m_level);
 }
 
-void Logger::processLog(const QString& line)
+int Logger::formatRecord(const LogRecord& record, char* buffer, int size) const
 {
-  emit sendLog(line,eLOG_CATEGORY_INTERNAL);
+  if (record.m_timestamp < 0) {
+    int len = g_strlcpy (buffer, record.m_message, size);
+    return len < size ? len : size - 1;
+  }
+
+  gint64 elapsed = record.m_timestamp - m_startTime;
+
+  int len = g_snprintf (buffer, size,
+                        "%d:%02d:%02d.%06d %p %s %s %s:%d:%s:<%s> %s",
+                        (int) (elapsed / G_USEC_PER_SEC / 3600),
+                        (int) (elapsed / G_USEC_PER_SEC / 60 % 60),
+                        (int) (elapsed / G_USEC_PER_SEC % 60),
+                        (int) (elapsed % G_USEC_PER_SEC),
+                        (gpointer) record.m_thread,
+                        gst_debug_level_get_name ((GstDebugLevel) record.m_level),
+                        record.m_source, record.m_file, record.m_line,
+                        record.m_function, record.m_object, record.m_message);
+
+  return len < size ? len : size - 1;
 }
 
-//#define GST_TIME_FORMAT "u:%02u:%02u.%09u"
-#define GST_TIME_FORMAT "%s"
-#define PRINT_FMT " " PID_FMT " " PTR_FMT " %s " CAT_FMT " %s\n"
-
-struct GSTLog {
-  gchar* date;
-  gchar* pid;
-  gchar* level;
-  gchar* category;
-  gchar* file;
-  gchar* line;
-  gchar* function;
-  gchar* obj;
-  gchar* message;
-};
+QString Logger::formatRecord(const LogRecord& record) const
+{
+  char line[LOG_LINE_SIZE];
+  int len = formatRecord (record, line, sizeof(line));
+  return QString::fromUtf8 (line, len);
+}
 
-void Logger::processGstLog(gchar* log)
+void Logger::processRecord(const LogRecord& record, QVector<LogRecord>& batch)
 {
-//  GSTLog gstLog;
-  if(!g_strrstr(log,"WARN") && !g_strrstr(log,"ERROR"))
+  /* keyed by the category pointer, counting does not allocate */
+  QHash<quintptr, CategoryCount>::iterator count =
+      m_categoryCounts.find (record.m_sourceId);
+  if (count == m_categoryCounts.end ()) {
+    CategoryCount item;
+    item.m_name = QString::fromUtf8 (record.m_source);
+    item.m_count = 0;
+    count = m_categoryCounts.insert (record.m_sourceId, item);
+  }
+  count->m_count++;
+
+  if (record.m_category != eLOG_CATEGORY_GST) {
+    batch.append (record);
     return;
-/*  GList* stringList = parseGstLine(log, ' ', 6);
-  GList* l;
-
-  gstLog.date = g_strdup((gchar*)g_list_nth_data(stringList, 0));
-  gstLog.pid = g_strdup((gchar*)g_list_nth_data(stringList, 1));
-  gstLog.level = g_strdup((gchar*)g_list_nth_data(stringList, 2));
-  gstLog.category = g_strdup((gchar*)g_list_nth_data(stringList, 3));
-
-  gstLog.file = g_strdup((gchar*)g_list_nth_data(stringList, 4));
-  gstLog.line = g_strdup((gchar*)g_list_nth_data(stringList, 5));
-  gstLog.function = g_strdup((gchar*)g_list_nth_data(stringList, 6));
-  gstLog.obj = g_strdup((gchar*)g_list_nth_data(stringList, 7));
-
-  QString message = "";
-  for (l = stringList; l != NULL; l = l->next) {
-    message += (gchar*)l->data;
-    message += " ";
   }
-*/
-  emit sendLog(log,eLOG_CATEGORY_GST);
-}
 
-#define MAX_LINE_LENGTH 128
+  if (is_tracer_record (record))
+    m_tracerBatch.append (record);
 
-GList* Logger::parseGstLine(gchar* line, gchar delimiter, int max_fields)
-{
-  int count = 0;
-  size_t pos = 0;
-  char *lineBuffer = NULL;
-
-  gboolean new_string=TRUE;
-  GList* strList = NULL;
-  gint n_fields = 0;
-
-  int maximumLineLength = MAX_LINE_LENGTH;
-
-  if (line == NULL)
-      return NULL;
-
-  do {
-    if (new_string) {
-      if (line[pos] != delimiter) {
-        new_string = FALSE;
-        lineBuffer = (gchar *)malloc(sizeof(char) * maximumLineLength);
-        count=0;
-        lineBuffer[count++] = line[pos];
-      }
-    }
-    else {
-      if (count == MAX_LINE_LENGTH) {
-        maximumLineLength += MAX_LINE_LENGTH;
-        lineBuffer = (gchar*)realloc(lineBuffer, maximumLineLength);
-      }
-      if (line[pos] == delimiter || line[pos] == '\0') {
-        lineBuffer[count] = '\0';
-        new_string= TRUE;
-        strList = g_list_append(strList, g_strdup(lineBuffer));
-        g_free(lineBuffer);
-        n_fields++;
-        if (max_fields != -1 && n_fields == max_fields) {
-          pos++;
-          if (pos < strlen(line))
-            strList = g_list_append(strList, g_strdup(&line[pos]));
-          break;
-        }
-      } else {
-        lineBuffer[count++] = line[pos];
-      }
+  if (m_logFile) {
+    char line[LOG_LINE_SIZE];
+    int len = formatRecord (record, line, sizeof(line));
+    fwrite (line, 1, len, m_logFile);
+    fputc ('\n', m_logFile);
+  }
 
-    }
-    pos++;
-  } while (pos < strlen(line));
+  /* the view only gets the problems, the file has everything */
+  if (record.m_level <= GST_LEVEL_WARNING)
+    batch.append (record);
+}
 
+void Logger::openLogFile()
+{
+  if (m_logFileName.isEmpty ())
+    return;
+
+  m_logFile = fopen (m_logFileName.toLocal8Bit ().constData (), "w");
+  if (!m_logFile) {
+    qDebug() << "Cannot open log file" << m_logFileName;
+    return;
+  }
 
-  return strList;
+  /* written from this thread only, in large blocks */
+  setvbuf (m_logFile, NULL, _IOFBF, LOG_FILE_BUFFER_SIZE);
 }
 
-gchar *Logger::readGstLine(FILE *file)
+void Logger::reportCategoryRates()
 {
-  int count = 0;
-  char ch;
-  char *line = NULL;
-  gchar *lineBuffer = NULL;
-  int maximumLineLength = MAX_LINE_LENGTH;
-
-  if (file == NULL)
-      goto beach;
-
-  lineBuffer = (gchar *)malloc(sizeof(char) * maximumLineLength);
-  if (lineBuffer == NULL)
-    goto beach;
-
-
-  ch = getc(file);
-  while ((ch != '\n') && (ch != EOF)) {
-      if (count == maximumLineLength) {
-          maximumLineLength += MAX_LINE_LENGTH;
-          lineBuffer = (gchar*)realloc(lineBuffer, maximumLineLength);
-          if (lineBuffer == NULL)
-              goto beach;
-      }
-      lineBuffer[count] = ch;
-      count++;
+  gint64 now = g_get_monotonic_time ();
+  gint64 elapsed = now - m_rateStart;
+  if (elapsed < LOG_RATE_INTERVAL)
+    return;
 
-      ch = getc(file);
+  CategoryRates rates;
+  QHash<quintptr, CategoryCount>::iterator it;
+  for (it = m_categoryCounts.begin (); it != m_categoryCounts.end (); ++it) {
+    if (it->m_count) {
+      rates[it->m_name] += (int) (it->m_count * (gint64) G_USEC_PER_SEC / elapsed);
+      it->m_count = 0;
+    }
   }
-  if(count==0)
-    goto beach;
-
-  lineBuffer[count] = '\0';
-  lineBuffer = (gchar*)realloc(lineBuffer, count + 1);
-  line = g_strdup(lineBuffer);
-  //qDebug() << lineBuffer;
-  //qDebug() << line;
-beach:
-  g_free(lineBuffer);
-  return line;
+
+  m_rateStart = now;
+  emit sendCategoryRates(rates);
 }
 
 void Logger::run()
 {
-  FILE* file;
-  gchar* line;
+  LogRecord record;
+  QVector<LogRecord> batch;
+  unsigned reportedDropped = 0;
 
-  file = fopen("gst_pipeviz.txt", "r");
-  if(!file)
-    return;
+  openLogFile ();
 
   while (!m_fExit) {
-    line = readGstLine(file);
-    if (line != NULL) {
-      processGstLog(line);
-      g_free(line);
-    } else
-      usleep(10000);
-  }
+    int count = 0;
+    batch.reserve (LOG_BATCH_SIZE);
+    while (count < LOG_BATCH_SIZE && m_ring.pop (record)) {
+      processRecord (record, batch);
+      count++;
+    }
+
+    unsigned dropped = m_dropped;
+    if (dropped != reportedDropped) {
+      LogRecord notice;
+      memset (&notice, 0, sizeof(notice));
+      notice.m_timestamp = g_get_monotonic_time ();
+      notice.m_level = GST_LEVEL_WARNING;
+      notice.m_category = eLOG_CATEGORY_INTERNAL;
+      g_strlcpy (notice.m_source, "pipeviz", sizeof(notice.m_source));
+      g_snprintf (notice.m_message, sizeof(notice.m_message),
+                  "%u log records dropped, the logger could not keep up",
+                  dropped - reportedDropped);
+      batch.append (notice);
+      reportedDropped = dropped;
+    }
 
-  qDebug() << "Logger closed";
+    /* one queued signal per batch instead of one per line */
+    if (!batch.isEmpty ()) {
+      emit sendLogs(batch);
+      batch = QVector<LogRecord> ();
+    }
+
+    if (!m_tracerBatch.isEmpty ()) {
+      emit sendTracerRecords(m_tracerBatch);
+      m_tracerBatch = QVector<LogRecord> ();
+    }
+
+    reportCategoryRates ();
+
+    if (count)
+      continue;
 
-  fclose(file);
+    if (m_logFile)
+      fflush (m_logFile);
 
+    /* producers only take the lock when they see the flag */
+    m_waiting = true;
+    m_wakeLock.lock ();
+    if (m_ring.empty () && !m_fExit)
+      m_wake.wait (&m_wakeLock, LOG_IDLE_WAIT);
+    m_wakeLock.unlock ();
+    m_waiting = false;
+  }
+
+  /* what came in while quitting */
+  while (m_ring.pop (record))
+    processRecord (record, batch);
+  if (!batch.isEmpty ())
+    emit sendLogs(batch);
+  if (!m_tracerBatch.isEmpty ()) {
+    emit sendTracerRecords(m_tracerBatch);
+    m_tracerBatch = QVector<LogRecord> ();
+  }
+
+  if (m_logFile) {
+    fclose (m_logFile);
+    m_logFile = NULL;
+  }
 }
@@ -9,8 +9,19 @@
 #define LOGGER_H_
 
 #include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QMetaType>
+#include <atomic>
+#include <stdio.h>
 #include "glib.h"
 
+#include "LogRing.h"
+
 enum eLogCategory {
   eLOG_CATEGORY_INTERNAL,
   eLOG_CATEGORY_GST,
@@ -28,6 +39,34 @@ enum eLogCategory {
 #endif
 
 
+#define LOG_RECORD_NAME_SIZE 64
+#define LOG_RECORD_MESSAGE_SIZE 512
+#define LOG_RING_SIZE 4096
+
+/* Fixed size, so that it can be filled from any thread and passed
+ * through the ring by copy, without allocating a record per line. */
+struct LogRecord {
+  gint64 m_timestamp;  /* monotonic, in microseconds */
+  quintptr m_thread;
+  int m_level;         /* GstDebugLevel */
+  int m_category;      /* eLogCategory */
+  int m_line;
+  quintptr m_sourceId; /* GstDebugCategory, 0 for pipeviz */
+  bool m_truncated;    /* the message did not fit */
+  char m_source[LOG_RECORD_NAME_SIZE];  /* debug category */
+  char m_object[LOG_RECORD_NAME_SIZE];
+  char m_file[LOG_RECORD_NAME_SIZE];
+  char m_function[LOG_RECORD_NAME_SIZE];
+  char m_message[LOG_RECORD_MESSAGE_SIZE];
+};
+
+Q_DECLARE_METATYPE(LogRecord)
+
+/* records per second of each debug category which logged any */
+typedef QHash<QString, int> CategoryRates;
+
+Q_DECLARE_METATYPE(CategoryRates)
+
 class Logger : public QThread {
   Q_OBJECT
 public:
@@ -38,44 +77,86 @@ public:
 
   Logger();
   void configure_logger();
+  /* replaces the default GStreamer log output, call after gst_init */
+  void attachGstDebug();
+  /* every GStreamer record is also written there, empty to disable */
+  void setLogFile(const QString& fileName);
+  void pushRecord(const LogRecord& record);
+  /* kept at least at level whatever the thresholds are set to, call
+   * applyPinnedThresholds after resetting them */
+  void pinThreshold(const QString& category, int level);
+  void applyPinnedThresholds();
 
   static Logger& instance();
   void Quit();
 
-  void processLog(const QString& line);
-  void createLog(Logger::TimeStampFlag, const char* format, ...);
+  void createLog(Logger::TimeStampFlag flag, int level, const char* file,
+                 int line, const char* function, const char* format, ...)
+                 G_GNUC_PRINTF(7, 8);
   int getLevel() const { return m_level; }
+  /* GST_TRACER records lost since start because the ring was full */
+  unsigned tracerDropped() const { return m_tracerDropped; }
   void incrementLogLevel();
 
+  int formatRecord(const LogRecord& record, char* buffer, int size) const;
+  QString formatRecord(const LogRecord& record) const;
+
 protected:
-  void processGstLog(gchar* line);
-  gchar* readGstLine(FILE *file);
-  GList* parseGstLine(gchar* line, gchar ch = ' ', int max_field = -1);
+  void processRecord(const LogRecord& record, QVector<LogRecord>& batch);
 
 signals:
-  void sendLog(const QString& message, int category);
+  /* records for the view, delivered once per consumer batch */
+  void sendLogs(const QVector<LogRecord>& records);
+  void sendCategoryRates(const CategoryRates& rates);
+  /* GST_TRACER records, the messages are serialized GstStructures */
+  void sendTracerRecords(const QVector<LogRecord>& records);
 
 private:
   void run();
+  void openLogFile();
+  void reportCategoryRates();
   bool m_fExit;
   int m_level;
+
+  MpscRing<LogRecord, LOG_RING_SIZE> m_ring;
+  std::atomic<unsigned> m_dropped;
+  std::atomic<unsigned> m_tracerDropped;
+  /* only taken to wake the consumer up once it ran out of records */
+  std::atomic<bool> m_waiting;
+  QMutex m_wakeLock;
+  QWaitCondition m_wake;
+
+  /* only used by the logger thread */
+  struct CategoryCount {
+    QString m_name;
+    int m_count;
+  };
+  QHash<quintptr, CategoryCount> m_categoryCounts;
+  gint64 m_rateStart;
+
+  QVector<LogRecord> m_tracerBatch;
+  QList<QPair<QString, int> > m_pinnedThresholds;
+
+  gint64 m_startTime;
+  QString m_logFileName;
+  FILE* m_logFile;
 };
 
-#define log_debug(LEVEL,TYPE,FMT, ARGS...) do { \
+#define log_debug(LEVEL,FMT, ARGS...) do { \
     if (LEVEL <= Logger::instance().getLevel()) \
-        Logger::instance().createLog(Logger::UseTimeStamp, "" TYPE ": " FMT "", ## ARGS); \
+        Logger::instance().createLog(Logger::UseTimeStamp, LEVEL, CLASS_LOGGER_TAG, __LINE__, __func__, FMT, ## ARGS); \
     } while (0)
-#define log_debug_no_time_stderr(LEVEL,TYPE,FMT, ARGS...) do { \
-        Logger::instance().createLog(Logger::NoTimeStamp, "" FMT "", ## ARGS); \
+#define log_debug_no_time_stderr(LEVEL,FMT, ARGS...) do { \
+        Logger::instance().createLog(Logger::NoTimeStamp, LEVEL, CLASS_LOGGER_TAG, __LINE__, __func__, FMT, ## ARGS); \
     } while (0)
 
-#define LOG_IMPORTANT(FMT, ARGS...) log_debug_no_time_stderr(0, "",FMT ,## ARGS)
+#define LOG_IMPORTANT(FMT, ARGS...) log_debug_no_time_stderr(0, FMT ,## ARGS)
 
 #ifndef DISABLE_LOG
-#   define LOG_ERROR(FMT, ARGS...) log_debug(0, "ERROR\t" CLASS_LOGGER_TAG ":%d:%s", FMT,__LINE__, __func__, ## ARGS)
-#   define LOG_WARNING(FMT, ARGS...) log_debug(1, "WARN\t" CLASS_LOGGER_TAG ":%d:%s", FMT, __LINE__, __func__, ## ARGS)
-#   define LOG_INFO(FMT, ARGS...) log_debug(2, "INFO\t" CLASS_LOGGER_TAG ":%d:%s", FMT, __LINE__, __func__, ## ARGS)
-#   define LOG_DEBUG(FMT, ARGS...) log_debug(3, "DEBUG\t" CLASS_LOGGER_TAG ":%d:%s", FMT, __LINE__, __func__, ## ARGS)
+#   define LOG_ERROR(FMT, ARGS...) log_debug(0, FMT, ## ARGS)
+#   define LOG_WARNING(FMT, ARGS...) log_debug(1, FMT, ## ARGS)
+#   define LOG_INFO(FMT, ARGS...) log_debug(2, FMT, ## ARGS)
+#   define LOG_DEBUG(FMT, ARGS...) log_debug(3, FMT, ## ARGS)
 #else
 #   define LOG_ERROR(FMT, ARGS...)
 #   define LOG_WARNING(FMT, ARGS...)
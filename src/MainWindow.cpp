@@ -22,16 +22,33 @@
 #include <QInputDialog>
 #include <QSettings>
 #include <QDockWidget>
+#include <QFileSystemWatcher>
+#include <QTimer>
 
 #include "CustomSettings.h"
 #include "GraphDisplay.h"
+#include "LatencyPanel.h"
+#include "SyncPanel.h"
+#include "LogAnalyzer.h"
+#include "LogLevelPanel.h"
+#include "LogView.h"
+#include "MiniMap.h"
 #include "PipelineIE.h"
 #include "SeekSlider.h"
+#include "TraceRecorder.h"
+#include "AllocationInspector.h"
+#include "CopyDetector.h"
+#include "TimingAnalyzer.h"
+#include "TracerPanel.h"
 
 #include "version_info.h"
 
 #include <gst/gst.h>
 
+#define RELOAD_DELAY 300
+/* elements which logged a warning or an error this recently are badged */
+#define BADGE_WINDOW (10 * G_USEC_PER_SEC)
+
 MainWindow::MainWindow (QWidget *parent, Qt::WindowFlags flags)
 : QMainWindow (parent, flags),
 m_pGraph (new GraphManager)
@@ -135,6 +152,31 @@ m_pGraph (new GraphManager)
                                           QKeySequence::SaveAs);
   addAction (pactSaveAs);
 
+  m_menu->addSeparator ();
+  QAction *pactReload = m_menu->addAction ("Reload", this, SLOT (Reload ()),
+                                          QKeySequence::Refresh);
+  addAction (pactReload);
+
+  m_pactAutoReload = m_menu->addAction ("Reload on Change");
+  m_pactAutoReload->setCheckable (true);
+
+  m_pWatcher = new QFileSystemWatcher (this);
+  connect (m_pWatcher, SIGNAL (fileChanged (const QString &)),
+           SLOT (FileChanged (const QString &)));
+
+  /* editors often save in several writes, reload once they are done */
+  m_pReloadTimer = new QTimer (this);
+  m_pReloadTimer->setSingleShot (true);
+  m_pReloadTimer->setInterval (RELOAD_DELAY);
+  connect (m_pReloadTimer, SIGNAL (timeout ()), SLOT (Reload ()));
+
+  m_menu->addSeparator ();
+  m_menu->addAction ("Import gst-launch...", this, SLOT (ImportLaunch ()));
+  m_menu->addAction ("Export gst-launch...", this, SLOT (ExportLaunch ()));
+
+  m_menu->addSeparator ();
+  m_menu->addAction ("Open GStreamer Log...", this, SLOT (OpenGstLog ()));
+
   m_menu->addSeparator ();
   m_menu->addAction ("Exit", this, SLOT (close ()));
 
@@ -150,6 +192,35 @@ m_pGraph (new GraphManager)
   m_menu->addAction (pactFlush);
   m_menu->addSeparator ();
   m_menu->addAction (pactClear);
+  m_menu->addSeparator ();
+
+  m_pTraceRecorder = new TraceRecorder (this);
+  QAction *pactTrace = m_menu->addAction ("Record Trace");
+  pactTrace->setCheckable (true);
+  connect (pactTrace, SIGNAL (toggled (bool)), SLOT (RecordTrace (bool)));
+
+  m_pAllocationInspector = new AllocationInspector (this);
+  QAction *pactAllocation = m_menu->addAction ("Inspect Allocation");
+  pactAllocation->setCheckable (true);
+  pactAllocation->setToolTip ("Show the allocation negotiated on each link and "
+                              "where the buffers come from, check before playing");
+  connect (pactAllocation, SIGNAL (toggled (bool)), SLOT (InspectAllocation (bool)));
+  connect (m_pAllocationInspector, SIGNAL (updated ()), SLOT (UpdateLinkProblems ()));
+
+  m_pCopyDetector = new CopyDetector (this);
+  QAction *pactCopies = m_menu->addAction ("Detect Copies");
+  pactCopies->setCheckable (true);
+  pactCopies->setToolTip ("Color the elements by the bytes they copy or "
+                          "allocate instead of passing their input on");
+  connect (pactCopies, SIGNAL (toggled (bool)), SLOT (DetectCopies (bool)));
+  connect (m_pCopyDetector, SIGNAL (updated ()), SLOT (UpdateCopyCosts ()));
+
+  m_pTimingAnalyzer = new TimingAnalyzer (this);
+  QAction *pactTiming = m_menu->addAction ("Analyze Timing");
+  pactTiming->setCheckable (true);
+  pactTiming->setToolTip ("Check the timestamps and arrival times of the "
+                          "buffers on every link, see the pad properties");
+  connect (pactTiming, SIGNAL (toggled (bool)), SLOT (AnalyzeTiming (bool)));
 
   m_menu = menuBar ()->addMenu ("&Help");
 
@@ -161,12 +232,15 @@ m_pGraph (new GraphManager)
   connect(m_pGraphDisplay, SIGNAL(signalClearGraph()),
                     this, SLOT(ClearGraph()));
 
-  QScrollArea *pscroll = new QScrollArea;
-  pscroll->setWidget (m_pGraphDisplay);
-  pscroll->setWidgetResizable (false);
+  m_pScrollArea = new QScrollArea;
+  m_pScrollArea->setWidget (m_pGraphDisplay);
+  m_pScrollArea->setWidgetResizable (false);
   m_pGraphDisplay->resize (10000, 10000);
   m_pGraphDisplay->m_pGraph = m_pGraph;
-  setCentralWidget (pscroll);
+  m_pGraphDisplay->setAllocationInspector (m_pAllocationInspector);
+  m_pGraphDisplay->setCopyDetector (m_pCopyDetector);
+  m_pGraphDisplay->setTimingAnalyzer (m_pTimingAnalyzer);
+  setCentralWidget (m_pScrollArea);
   m_pstatusBar = new QStatusBar;
   setStatusBar (m_pstatusBar);
   m_pluginListDlg = new PluginsListDialog (this);
@@ -182,8 +256,8 @@ m_pGraph (new GraphManager)
   createDockWindows();
 
   Logger::instance().start();
-  connect(&Logger::instance(), SIGNAL(sendLog(const QString &, int)),
-                  this, SLOT(InsertLogLine(const QString &, int)));
+  connect(&Logger::instance(), SIGNAL(sendLogs(const QVector<LogRecord> &)),
+                  this, SLOT(InsertLogRecords(const QVector<LogRecord> &)));
 
   LOG_INFO("Mainwindow is now initialized");
 
@@ -195,11 +269,48 @@ void MainWindow::createDockWindows()
     /* create the log list window */
     QDockWidget *dock = new QDockWidget(tr("logs"), this);
     dock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
-    m_logList = new QListWidget(dock);
-    dock->setWidget(m_logList);
+    m_pLogView = new LogView(dock);
+    dock->setWidget(m_pLogView);
+    connect(m_pGraphDisplay, SIGNAL(signalSelectionChanged(const QStringList &)),
+            m_pLogView, SLOT(setObjectFilter(const QStringList &)));
     addDockWidget(Qt::BottomDockWidgetArea, dock);
     m_menu->addAction(dock->toggleViewAction());
 
+    /* create the debug threshold panel */
+    QDockWidget *levelDock = new QDockWidget(tr("log levels"), this);
+    LogLevelPanel *levelPanel = new LogLevelPanel(levelDock);
+    levelDock->setWidget(levelPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, levelDock);
+    tabifyDockWidget(dock, levelDock);
+    dock->raise();
+    m_menu->addAction(levelDock->toggleViewAction());
+    connect(&Logger::instance(), SIGNAL(sendCategoryRates(const CategoryRates &)),
+            levelPanel, SLOT(updateRates(const CategoryRates &)));
+
+    /* create the tracer panel */
+    QDockWidget *tracerDock = new QDockWidget(tr("tracers"), this);
+    tracerDock->setWidget(new TracerPanel(m_pGraph.data(), tracerDock));
+    addDockWidget(Qt::BottomDockWidgetArea, tracerDock);
+    tabifyDockWidget(levelDock, tracerDock);
+    dock->raise();
+    m_menu->addAction(tracerDock->toggleViewAction());
+
+    /* create the latency dashboard */
+    QDockWidget *latencyDock = new QDockWidget(tr("latency"), this);
+    latencyDock->setWidget(new LatencyPanel(m_pGraph.data(), latencyDock));
+    addDockWidget(Qt::BottomDockWidgetArea, latencyDock);
+    tabifyDockWidget(tracerDock, latencyDock);
+    dock->raise();
+    m_menu->addAction(latencyDock->toggleViewAction());
+
+    /* create the A/V sync monitor */
+    QDockWidget *syncDock = new QDockWidget(tr("sync"), this);
+    syncDock->setWidget(new SyncPanel(m_pGraph.data(), syncDock));
+    addDockWidget(Qt::BottomDockWidgetArea, syncDock);
+    tabifyDockWidget(latencyDock, syncDock);
+    dock->raise();
+    m_menu->addAction(syncDock->toggleViewAction());
+
     /*create the favorite list window */
     dock = new QDockWidget(tr("favorite list"), this);
     dock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
@@ -213,6 +324,12 @@ void MainWindow::createDockWindows()
      connect(m_favoriteList,SIGNAL(customContextMenuRequested(const QPoint &)),
      this,SLOT(ProvideContextMenu(const QPoint &)));
 
+    /* create the minimap window */
+    dock = new QDockWidget(tr("minimap"), this);
+    dock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
+    dock->setWidget(new MiniMap(m_pGraphDisplay, m_pScrollArea, dock));
+    addDockWidget(Qt::RightDockWidgetArea, dock);
+    m_menu->addAction(dock->toggleViewAction());
 }
 FavoritesList* MainWindow::getFavoritesList()
 {
@@ -254,20 +371,9 @@ void MainWindow::ProvideContextMenu(const QPoint &pos)
   }
 }
 
-void MainWindow::InsertLogLine(const QString& line, int category)
+void MainWindow::InsertLogRecords(const QVector<LogRecord>& records)
 {
-  QListWidgetItem* pItem =new QListWidgetItem(line);
-  switch(category) {
-    case eLOG_CATEGORY_INTERNAL:
-      pItem->setForeground(Qt::blue);
-      break;
-    case eLOG_CATEGORY_GST:
-      pItem->setForeground(Qt::red);
-      break;
-    default:
-      pItem->setForeground(Qt::black);
-  }
-  m_logList->addItem(pItem);
+  m_pLogView->appendRecords(records);
 }
 
 MainWindow& MainWindow::instance()
@@ -279,6 +385,11 @@ MainWindow& MainWindow::instance()
 MainWindow::~MainWindow ()
 {
   CustomSettings::saveMainWindowGeometry (saveGeometry ());
+  /* before the graph goes away with the members */
+  m_pTraceRecorder->stop ();
+  m_pAllocationInspector->stop ();
+  m_pCopyDetector->stop ();
+  m_pTimingAnalyzer->stop ();
   Logger::instance().Quit();
   delete m_pluginListDlg;
 }
@@ -426,6 +537,40 @@ MainWindow::timerEvent (QTimerEvent *)
     m_pslider->setSliderPosition (m_pslider->maximum () * pos);
 
   m_pGraphDisplay->update (m_pGraph->GetInfo ());
+
+  /* timing irregularities are warnings, unless the element logged errors */
+  QHash<QString, int> badges = m_pLogView->recentProblems (BADGE_WINDOW);
+  if (m_pTimingAnalyzer->isRunning ()) {
+    const std::map<std::string, PadTiming> &pads = m_pTimingAnalyzer->pads ();
+    std::map<std::string, PadTiming>::const_iterator pad;
+    for (pad = pads.begin (); pad != pads.end (); ++pad) {
+      if (!pad->second.m_warning)
+        continue;
+
+      QString element = QString (pad->first.c_str ()).section (':', 0, 0);
+      if (!badges.contains (element))
+        badges[element] = GST_LEVEL_WARNING;
+    }
+  }
+  m_pGraphDisplay->setBadges (badges);
+
+  /* a sink dropping frames also points at the element feeding it */
+  QHash<QString, double> dropRates;
+  std::map<std::string, QosStats> qos = m_pGraph->GetQos ();
+  std::map<std::string, QosStats>::const_iterator it;
+  for (it = qos.begin (); it != qos.end (); ++it) {
+    double rate = it->second.DropRate ();
+    if (rate <= 0)
+      continue;
+
+    QString name (it->first.c_str ());
+    dropRates[name] = qMax (dropRates.value (name), rate);
+    if (!it->second.m_upstream.empty ()) {
+      QString upstream (it->second.m_upstream.c_str ());
+      dropRates[upstream] = qMax (dropRates.value (upstream), rate);
+    }
+  }
+  m_pGraphDisplay->setDropRates (dropRates);
 }
 
 void
@@ -434,13 +579,12 @@ MainWindow::Save ()
   if (m_fileName.isEmpty ())
     SaveAs ();
   else {
-    QFileInfo fileInfo (m_fileName);
-    if (fileInfo.completeSuffix ().isEmpty ()
-    || fileInfo.completeSuffix () != "gpi")
+    QString suffix = QFileInfo (m_fileName).suffix ();
+    if (suffix != "gpi" && suffix != "gpb" && suffix != "gpbz")
       m_fileName = m_fileName + ".gpi";
 
     PipelineIE::Export (m_pGraph, m_fileName);
-
+    watchFile ();
   }
 }
 
@@ -449,8 +593,9 @@ MainWindow::SaveAs ()
 {
   QString dir = CustomSettings::lastIODirectory ();
 
-  QString path = QFileDialog::getSaveFileName (this, "Save As...", dir,
-                                               tr ("*.gpi"));
+  QString path = QFileDialog::getSaveFileName (
+  this, "Save As...", dir,
+  tr ("GPI (*.gpi);;Binary snapshot (*.gpb);;Compressed snapshot (*.gpbz)"));
 
   if (!path.isEmpty ()) {
     m_fileName = path;
@@ -467,17 +612,213 @@ MainWindow::Open ()
   QString dir = CustomSettings::lastIODirectory ();
 
   QString path = QFileDialog::getOpenFileName (
-  this, "Open...", dir, tr ("GPI (*.gpi *.xpm);;All files (*.*)"));
+  this, "Open...", dir, tr ("Pipelines (*.gpi *.gpb *.gpbz *.xpm);;All files (*.*)"));
 
   if (!path.isEmpty ()) {
-    if (PipelineIE::Import (m_pGraph, path))
-      m_fileName = path;
+    OpenFile (path);
 
     QString dir = QFileInfo (path).absoluteDir ().absolutePath ();
     CustomSettings::saveLastIODirectory (dir);
   }
 }
 
+void
+MainWindow::OpenFile (const QString &path)
+{
+  if (PipelineIE::Import (m_pGraph, path)) {
+    m_fileName = path;
+    watchFile ();
+  }
+}
+
+void
+MainWindow::Reload ()
+{
+  if (m_fileName.isEmpty ())
+    return;
+
+  if (PipelineIE::Reload (m_pGraph, m_fileName))
+    m_pstatusBar->showMessage ("Reloaded " + m_fileName);
+
+  watchFile ();
+}
+
+void
+MainWindow::FileChanged (const QString &path)
+{
+  if (path == m_fileName && m_pactAutoReload->isChecked ())
+    m_pReloadTimer->start ();
+}
+
+void
+MainWindow::watchFile ()
+{
+  /* files replaced on save drop out of the watcher */
+  if (!m_pWatcher->files ().isEmpty ())
+    m_pWatcher->removePaths (m_pWatcher->files ());
+
+  if (!m_fileName.isEmpty () && QFileInfo (m_fileName).exists ())
+    m_pWatcher->addPath (m_fileName);
+}
+
+void
+MainWindow::OpenLaunch (const QString &description)
+{
+  if (PipelineIE::ImportLaunch (m_pGraph, description)) {
+    m_fileName.clear ();
+    watchFile ();
+  }
+}
+
+void
+MainWindow::ImportLaunch ()
+{
+  bool ok;
+  QString description = QInputDialog::getMultiLineText (
+  this, "Import gst-launch...", "Pipeline description:", QString (), &ok);
+
+  if (ok && !description.trimmed ().isEmpty ())
+    OpenLaunch (description);
+}
+
+void
+MainWindow::ExportLaunch ()
+{
+  QString description = PipelineIE::ExportLaunch (m_pGraph);
+  QInputDialog::getMultiLineText (this, "Export gst-launch...",
+                                  "Pipeline description:", description);
+}
+
+void
+MainWindow::InspectAllocation (bool inspect)
+{
+  if (inspect)
+    m_pAllocationInspector->start (m_pGraph.data ());
+  else {
+    m_pAllocationInspector->stop ();
+    m_pGraphDisplay->setLinkProblems (QHash<QString, int> ());
+  }
+}
+
+void
+MainWindow::UpdateLinkProblems ()
+{
+  QHash<QString, int> problems;
+
+  const std::map<std::string, LinkAllocation> &links =
+      m_pAllocationInspector->links ();
+  std::map<std::string, LinkAllocation>::const_iterator it;
+  for (it = links.begin (); it != links.end (); ++it) {
+    if (it->second.m_problem != LinkAllocation::None)
+      problems[QString (it->first.c_str ())] = it->second.m_problem;
+  }
+
+  m_pGraphDisplay->setLinkProblems (problems);
+}
+
+void
+MainWindow::DetectCopies (bool detect)
+{
+  if (detect) {
+    bool ok;
+    int sampleEvery = QInputDialog::getInt (this, "Detect Copies",
+                                            "Look at one pushed buffer out of:",
+                                            1, 1, 1000, 1, &ok);
+    if (!ok || !m_pCopyDetector->start (m_pGraph.data (), sampleEvery))
+      qobject_cast<QAction *> (sender ())->setChecked (false);
+  }
+  else {
+    m_pCopyDetector->stop ();
+    m_pGraphDisplay->setCopyCosts (QHash<QString, double> ());
+  }
+}
+
+void
+MainWindow::UpdateCopyCosts ()
+{
+  QHash<QString, double> costs;
+
+  /* producing the buffers is what a source is for */
+  const std::map<std::string, ElementCopy> &elements = m_pCopyDetector->elements ();
+  std::map<std::string, ElementCopy>::const_iterator it;
+  for (it = elements.begin (); it != elements.end (); ++it) {
+    if (it->second.m_kind == ElementCopy::Copy)
+      costs[QString (it->first.c_str ())] = it->second.m_copiedBytesPerSecond;
+  }
+
+  m_pGraphDisplay->setCopyCosts (costs);
+}
+
+void
+MainWindow::AnalyzeTiming (bool analyze)
+{
+  if (analyze) {
+    bool ok;
+    int sampleEvery = QInputDialog::getInt (this, "Analyze Timing",
+                                            "Record one buffer out of:",
+                                            1, 1, 1000, 1, &ok);
+    if (!ok || !m_pTimingAnalyzer->start (m_pGraph.data (), sampleEvery))
+      qobject_cast<QAction *> (sender ())->setChecked (false);
+  }
+  else
+    m_pTimingAnalyzer->stop ();
+}
+
+void
+MainWindow::RecordTrace (bool record)
+{
+  if (record) {
+    bool ok;
+    int sampleEvery = QInputDialog::getInt (this, "Record Trace",
+                                            "Record one buffer push out of:",
+                                            1, 1, 1000, 1, &ok);
+    if (!ok || !m_pTraceRecorder->start (m_pGraph.data (), sampleEvery)) {
+      qobject_cast<QAction *> (sender ())->setChecked (false);
+      return;
+    }
+
+    m_pstatusBar->showMessage ("Recording trace...");
+    return;
+  }
+
+  if (!m_pTraceRecorder->isRecording ())
+    return;
+
+  m_pTraceRecorder->stop ();
+
+  QString path = QFileDialog::getSaveFileName (this, "Export Trace...",
+                                               CustomSettings::lastIODirectory (),
+                                               tr ("Trace (*.json)"));
+  if (path.isEmpty ())
+    return;
+
+  QString error;
+  if (!m_pTraceRecorder->exportChromeJson (path, error)) {
+    QMessageBox::warning (this, "Trace export failed", error);
+    return;
+  }
+
+  LOG_INFO("Trace of %u events written to %s, %u dropped",
+           (unsigned) m_pTraceRecorder->eventCount (),
+           path.toStdString ().c_str (),
+           (unsigned) m_pTraceRecorder->droppedCount ());
+}
+
+void
+MainWindow::OpenGstLog ()
+{
+  QString path = QFileDialog::getOpenFileName (this, "Open GStreamer Log...",
+                                               QString (),
+                                               tr ("Log files (*.log *.txt);;All files (*)"));
+  if (path.isEmpty ())
+    return;
+
+  LogAnalyzer *panalyzer = new LogAnalyzer (this);
+  panalyzer->setAttribute (Qt::WA_DeleteOnClose);
+  panalyzer->show ();
+  panalyzer->openFile (path);
+}
+
 void
 MainWindow::About ()
 {
@@ -19,6 +19,14 @@
 class GraphDisplay;
 class PluginsListDialog;
 class FavoritesList;
+class LogView;
+class TraceRecorder;
+class AllocationInspector;
+class CopyDetector;
+class TimingAnalyzer;
+class QScrollArea;
+class QFileSystemWatcher;
+class QTimer;
 
 class MainWindow: public QMainWindow
 {
@@ -30,12 +38,16 @@ public:
   static MainWindow& instance();
   FavoritesList* getFavoritesList();
 
+  void OpenFile(const QString &path);
+  void OpenLaunch(const QString &description);
+
 protected:
   void timerEvent(QTimerEvent *);
   void createDockWindows();
+  void watchFile();
 
 public slots:
-  void InsertLogLine(const QString& line, int category);
+  void InsertLogRecords(const QVector<LogRecord>& records);
   void AddPlugin();
   void ClearGraph();
   void AddPluginToFavorites(const QString& plugin_name);
@@ -53,6 +65,17 @@ private slots:
   void Save();
   void SaveAs();
   void Open();
+  void Reload();
+  void FileChanged(const QString &path);
+  void ImportLaunch();
+  void ExportLaunch();
+  void OpenGstLog();
+  void RecordTrace(bool record);
+  void InspectAllocation(bool inspect);
+  void UpdateLinkProblems();
+  void DetectCopies(bool detect);
+  void UpdateCopyCosts();
+  void AnalyzeTiming(bool analyze);
 
   void About();
 
@@ -64,14 +87,22 @@ private:
   QSharedPointer<GraphManager> m_pGraph;
 
   GraphDisplay *m_pGraphDisplay;
+  QScrollArea *m_pScrollArea;
 
   QStatusBar *m_pstatusBar;
   QSlider *m_pslider;
 
   QString m_fileName;
+  QFileSystemWatcher *m_pWatcher;
+  QTimer *m_pReloadTimer;
+  QAction *m_pactAutoReload;
   PluginsListDialog *m_pluginListDlg;
   QMenu *m_menu;
-  QListWidget* m_logList;
+  LogView* m_pLogView;
+  TraceRecorder *m_pTraceRecorder;
+  AllocationInspector *m_pAllocationInspector;
+  CopyDetector *m_pCopyDetector;
+  TimingAnalyzer *m_pTimingAnalyzer;
   FavoritesList* m_favoriteList;
 };
 
@@ -0,0 +1,52 @@
+#include "MetricsReport.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+
+#include <stdio.h>
+
+#define METRICS_REPORT_VERSION 1
+
+MetricsReport::MetricsReport ()
+{
+}
+
+void
+MetricsReport::addSection (const QString &name, const QJsonValue &value)
+{
+  m_sections[name] = value;
+}
+
+QJsonObject
+MetricsReport::toJson () const
+{
+  QJsonObject root;
+  root["generator"] = QString ("pipeviz");
+  root["version"] = METRICS_REPORT_VERSION;
+  root["created"] = QDateTime::currentDateTimeUtc ().toString (Qt::ISODate);
+  root["sections"] = m_sections;
+  return root;
+}
+
+bool
+MetricsReport::write (const QString &fileName, QString &error) const
+{
+  QByteArray data = QJsonDocument (toJson ()).toJson (QJsonDocument::Indented);
+
+  QFile file;
+  bool opened;
+  if (fileName == "-")
+    opened = file.open (stdout, QIODevice::WriteOnly);
+  else {
+    file.setFileName (fileName);
+    opened = file.open (QIODevice::WriteOnly | QIODevice::Truncate);
+  }
+
+  if (!opened || file.write (data) != data.size ()) {
+    error = file.errorString ();
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,27 @@
+#ifndef METRICS_REPORT_H_
+#define METRICS_REPORT_H_
+
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QString>
+
+/* The JSON document pipeviz writes its measurements to: one object per
+ * section, named after what produced it, next to the time the report was
+ * made. */
+class MetricsReport
+{
+public:
+  MetricsReport();
+
+  void addSection(const QString &name, const QJsonValue &value);
+  bool isEmpty() const { return m_sections.isEmpty (); }
+
+  QJsonObject toJson() const;
+  /* "-" writes to stdout */
+  bool write(const QString &fileName, QString &error) const;
+
+private:
+  QJsonObject m_sections;
+};
+
+#endif
@@ -0,0 +1,227 @@
+#include "MiniMap.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include <QPainter>
+#include <QMouseEvent>
+#include <QScrollArea>
+#include <QScrollBar>
+#include <QTimer>
+
+#include "GraphDisplay.h"
+
+#define MINIMAP_SCENE_STEP 1024
+#define MINIMAP_RENDER_DELAY 200
+
+MiniMap::MiniMap (GraphDisplay *pGraphDisplay, QScrollArea *pScrollArea,
+                  QWidget *parent, Qt::WindowFlags f)
+: QWidget (parent, f),
+m_pGraphDisplay (pGraphDisplay),
+m_pScrollArea (pScrollArea),
+m_renderPending (false),
+m_fullRender (true)
+{
+  connect(m_pGraphDisplay, SIGNAL(signalRegionChanged(const QRect &)),
+          SLOT(regionChanged(const QRect &)));
+
+  connect(m_pScrollArea->horizontalScrollBar (), SIGNAL(valueChanged(int)),
+          SLOT(viewportChanged()));
+  connect(m_pScrollArea->verticalScrollBar (), SIGNAL(valueChanged(int)),
+          SLOT(viewportChanged()));
+  connect(m_pScrollArea->horizontalScrollBar (), SIGNAL(rangeChanged(int, int)),
+          SLOT(viewportChanged()));
+  connect(m_pScrollArea->verticalScrollBar (), SIGNAL(rangeChanged(int, int)),
+          SLOT(viewportChanged()));
+
+  setMinimumSize (100, 75);
+}
+
+QSize
+MiniMap::sizeHint () const
+{
+  return QSize (200, 150);
+}
+
+void
+MiniMap::regionChanged (const QRect &rect)
+{
+  m_dirty |= rect;
+  scheduleRender ();
+}
+
+void
+MiniMap::viewportChanged ()
+{
+  update ();
+}
+
+void
+MiniMap::scheduleRender ()
+{
+  if (m_renderPending)
+    return;
+
+  m_renderPending = true;
+  QTimer::singleShot (MINIMAP_RENDER_DELAY, this, SLOT (renderDirty ()));
+}
+
+void
+MiniMap::renderDirty ()
+{
+  m_renderPending = false;
+
+  std::vector<QRect> elements;
+  std::vector<QLine> connections;
+  m_pGraphDisplay->getSceneItems (elements, connections);
+
+  QRect sceneRect = calculateSceneRect (elements);
+  if (sceneRect != m_sceneRect || m_image.size () != size ()) {
+    m_sceneRect = sceneRect;
+    m_image = QImage (size (), QImage::Format_RGB32);
+    m_fullRender = true;
+  }
+
+  if (m_fullRender) {
+    m_image.fill (palette ().color (QPalette::Window));
+    render (elements, connections, m_sceneRect);
+  }
+  else {
+    QVector<QRect> rects = m_dirty.rects ();
+    for (int i = 0; i < rects.size (); i++)
+      render (elements, connections, rects[i]);
+  }
+
+  m_dirty = QRegion ();
+  m_fullRender = false;
+  update ();
+}
+
+QRect
+MiniMap::calculateSceneRect (const std::vector<QRect> &elements)
+{
+  QRect bounds (0, 0, 1, 1);
+  for (std::size_t i = 0; i < elements.size (); i++)
+    bounds |= elements[i];
+
+  /* Grow in coarse steps so that the scale, and so the whole image, only
+   * changes when the graph outgrows the current area. */
+  int width = ((bounds.right () / MINIMAP_SCENE_STEP) + 1) * MINIMAP_SCENE_STEP;
+  int height = ((bounds.bottom () / MINIMAP_SCENE_STEP) + 1)
+  * MINIMAP_SCENE_STEP;
+
+  return QRect (0, 0, width, height);
+}
+
+qreal
+MiniMap::scaleFactor () const
+{
+  if (m_sceneRect.isEmpty ())
+    return 1;
+
+  return std::min ((qreal) width () / m_sceneRect.width (),
+                   (qreal) height () / m_sceneRect.height ());
+}
+
+QRect
+MiniMap::mapToMiniMap (const QRect &rect) const
+{
+  qreal scale = scaleFactor ();
+  return QRect (floor (rect.x () * scale), floor (rect.y () * scale),
+                ceil (rect.width () * scale), ceil (rect.height () * scale));
+}
+
+QPoint
+MiniMap::mapToScene (const QPoint &pos) const
+{
+  qreal scale = scaleFactor ();
+  return QPoint (pos.x () / scale, pos.y () / scale);
+}
+
+void
+MiniMap::render (const std::vector<QRect> &elements,
+                 const std::vector<QLine> &connections, const QRect &sceneRect)
+{
+  if (m_image.isNull ())
+    return;
+
+  QRect target = mapToMiniMap (sceneRect).adjusted (-1, -1, 1, 1)
+  & m_image.rect ();
+  if (target.isEmpty ())
+    return;
+
+  qreal scale = scaleFactor ();
+  int margin = ceil (2 / scale);
+  QRect area = sceneRect.adjusted (-margin, -margin, margin, margin);
+
+  QPainter painter (&m_image);
+  painter.setClipRect (target);
+  painter.fillRect (target, palette ().color (QPalette::Base));
+  painter.scale (scale, scale);
+
+  painter.setPen (QPen (palette ().color (QPalette::Text), 0));
+  for (std::size_t i = 0; i < connections.size (); i++) {
+    QRect lineRect = QRect (connections[i].p1 (), connections[i].p2 ())
+    .normalized ();
+    if (lineRect.intersects (area))
+      painter.drawLine (connections[i]);
+  }
+
+  for (std::size_t i = 0; i < elements.size (); i++) {
+    if (elements[i].intersects (area))
+      painter.fillRect (elements[i], palette ().color (QPalette::Mid));
+  }
+}
+
+void
+MiniMap::paintEvent (QPaintEvent *event)
+{
+  Q_UNUSED(event);
+  QPainter painter (this);
+
+  if (m_image.isNull ())
+    painter.fillRect (rect (), palette ().color (QPalette::Base));
+  else
+    painter.drawImage (0, 0, m_image);
+
+  QRect viewport (m_pScrollArea->horizontalScrollBar ()->value (),
+                  m_pScrollArea->verticalScrollBar ()->value (),
+                  m_pScrollArea->viewport ()->width (),
+                  m_pScrollArea->viewport ()->height ());
+
+  painter.setPen (QPen (Qt::red));
+  painter.drawRect (mapToMiniMap (viewport).adjusted (0, 0, -1, -1));
+}
+
+void
+MiniMap::resizeEvent (QResizeEvent *event)
+{
+  Q_UNUSED(event);
+  m_fullRender = true;
+  scheduleRender ();
+}
+
+void
+MiniMap::mousePressEvent (QMouseEvent *event)
+{
+  if (event->buttons () & Qt::LeftButton)
+    jumpTo (event->pos ());
+}
+
+void
+MiniMap::mouseMoveEvent (QMouseEvent *event)
+{
+  if (event->buttons () & Qt::LeftButton)
+    jumpTo (event->pos ());
+}
+
+void
+MiniMap::jumpTo (const QPoint &pos)
+{
+  QPoint scenePos = mapToScene (pos);
+
+  m_pScrollArea->horizontalScrollBar ()->setValue (
+  scenePos.x () - m_pScrollArea->viewport ()->width () / 2);
+  m_pScrollArea->verticalScrollBar ()->setValue (
+  scenePos.y () - m_pScrollArea->viewport ()->height () / 2);
+}
@@ -0,0 +1,56 @@
+#ifndef MINI_MAP_H_
+#define MINI_MAP_H_
+
+#include <vector>
+
+#include <QWidget>
+#include <QImage>
+#include <QRegion>
+#include <QRect>
+#include <QLine>
+
+class GraphDisplay;
+class QScrollArea;
+
+class MiniMap: public QWidget
+{
+  Q_OBJECT
+
+public:
+  MiniMap(GraphDisplay *pGraphDisplay, QScrollArea *pScrollArea,
+      QWidget *parent = 0, Qt::WindowFlags f = 0);
+
+  QSize sizeHint() const;
+
+protected:
+  void paintEvent(QPaintEvent *event);
+  void resizeEvent(QResizeEvent *event);
+  void mousePressEvent(QMouseEvent *event);
+  void mouseMoveEvent(QMouseEvent *event);
+
+private slots:
+  void regionChanged(const QRect &rect);
+  void renderDirty();
+  void viewportChanged();
+
+private:
+  QRect calculateSceneRect(const std::vector <QRect> &elements);
+  void render(const std::vector <QRect> &elements,
+      const std::vector <QLine> &connections, const QRect &sceneRect);
+  void scheduleRender();
+  qreal scaleFactor() const;
+  QRect mapToMiniMap(const QRect &rect) const;
+  QPoint mapToScene(const QPoint &pos) const;
+  void jumpTo(const QPoint &pos);
+
+  GraphDisplay *m_pGraphDisplay;
+  QScrollArea *m_pScrollArea;
+
+  QImage m_image;
+  QRect m_sceneRect;
+  QRegion m_dirty;
+  bool m_renderPending;
+  bool m_fullRender;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#include "PadProbes.h"
+
+#include <QtGlobal>
+
+static void
+probes_unref_state (gpointer data)
+{
+  PadProbes::State *state = (PadProbes::State *) data;
+  if (--state->m_refs == 0)
+    delete state;
+}
+
+static void
+probes_pad_added (GstElement *element, GstPad *pad, PadProbes *probes)
+{
+  Q_UNUSED(element);
+  probes->addPad (pad);
+}
+
+#if GST_CHECK_VERSION(1,10,0)
+static void
+probes_element_added (GstBin *bin, GstBin *parent, GstElement *element,
+                      PadProbes *probes)
+{
+  Q_UNUSED(bin);
+  Q_UNUSED(parent);
+  probes->addElement (element);
+}
+#endif
+
+PadProbes::PadProbes ()
+: m_mask (GST_PAD_PROBE_TYPE_INVALID),
+m_callback (NULL),
+m_padData (NULL),
+m_elementAdded (NULL),
+m_data (NULL),
+m_active (false)
+{
+  g_mutex_init (&m_lock);
+}
+
+PadProbes::~PadProbes ()
+{
+  clear ();
+  g_mutex_clear (&m_lock);
+}
+
+void
+PadProbes::add (GstElement *pipeline, GstPadProbeType mask,
+                GstPadProbeCallback callback, PadData padData, gpointer data,
+                ElementAdded elementAdded)
+{
+  clear ();
+
+  m_mask = mask;
+  m_callback = callback;
+  m_padData = padData;
+  m_elementAdded = elementAdded;
+  m_data = data;
+  m_active = true;
+
+#if GST_CHECK_VERSION(1,10,0)
+  /* before iterating, an element added meanwhile is seen twice at worst */
+  g_mutex_lock (&m_lock);
+  Watch watch;
+  watch.m_pElement = GST_ELEMENT (gst_object_ref (pipeline));
+  watch.m_id = g_signal_connect (pipeline, "deep-element-added",
+                                 G_CALLBACK (probes_element_added), this);
+  m_watches.push_back (watch);
+  g_mutex_unlock (&m_lock);
+#endif
+
+  GstIterator *iter = gst_bin_iterate_recurse (GST_BIN (pipeline));
+  GValue value = G_VALUE_INIT;
+  bool done = false;
+  while (!done) {
+    switch (gst_iterator_next (iter, &value)) {
+      case GST_ITERATOR_OK:
+        addElement (GST_ELEMENT (g_value_get_object (&value)));
+        g_value_reset (&value);
+        break;
+      case GST_ITERATOR_RESYNC:
+        /* the elements and pads already seen are skipped */
+        gst_iterator_resync (iter);
+        break;
+      default:
+        done = true;
+        break;
+    }
+  }
+  g_value_unset (&value);
+  gst_iterator_free (iter);
+}
+
+void
+PadProbes::clear ()
+{
+  g_mutex_lock (&m_lock);
+  m_active = false;
+
+  /* the probes drop their references once their callbacks returned */
+  for (std::size_t i = 0; i < m_probes.size (); i++) {
+    gst_pad_remove_probe (m_probes[i].m_pPad, m_probes[i].m_id);
+    gst_object_unref (m_probes[i].m_pPad);
+  }
+  m_probes.clear ();
+
+  for (std::size_t i = 0; i < m_watches.size (); i++) {
+    g_signal_handler_disconnect (m_watches[i].m_pElement, m_watches[i].m_id);
+    gst_object_unref (m_watches[i].m_pElement);
+  }
+  m_watches.clear ();
+
+  for (std::size_t i = 0; i < m_states.size (); i++)
+    probes_unref_state (m_states[i]);
+  m_states.clear ();
+  g_mutex_unlock (&m_lock);
+}
+
+std::vector<PadProbes::State *>
+PadProbes::states ()
+{
+  g_mutex_lock (&m_lock);
+  std::vector<State *> res = m_states;
+  g_mutex_unlock (&m_lock);
+  return res;
+}
+
+void
+PadProbes::addPad (GstPad *pad)
+{
+  g_mutex_lock (&m_lock);
+  /* a pad-added racing with clear */
+  if (!m_active) {
+    g_mutex_unlock (&m_lock);
+    return;
+  }
+
+  for (std::size_t i = 0; i < m_probes.size (); i++) {
+    if (m_probes[i].m_pPad == pad) {
+      g_mutex_unlock (&m_lock);
+      return;
+    }
+  }
+
+  State *state = m_padData (pad, m_data);
+  if (state) {
+    /* a state shared with another pad is listed already */
+    if (state->m_refs == 0) {
+      state->m_refs++;
+      m_states.push_back (state);
+    }
+
+    state->m_refs++;
+    Probe probe;
+    probe.m_pPad = GST_PAD (gst_object_ref (pad));
+    probe.m_id = gst_pad_add_probe (pad, m_mask, m_callback, state,
+                                    probes_unref_state);
+    m_probes.push_back (probe);
+  }
+  g_mutex_unlock (&m_lock);
+}
+
+void
+PadProbes::addElement (GstElement *element)
+{
+  g_mutex_lock (&m_lock);
+  if (!m_active) {
+    g_mutex_unlock (&m_lock);
+    return;
+  }
+
+  for (std::size_t i = 0; i < m_watches.size (); i++) {
+    if (m_watches[i].m_pElement == element) {
+      g_mutex_unlock (&m_lock);
+      return;
+    }
+  }
+
+  Watch watch;
+  watch.m_pElement = GST_ELEMENT (gst_object_ref (element));
+  watch.m_id = g_signal_connect (element, "pad-added",
+                                 G_CALLBACK (probes_pad_added), this);
+  m_watches.push_back (watch);
+
+  /* under the lock, clear waits for it */
+  if (m_elementAdded)
+    m_elementAdded (element, m_data);
+  g_mutex_unlock (&m_lock);
+
+  GstIterator *iter = gst_element_iterate_pads (element);
+  GValue value = G_VALUE_INIT;
+  bool done = false;
+  while (!done) {
+    switch (gst_iterator_next (iter, &value)) {
+      case GST_ITERATOR_OK:
+        addPad (GST_PAD (g_value_get_object (&value)));
+        g_value_reset (&value);
+        break;
+      case GST_ITERATOR_RESYNC:
+        gst_iterator_resync (iter);
+        break;
+      default:
+        done = true;
+        break;
+    }
+  }
+  g_value_unset (&value);
+  gst_iterator_free (iter);
+}
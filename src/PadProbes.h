@@ -0,0 +1,78 @@
+#ifndef PAD_PROBES_H_
+#define PAD_PROBES_H_
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <vector>
+
+/* Keeps one probe on every pad of a pipeline, the pads and the elements
+ * added later included, until clear. Each probe gets the state made for
+ * its pad and holds a reference on it, which GStreamer drops through the
+ * destroy notify of the probe once no callback runs it anymore. The state
+ * may thus outlive clear, it must not point into its owner. */
+class PadProbes
+{
+public:
+  /* per pad data, several pads may share one */
+  struct State
+  {
+    State(): m_refs(0) {}
+    virtual ~State() {}
+
+    std::atomic<int> m_refs;
+  };
+
+  /* the state of the probe of the pad, NULL to leave the pad alone */
+  typedef State *(*PadData)(GstPad *pad, gpointer data);
+  /* every element of the pipeline, once, from any thread and under the
+   * lock of the probes */
+  typedef void (*ElementAdded)(GstElement *element, gpointer data);
+
+  PadProbes();
+  ~PadProbes();
+
+  void add(GstElement *pipeline, GstPadProbeType mask,
+      GstPadProbeCallback callback, PadData padData, gpointer data,
+      ElementAdded elementAdded = NULL);
+  void clear();
+  bool isActive() const { return m_active; }
+
+  /* each state once, they stay valid until clear */
+  std::vector<State *> states();
+
+  /* from pad-added and deep-element-added */
+  void addPad(GstPad *pad);
+  void addElement(GstElement *element);
+
+private:
+  struct Probe
+  {
+    GstPad *m_pPad;
+    gulong m_id;
+  };
+
+  struct Watch
+  {
+    GstElement *m_pElement;
+    gulong m_id;
+  };
+
+  PadProbes(const PadProbes &);
+  PadProbes &operator=(const PadProbes &);
+
+  GstPadProbeType m_mask;
+  GstPadProbeCallback m_callback;
+  PadData m_padData;
+  ElementAdded m_elementAdded;
+  gpointer m_data;
+  std::atomic<bool> m_active;
+
+  GMutex m_lock;
+  std::vector<Probe> m_probes;
+  std::vector<Watch> m_watches;
+  /* a reference each */
+  std::vector<State *> m_states;
+};
+
+#endif
@@ -4,11 +4,91 @@
 #include <QVBoxLayout>
 #include <QLabel>
 #include <QScrollArea>
+#include <QPainter>
+
+#include <algorithm>
 
 #include <gst/gst.h>
 
+#include "AllocationInspector.h"
+#include "TimingAnalyzer.h"
+
+#define HISTOGRAM_BINS 24
+
+namespace
+{
+  /* counts of the values in equal bins between the smallest and the
+   * largest */
+  class Histogram: public QWidget
+  {
+  public:
+    Histogram (const QString &title, const std::vector<double> &values,
+               QWidget *parent = 0)
+    : QWidget (parent),
+    m_title (title),
+    m_counts (HISTOGRAM_BINS, 0),
+    m_total (values.size ()),
+    m_min (0),
+    m_max (0),
+    m_maxCount (0)
+    {
+      setMinimumSize (320, 120);
+
+      if (values.empty ())
+        return;
+
+      m_min = *std::min_element (values.begin (), values.end ());
+      m_max = *std::max_element (values.begin (), values.end ());
+      double width = (m_max - m_min) / HISTOGRAM_BINS;
+      for (std::size_t i = 0; i < values.size (); i++) {
+        int bin = width > 0 ? (int) ((values[i] - m_min) / width) : 0;
+        bin = std::min (bin, HISTOGRAM_BINS - 1);
+        m_maxCount = std::max (m_maxCount, ++m_counts[bin]);
+      }
+    }
+
+  protected:
+    void
+    paintEvent (QPaintEvent *)
+    {
+      QPainter painter (this);
+      int lineHeight = painter.fontMetrics ().height ();
+      QRect area = rect ().adjusted (0, lineHeight + 2, 0, -lineHeight - 2);
+
+      painter.drawText (0, lineHeight, QString ("%1, %2 samples").arg (m_title)
+                        .arg (m_total));
+      painter.drawRect (area.adjusted (0, 0, -1, -1));
+      if (!m_maxCount)
+        return;
+
+      double barWidth = area.width () / (double) HISTOGRAM_BINS;
+      for (int i = 0; i < HISTOGRAM_BINS; i++) {
+        int height = m_counts[i] * (area.height () - 2) / m_maxCount;
+        painter.fillRect (QRectF (area.left () + i * barWidth + 1,
+                                  area.bottom () - height, barWidth - 2, height),
+                          Qt::darkBlue);
+      }
+
+      painter.drawText (QRect (0, area.bottom () + 2, width (), lineHeight),
+                        Qt::AlignLeft, QString::number (m_min, 'f', 2));
+      painter.drawText (QRect (0, area.bottom () + 2, width (), lineHeight),
+                        Qt::AlignRight, QString::number (m_max, 'f', 2));
+    }
+
+  private:
+    QString m_title;
+    std::vector<int> m_counts;
+    std::size_t m_total;
+    double m_min;
+    double m_max;
+    int m_maxCount;
+  };
+}
+
 PadProperties::PadProperties (QSharedPointer<GraphManager> pGraphManager,
                               const char *elementName, const char *padName,
+                              AllocationInspector *inspector,
+                              TimingAnalyzer *timing,
                               QWidget *parent, Qt::WindowFlags flags)
 : QWidget (parent, flags)
 {
@@ -90,6 +170,83 @@ PadProperties::PadProperties (QSharedPointer<GraphManager> pGraphManager,
     gst_caps_unref (caps);
   }
 
+  /* the allocation of a link is negotiated by its source pad */
+  GstPad *srcPad = (GST_PAD_DIRECTION (pad) == GST_PAD_SRC)
+      ? GST_PAD (gst_object_ref (pad)) : gst_pad_get_peer (pad);
+
+  if (srcPad) {
+    GstObject *parent = GST_OBJECT_PARENT (srcPad);
+    std::string name = std::string (parent ? GST_OBJECT_NAME (parent) : "")
+        + ":" + GST_OBJECT_NAME (srcPad);
+
+    const LinkAllocation *link = NULL;
+    if (inspector && inspector->isRunning ()) {
+      std::map<std::string, LinkAllocation>::const_iterator it =
+          inspector->links ().find (name);
+      if (it != inspector->links ().end ())
+        link = &it->second;
+    }
+
+    /* asked now when the negotiation was not seen */
+    AllocationAnswer answer;
+    if (link && link->m_answer.m_valid)
+      answer = link->m_answer;
+    else
+      AllocationInspector::queryAllocation (srcPad, answer);
+
+    play->addWidget (new QLabel ("Allocation"), 4, 0);
+    plbl = new QLabel (AllocationInspector::describe (answer));
+    plbl->setTextInteractionFlags (
+    Qt::TextSelectableByMouse | Qt::TextSelectableByKeyboard);
+    play->addWidget (plbl, 4, 1);
+
+    if (link) {
+      play->addWidget (new QLabel ("Buffers"), 5, 0);
+      plbl = new QLabel (AllocationInspector::describe (*link));
+      plbl->setTextInteractionFlags (
+      Qt::TextSelectableByMouse | Qt::TextSelectableByKeyboard);
+      if (link->m_problem == LinkAllocation::Copy)
+        plbl->setStyleSheet ("color: red");
+      play->addWidget (plbl, 5, 1);
+    }
+
+    const PadTiming *padTiming = NULL;
+    if (timing && timing->isRunning ()) {
+      std::map<std::string, PadTiming>::const_iterator it =
+          timing->pads ().find (name);
+      if (it != timing->pads ().end ())
+        padTiming = &it->second;
+    }
+
+    if (padTiming) {
+      play->addWidget (new QLabel ("Timing"), 6, 0);
+      plbl = new QLabel (TimingAnalyzer::describe (*padTiming));
+      plbl->setTextInteractionFlags (
+      Qt::TextSelectableByMouse | Qt::TextSelectableByKeyboard);
+      if (padTiming->m_warning)
+        plbl->setStyleSheet ("color: red");
+      play->addWidget (plbl, 6, 1);
+
+      std::vector<double> interArrival, deviation;
+      for (std::size_t i = 0; i < padTiming->m_samples.size (); i++) {
+        const TimingSample &sample = padTiming->m_samples[i];
+        /* the first buffer after a segment has nothing to compare with */
+        if (!sample.m_interArrival)
+          continue;
+        interArrival.push_back (sample.m_interArrival / (double) GST_MSECOND);
+        deviation.push_back (sample.m_deviation / (double) GST_MSECOND);
+      }
+
+      QVBoxLayout *phistograms = new QVBoxLayout;
+      phistograms->addWidget (new Histogram ("Inter-arrival (ms)", interArrival));
+      phistograms->addWidget (new Histogram ("Arrival minus timestamp delta (ms)",
+                                             deviation));
+      play->addLayout (phistograms, 7, 1);
+    }
+
+    gst_object_unref (srcPad);
+  }
+
   gst_object_unref (element);
   gst_object_unref (pad);
 
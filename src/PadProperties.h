@@ -6,10 +6,16 @@
 
 #include "GraphManager.h"
 
+class AllocationInspector;
+class TimingAnalyzer;
+
 class PadProperties: public QWidget
 {
 public:
+  /* the inspector and the analyzer, when running, add what they saw of the
+   * link */
   PadProperties(QSharedPointer<GraphManager> pGraphManager, const char *element, const char *pad
+      , AllocationInspector *inspector = 0, TimingAnalyzer *timing = 0
       , QWidget *parent = 0, Qt::WindowFlags flags = 0);
 };
 
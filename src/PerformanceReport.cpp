@@ -0,0 +1,174 @@
+#include "PerformanceReport.h"
+
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTimer>
+
+#include <atomic>
+#include <stdio.h>
+
+namespace
+{
+  struct HeadlessRun
+  {
+    QEventLoop *m_pLoop;
+    std::atomic<bool> m_eos;
+    std::atomic<bool> m_failed;
+  };
+
+  /* in the posting thread, the loop is quit from there */
+  void
+  headless_bus_listener (GstMessage *message, gpointer data)
+  {
+    HeadlessRun *run = (HeadlessRun *) data;
+
+    switch (GST_MESSAGE_TYPE (message)) {
+      case GST_MESSAGE_EOS:
+        run->m_eos = true;
+        break;
+      case GST_MESSAGE_ERROR: {
+        GError *error = NULL;
+        gst_message_parse_error (message, &error, NULL);
+        fprintf (stderr, "%s: %s\n", GST_OBJECT_NAME (GST_MESSAGE_SRC (message)),
+                 error ? error->message : "error");
+        g_clear_error (&error);
+        run->m_failed = true;
+        break;
+      }
+      default:
+        return;
+    }
+
+    QMetaObject::invokeMethod (run->m_pLoop, "quit", Qt::QueuedConnection);
+  }
+
+  /* max is null when unbounded */
+  QJsonObject
+  latencyToJson (const LatencyInfo &info)
+  {
+    QJsonObject object;
+    object["answered"] = info.m_valid;
+    if (!info.m_valid)
+      return object;
+
+    object["live"] = info.m_live;
+    object["min_ns"] = (double) info.m_min;
+    object["max_ns"] = GST_CLOCK_TIME_IS_VALID (info.m_max)
+        ? QJsonValue ((double) info.m_max) : QJsonValue ();
+    return object;
+  }
+
+  QJsonObject
+  qosToJson (const QosStats &stats)
+  {
+    QJsonObject window;
+    window["processed"] = (double) stats.m_processed;
+    window["dropped"] = (double) stats.m_dropped;
+    window["drop_rate"] = stats.DropRate ();
+    window["messages"] = (double) stats.m_messages;
+    window["max_jitter_ns"] = (double) stats.m_maxJitter;
+    window["min_proportion"] = stats.m_minProportion;
+
+    guint64 total = stats.m_totalProcessed + stats.m_totalDropped;
+
+    QJsonObject object;
+    object["processed"] = (double) stats.m_totalProcessed;
+    object["dropped"] = (double) stats.m_totalDropped;
+    object["drop_rate"] = total ? (double) stats.m_totalDropped / total : 0;
+    object["jitter_ns"] = (double) stats.m_jitter;
+    object["proportion"] = stats.m_proportion;
+    object["window"] = window;
+    if (!stats.m_upstream.empty ())
+      object["upstream"] = QString (stats.m_upstream.c_str ());
+    return object;
+  }
+}
+
+void
+PerformanceReport::fill (MetricsReport &report, GraphManager *graph)
+{
+  std::map<std::string, QosStats> qos = graph->GetQos ();
+
+  QJsonObject elements;
+  std::map<std::string, QosStats>::const_iterator it;
+  for (it = qos.begin (); it != qos.end (); ++it)
+    elements[QString (it->first.c_str ())] = qosToJson (it->second);
+
+  QJsonObject section;
+  section["window_s"] = (double) QOS_WINDOW / G_USEC_PER_SEC;
+  section["elements"] = elements;
+  report.addSection ("qos", section);
+
+  PipelineLatency latency = graph->GetLatency (true);
+
+  QJsonObject sinks;
+  for (std::size_t i = 0; i < latency.m_sinks.size (); i++) {
+    const SinkLatency &sink = latency.m_sinks[i];
+    QJsonObject object = latencyToJson (sink.m_sink);
+
+    QJsonArray branch;
+    for (std::size_t j = 0; j < sink.m_branch.size (); j++) {
+      QJsonObject link = latencyToJson (sink.m_branch[j]);
+      link["element"] = QString (sink.m_branch[j].m_element.c_str ());
+      link["pad"] = QString (sink.m_branch[j].m_pad.c_str ());
+      link["depth"] = sink.m_branch[j].m_depth;
+      branch.append (link);
+    }
+    object["branch"] = branch;
+    sinks[QString (sink.m_sink.m_element.c_str ())] = object;
+  }
+
+  QJsonObject latencySection;
+  latencySection["pipeline"] = latencyToJson (latency.m_pipeline);
+  latencySection["configured_ns"] = GST_CLOCK_TIME_IS_VALID (latency.m_configured)
+      ? QJsonValue ((double) latency.m_configured) : QJsonValue ();
+  latencySection["sinks"] = sinks;
+  report.addSection ("latency", latencySection);
+}
+
+int
+PerformanceReport::runHeadless (GraphManager *graph, int duration,
+                                const QString &fileName)
+{
+  QEventLoop loop;
+  HeadlessRun run;
+  run.m_pLoop = &loop;
+  run.m_eos = false;
+  run.m_failed = false;
+
+  graph->AddBusListener (headless_bus_listener, &run);
+
+  QElapsedTimer elapsed;
+  elapsed.start ();
+
+  bool played = graph->Play ();
+  if (played && !run.m_failed && !run.m_eos) {
+    if (duration > 0)
+      QTimer::singleShot (duration * 1000, &loop, SLOT (quit ()));
+    loop.exec ();
+  }
+
+  /* fills the report with the pipeline as it ended */
+  MetricsReport report;
+  fill (report, graph);
+
+  graph->Stop ();
+  graph->RemoveBusListener (headless_bus_listener, &run);
+
+  QJsonObject summary;
+  summary["duration_s"] = elapsed.elapsed () / 1000.0;
+  summary["result"] = QString (!played || run.m_failed ? "error"
+                               : run.m_eos ? "eos" : "timeout");
+  report.addSection ("run", summary);
+
+  QString error;
+  if (!report.write (fileName, error)) {
+    fprintf (stderr, "Could not write %s: %s\n", fileName.toStdString ().c_str (),
+             error.toStdString ().c_str ());
+    return 1;
+  }
+
+  return (!played || run.m_failed) ? 1 : 0;
+}
@@ -0,0 +1,21 @@
+#ifndef PERFORMANCE_REPORT_H_
+#define PERFORMANCE_REPORT_H_
+
+#include <QString>
+
+#include "GraphManager.h"
+#include "MetricsReport.h"
+
+/* What pipeviz measures on a running pipeline, as metrics report
+ * sections. */
+namespace PerformanceReport
+{
+  void fill(MetricsReport &report, GraphManager *graph);
+
+  /* plays the pipeline without any window until EOS, an error or duration
+   * seconds (0 for no limit), then writes the report to fileName. Returns
+   * the exit code. */
+  int runHeadless(GraphManager *graph, int duration, const QString &fileName);
+}
+
+#endif
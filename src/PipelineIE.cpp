@@ -1,333 +1,279 @@
 #include "PipelineIE.h"
 
-#include <QFile>
-#include <QXmlStreamWriter>
+#include <QFileInfo>
 #include <QMessageBox>
-#include <QDomDocument>
+#include <QSaveFile>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QStringList>
 
 #include <vector>
 
+#include "Profiler.h"
+#include "SnapshotFormat.h"
 
-static void
-clearPipeline (GstElement *pipeline)
-{
-  if (!pipeline)
-    return;
+#define IMPORT_PREROLL_TIMEOUT (10 * GST_SECOND)
 
-  GstIterator *iter;
-  iter = gst_bin_iterate_elements (GST_BIN (pipeline));
-  GstElement *element = NULL;
-  bool done = false;
-  while (!done) {
-#if GST_VERSION_MAJOR >= 1
-    GValue value = G_VALUE_INIT;
-    switch (gst_iterator_next (iter, &value))
-    {
-      case GST_ITERATOR_OK:
-      {
-        element = GST_ELEMENT(g_value_get_object(&value));
-#else
-    switch (gst_iterator_next (iter, (gpointer *) &element)) {
-      case GST_ITERATOR_OK: {
-#endif
-        gst_bin_remove (GST_BIN (pipeline), element);
-#if GST_VERSION_MAJOR >= 1
-        g_value_reset (&value);
-#endif
-        iter = gst_bin_iterate_elements (GST_BIN (pipeline));
-        if (!iter)
-          done = true;
-
-        break;
-      }
-      case GST_ITERATOR_DONE:
-      case GST_ITERATOR_RESYNC:
-      case GST_ITERATOR_ERROR: {
-        done = true;
-        break;
-      }
-    };
-  }
-
-  gst_iterator_free (iter);
-}
 
 namespace
 {
   struct Connection
   {
-    std::string element1;
-    std::string pad1;
-    std::string element2;
-    std::string pad2;
+    std::size_t element1;
+    std::size_t pad1;
+    std::size_t element2;
+    std::size_t pad2;
   };
-}
-
-static void
-writeProperties (QXmlStreamWriter &xmlWriter, const GstElement *element)
-{
-  GParamSpec **prop_specs;
-  guint num_props;
-
-  prop_specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (element),
-                                               &num_props);
 
-  if (!num_props)
-    return;
+  /* Element and pad names are repeated for every connection, keep a single
+   * copy of each and refer to it by index. */
+  class NameTable
+  {
+  public:
+    std::size_t intern (const QString &name)
+    {
+      QHash<QString, std::size_t>::const_iterator itr = m_ids.constFind (name);
+      if (itr != m_ids.constEnd ())
+        return itr.value ();
+
+      std::size_t id = m_names.size ();
+      m_names.push_back (name.toStdString ());
+      m_ids.insert (name, id);
+      return id;
+    }
 
-  xmlWriter.writeStartElement ("properties");
+    const char *name (std::size_t id) const
+    {
+      return m_names[id].c_str ();
+    }
 
-  for (std::size_t i = 0; i < num_props; i++) {
-    GParamSpec *param = prop_specs[i];
+  private:
+    QHash<QString, std::size_t> m_ids;
+    std::vector<std::string> m_names;
+  };
 
-    if ((param->flags & G_PARAM_READABLE)
-    && (param->flags & G_PARAM_WRITABLE)) {
-      GValue value = G_VALUE_INIT;
-      g_value_init (&value, param->value_type);
+  typedef QPair<quint64, quint64> ConnectionKey;
 
-      g_object_get_property (G_OBJECT (element), param->name, &value);
+  ConnectionKey
+  connectionKey (std::size_t element1, std::size_t pad1, std::size_t element2,
+                 std::size_t pad2)
+  {
+    quint64 end1 = ((quint64) element1 << 32) | (quint32) pad1;
+    quint64 end2 = ((quint64) element2 << 32) | (quint32) pad2;
 
-      if (!g_param_value_defaults (param, &value)) {
-        bool skip = false;
-        QString propertyName = g_param_spec_get_name (param);
-        QString propertyValue;
+    /* links are written from both sides, store them undirected */
+    if (end1 < end2)
+      return qMakePair (end1, end2);
+    return qMakePair (end2, end1);
+  }
+}
 
-        switch (G_VALUE_TYPE (&value)) {
-          case G_TYPE_STRING: {
+static void
+create_requst_pad (GstElement *element, const QString &templateName,
+                   const QString &padName)
+{
+  GstElementClass *klass = GST_ELEMENT_GET_CLASS (element);
 
-            const char *string_val = g_value_get_string (&value);
-            if (string_val)
-              propertyValue = string_val;
-            else
-              skip = true;
-            break;
-          }
-          case G_TYPE_BOOLEAN: {
-            gboolean bool_val = g_value_get_boolean (&value);
-            propertyValue = QString::number (bool_val);
-            break;
-          }
-          case G_TYPE_ULONG: {
-            propertyValue = QString::number (g_value_get_ulong (&value));
-            break;
-          }
-          case G_TYPE_LONG: {
-            propertyValue = QString::number (g_value_get_long (&value));
-            break;
-          }
-          case G_TYPE_UINT: {
-            propertyValue = QString::number (g_value_get_uint (&value));
-            break;
-          }
-          case G_TYPE_INT: {
-            propertyValue = QString::number (g_value_get_int (&value));
-            break;
-          }
-          case G_TYPE_UINT64: {
-            propertyValue = QString::number (g_value_get_uint64 (&value));
-            break;
-          }
-          case G_TYPE_INT64: {
-            propertyValue = QString::number (g_value_get_int64 (&value));
-            break;
-          }
-          case G_TYPE_FLOAT: {
-            propertyValue = QString::number (g_value_get_float (&value));
-            break;
-          }
-          case G_TYPE_DOUBLE: {
-            propertyValue = QString::number (g_value_get_double (&value));
-            break;
-          }
-          default: {
-            gchar *elementName = gst_element_get_name (element);
-            LOG_INFO("property `%s` for `%s` not supported", propertyName.toStdString ().c_str (), elementName);
-            g_free (elementName);
+  GstPadTemplate *templ = gst_element_class_get_pad_template (
+  klass, templateName.toStdString ().c_str ());
 
-            skip = true;
-            break;
-          }
-        };
+  gst_element_request_pad (element, templ, padName.toStdString ().c_str (),
+  NULL);
+}
 
-        if (!skip) {
-          xmlWriter.writeStartElement ("property");
-          xmlWriter.writeAttribute ("name", propertyName);
-          xmlWriter.writeAttribute ("value", propertyValue);
-          xmlWriter.writeEndElement ();
-        }
-        g_value_reset (&value);
+/* Gets the value of a property which differs from its default and can be
+ * set back. Strings are kept as they are, everything else goes through
+ * gst_value_serialize, which covers enums, flags, caps and structures. */
+static bool
+propertyValue (GstElement *element, GParamSpec *param, QString &res)
+{
+  if (!(param->flags & G_PARAM_READABLE) || !(param->flags & G_PARAM_WRITABLE)
+  || (param->flags & G_PARAM_CONSTRUCT_ONLY))
+    return false;
 
+  GValue value = G_VALUE_INIT;
+  g_value_init (&value, param->value_type);
+  g_object_get_property (G_OBJECT (element), param->name, &value);
+
+  bool found = false;
+  if (!g_param_value_defaults (param, &value)) {
+    if (G_VALUE_HOLDS_STRING (&value)) {
+      const char *string_val = g_value_get_string (&value);
+      if (string_val) {
+        res = string_val;
+        found = true;
+      }
+    }
+    else {
+      gchar *serialized = gst_value_serialize (&value);
+      if (serialized) {
+        res = serialized;
+        found = true;
+        g_free (serialized);
+      }
+      else {
+        gchar *elementName = gst_element_get_name (element);
+        LOG_INFO("property `%s` for `%s` not supported", param->name, elementName);
+        g_free (elementName);
       }
     }
   }
 
-  xmlWriter.writeEndElement ();
-
-  g_free (prop_specs);
+  g_value_unset (&value);
+  return found;
 }
 
 static void
-loadProperties (QDomElement node, GstElement *element)
+writeProperties (SnapshotSink &sink, GstElement *element)
 {
-  QDomNode child = node.firstChild ();
-  while (!child.isNull ()) {
-    if (child.toElement ().tagName () == "property") {
-      QString name = child.toElement ().attribute ("name");
-      QString value = child.toElement ().attribute ("value");
+  guint num_props;
+  GParamSpec **prop_specs = g_object_class_list_properties (
+  G_OBJECT_GET_CLASS (element), &num_props);
 
-      GParamSpec *param = g_object_class_find_property (
-      G_OBJECT_GET_CLASS (element), name.toStdString ().c_str ());
+  for (guint i = 0; i < num_props; i++) {
+    QString value;
+    if (propertyValue (element, prop_specs[i], value))
+      sink.property (g_param_spec_get_name (prop_specs[i]), value);
+  }
 
-      if (!param) {
-        gchar *elementName = gst_element_get_name (element);
-        LOG_INFO("problem with setting property `%s` for `%s`", name.toStdString ().c_str (), elementName);
-        g_free (elementName);
-        continue;
-      }
+  g_free (prop_specs);
+}
 
-      if (!(param->flags & G_PARAM_WRITABLE))
-        continue;
+typedef std::vector<QPair<QString, QString> > PropertyList;
 
-      std::string tmpStr = name.toStdString ();
-      const char *propName = tmpStr.c_str ();
-      switch (param->value_type) {
-        case G_TYPE_STRING: {
-          g_object_set (G_OBJECT (element), propName,
-                        value.toStdString ().c_str (), NULL);
-          break;
-        }
-        case G_TYPE_BOOLEAN: {
-          gboolean val = value.toInt ();
-          g_object_set (G_OBJECT (element), propName, val, NULL);
-          break;
-        }
-        case G_TYPE_ULONG: {
-          gulong val = value.toULong ();
-          g_object_set (G_OBJECT (element), propName, val, NULL);
-          break;
-        }
-        case G_TYPE_LONG: {
-          glong val = value.toLong ();
-          g_object_set (G_OBJECT (element), propName, val, NULL);
-          break;
-        }
-        case G_TYPE_UINT: {
-          guint val = value.toUInt ();
-          g_object_set (G_OBJECT (element), propName, val, NULL);
-          break;
-        }
-        case G_TYPE_INT: {
-          gint val = value.toInt ();
-          g_object_set (G_OBJECT (element), propName, val, NULL);
-          break;
-        }
-        case G_TYPE_UINT64: {
-          guint64 val = value.toULongLong ();
-          g_object_set (G_OBJECT (element), propName, val, NULL);
-          break;
-        }
-        case G_TYPE_INT64: {
-          gint64 val = value.toLongLong ();
-          g_object_set (G_OBJECT (element), propName, val, NULL);
-          break;
-        }
-        case G_TYPE_FLOAT: {
-          gfloat val = value.toFloat ();
-          g_object_set (G_OBJECT (element), propName, val, NULL);
-          break;
-        }
-        case G_TYPE_DOUBLE: {
-          gdouble val = value.toDouble ();
-          g_object_set (G_OBJECT (element), propName, val, NULL);
-          break;
-        }
-        default: {
-          gchar *elementName = gst_element_get_name (element);
-          LOG_INFO("property `%s` for `%s` not supported", propName, elementName);
-          g_free (elementName);
-          break;
-        }
-      };
+/* Deserializes all the properties of an element and sets them at once, so
+ * that notifications are emitted only once per element. */
+static void
+applyProperties (GstElement *element, const PropertyList &properties)
+{
+  std::vector<std::string> names;
+  std::vector<GValue> values;
+  names.reserve (properties.size ());
+  values.reserve (properties.size ());
+
+  for (std::size_t i = 0; i < properties.size (); i++) {
+    std::string name = properties[i].first.toStdString ();
+    GParamSpec *param = g_object_class_find_property (
+    G_OBJECT_GET_CLASS (element), name.c_str ());
+
+    if (!param) {
+      gchar *elementName = gst_element_get_name (element);
+      LOG_INFO("problem with setting property `%s` for `%s`", name.c_str (), elementName);
+      g_free (elementName);
+      continue;
     }
 
-    child = child.nextSibling ();
+    if (!(param->flags & G_PARAM_WRITABLE)
+    || (param->flags & G_PARAM_CONSTRUCT_ONLY))
+      continue;
+
+    GValue value = G_VALUE_INIT;
+    g_value_init (&value, param->value_type);
+
+    std::string str = properties[i].second.toStdString ();
+    bool res = true;
+    if (G_VALUE_HOLDS_STRING (&value))
+      g_value_set_string (&value, str.c_str ());
+    else
+      res = gst_value_deserialize (&value, str.c_str ());
+
+    if (!res) {
+      gchar *elementName = gst_element_get_name (element);
+      LOG_INFO("cannot parse `%s` for property `%s` of `%s`", str.c_str (), name.c_str (), elementName);
+      g_free (elementName);
+      g_value_unset (&value);
+      continue;
+    }
+
+    names.push_back (name);
+    values.push_back (value);
   }
 
-}
+  if (values.empty ())
+    return;
 
-static void
-create_requst_pad (GstElement *element, const QString &templateName,
-                   const QString &padName)
-{
-  GstElementClass *klass = GST_ELEMENT_GET_CLASS (element);
+#if GLIB_CHECK_VERSION(2, 54, 0)
+  std::vector<const char *> propNames (names.size ());
+  for (std::size_t i = 0; i < names.size (); i++)
+    propNames[i] = names[i].c_str ();
 
-  GstPadTemplate *templ = gst_element_class_get_pad_template (
-  klass, templateName.toStdString ().c_str ());
+  g_object_setv (G_OBJECT (element), values.size (), &propNames[0],
+                 &values[0]);
+#else
+  g_object_freeze_notify (G_OBJECT (element));
+  for (std::size_t i = 0; i < names.size (); i++)
+    g_object_set_property (G_OBJECT (element), names[i].c_str (), &values[i]);
+  g_object_thaw_notify (G_OBJECT (element));
+#endif
 
-  gst_element_request_pad (element, templ, padName.toStdString ().c_str (),
-  NULL);
+  for (std::size_t i = 0; i < values.size (); i++)
+    g_value_unset (&values[i]);
 }
 
-bool
-PipelineIE::Export (QSharedPointer<GraphManager> pgraph,
-                    const QString &fileName)
+static QString
+quoteLaunchValue (const QString &value)
 {
-  QFile file (fileName);
-
-  if (!file.open (QIODevice::WriteOnly)) {
-    QMessageBox::warning (0, "Read only", "The file is in read only mode");
-    return false;
+  bool plain = !value.isEmpty ();
+  for (int i = 0; i < value.size () && plain; i++) {
+    QChar ch = value[i];
+    if (!ch.isLetterOrNumber () && ch != '_' && ch != '-' && ch != '.'
+    && ch != ':' && ch != '/' && ch != '+')
+      plain = false;
   }
 
-  std::vector<ElementInfo> info = pgraph->GetInfo ();
+  if (plain)
+    return value;
 
-  QXmlStreamWriter xmlWriter;
-  xmlWriter.setDevice (&file);
-  xmlWriter.writeStartDocument ();
-  xmlWriter.writeStartElement ("pipeline");
+  QString res = value;
+  res.replace ("\\", "\\\\");
+  res.replace ("\"", "\\\"");
+  return "\"" + res + "\"";
+}
+
+/* Walks the graph and reports it element by element. */
+static void
+writeGraph (QSharedPointer<GraphManager> pgraph, SnapshotSink &sink)
+{
+  std::vector<ElementInfo> info = pgraph->GetInfo ();
 
   for (std::size_t i = 0; i < info.size (); i++) {
-    xmlWriter.writeStartElement ("element");
+    /* children of expanded bins are recreated by the bins themselves */
+    if (info[i].m_parentId != (size_t) -1)
+      continue;
 
-    xmlWriter.writeAttribute ("name", info[i].m_name.c_str ());
-    xmlWriter.writeAttribute ("plugin-name", info[i].m_pluginName.c_str ());
+    sink.beginElement (info[i].m_name.c_str (), info[i].m_pluginName.c_str ());
 
     GstElement *element = gst_bin_get_by_name (GST_BIN (pgraph->m_pGraph),
                                                info[i].m_name.c_str ());
 
     for (std::size_t j = 0; j < info[i].m_pads.size (); j++) {
-      xmlWriter.writeStartElement ("pad");
-
-      xmlWriter.writeAttribute ("name", info[i].m_pads[j].m_name.c_str ());
-
       GstPad *pad = gst_element_get_static_pad (
       element, info[i].m_pads[j].m_name.c_str ());
 
       GstPadTemplate *templ = gst_pad_get_pad_template (pad);
       if (templ) {
-        QString presence;
+        SnapshotSink::Presence presence = SnapshotSink::Always;
         switch (GST_PAD_TEMPLATE_PRESENCE (templ)) {
           case GST_PAD_ALWAYS:
-            presence = "always";
+            presence = SnapshotSink::Always;
             break;
 
           case GST_PAD_SOMETIMES:
-            presence = "sometimes";
+            presence = SnapshotSink::Sometimes;
             break;
 
           case GST_PAD_REQUEST:
-            presence = "request";
+            presence = SnapshotSink::Request;
             break;
         };
 
-        xmlWriter.writeAttribute ("presence", presence);
-        xmlWriter.writeAttribute ("template-name",
-                                  GST_PAD_TEMPLATE_NAME_TEMPLATE (templ));
+        sink.pad (info[i].m_pads[j].m_name.c_str (), presence,
+                  GST_PAD_TEMPLATE_NAME_TEMPLATE (templ));
       }
       else {
         LOG_INFO("Unable to find a template for %s", info[i].m_pads[j].m_name.c_str());
-        xmlWriter.writeAttribute ("presence", "always");
-        xmlWriter.writeAttribute ("template-name", "");
+        sink.pad (info[i].m_pads[j].m_name.c_str (), SnapshotSink::Always, "");
       }
       gst_object_unref (pad);
 
@@ -346,256 +292,780 @@ PipelineIE::Export (QSharedPointer<GraphManager> pgraph,
           }
         }
         if (elementPos < info.size ()
-        && padPos < info[elementPos].m_pads.size ()) {
-          xmlWriter.writeStartElement ("connected-to");
-          xmlWriter.writeAttribute ("element-name",
-                                    info[elementPos].m_name.c_str ());
-          xmlWriter.writeAttribute (
-          "pad-name", info[elementPos].m_pads[padPos].m_name.c_str ());
-          xmlWriter.writeEndElement ();
+        && padPos < info[elementPos].m_pads.size ())
+          sink.connection (info[elementPos].m_name.c_str (),
+                           info[elementPos].m_pads[padPos].m_name.c_str ());
+      }
+    }
+
+    writeProperties (sink, element);
+    gst_object_unref (element);
+
+    sink.endElement ();
+  }
+}
+
+namespace
+{
+  /* Creates the elements as soon as they are reported and links them once
+   * both of their ends exist. */
+  class GraphBuilder: public SnapshotSink
+  {
+  public:
+    GraphBuilder (QSharedPointer<GraphManager> pgraph)
+    : m_pgraph (pgraph), m_element (NULL), m_elementId (0), m_padId (0)
+    {
+    }
+
+    void
+    beginPipeline ()
+    {
+      m_pgraph->Clear ();
+    }
+
+    void
+    beginElement (const QString &name, const QString &pluginName)
+    {
+      m_element = NULL;
+      m_properties.clear ();
+      m_elementId = m_names.intern (name);
+
+      GstElement *pel = gst_element_factory_make (
+      pluginName.toStdString ().c_str (), m_names.name (m_elementId));
+
+      if (!pel) {
+        QMessageBox::warning (
+        0,
+        "Element creation failed",
+        QString ("Could not create element of `") + pluginName + "` with name `"
+        + name + "`");
+        return;
+      }
+
+      if (!gst_bin_add (GST_BIN (m_pgraph->m_pGraph), pel)) {
+        QMessageBox::warning (
+        0, "Element insertion failed",
+        QString ("Could not insert element `") + name + "` to pipeline");
+        return;
+      }
+
+      gst_element_sync_state_with_parent (pel);
+      m_element = pel;
+    }
+
+    void
+    pad (const QString &name, Presence presence, const QString &templateName)
+    {
+      if (!m_element)
+        return;
+
+      m_padId = m_names.intern (name);
+
+      if (presence == Request)
+        create_requst_pad (m_element, templateName, name);
+    }
+
+    void
+    connection (const QString &peerElement, const QString &peerPad)
+    {
+      if (!m_element)
+        return;
+
+      std::size_t peerId = m_names.intern (peerElement);
+      std::size_t peerPadId = m_names.intern (peerPad);
+
+      ConnectionKey key = connectionKey (m_elementId, m_padId, peerId, peerPadId);
+      if (m_connectionKeys.contains (key))
+        return;
+      m_connectionKeys.insert (key);
+
+      Connection newConnetion;
+      newConnetion.element1 = m_elementId;
+      newConnetion.pad1 = m_padId;
+      newConnetion.element2 = peerId;
+      newConnetion.pad2 = peerPadId;
+      m_connections.push_back (newConnetion);
+    }
+
+    void
+    property (const QString &name, const QString &value)
+    {
+      if (m_element)
+        m_properties.push_back (qMakePair (name, value));
+    }
+
+    void
+    endElement ()
+    {
+      if (m_element)
+        applyProperties (m_element, m_properties);
+
+      m_properties.clear ();
+      m_element = NULL;
+    }
+
+    bool
+    link ()
+    {
+      for (std::size_t i = 0; i < m_connections.size (); i++) {
+        if (!m_pgraph->ConnectWhenReady (m_names.name (m_connections[i].element1),
+                                         m_names.name (m_connections[i].pad1),
+                                         m_names.name (m_connections[i].element2),
+                                         m_names.name (m_connections[i].pad2))) {
+          QMessageBox::warning (
+          0,
+          "Internal error",
+          QString ("Could not find one of elements `")
+          + QString (m_names.name (m_connections[i].element1)) + "`, `"
+          + QString (m_names.name (m_connections[i].element2)) + "`");
+
+          return false;
         }
       }
 
-      xmlWriter.writeEndElement ();
+      return true;
     }
 
-    writeProperties (xmlWriter, element);
-    gst_object_unref (element);
+  private:
+    QSharedPointer<GraphManager> m_pgraph;
+    NameTable m_names;
+    QSet<ConnectionKey> m_connectionKeys;
+    std::vector<Connection> m_connections;
+
+    GstElement *m_element;
+    PropertyList m_properties;
+    std::size_t m_elementId;
+    std::size_t m_padId;
+  };
+}
 
-    xmlWriter.writeEndElement ();
+namespace
+{
+  /* Sends a snapshot into a writer, false if it could not */
+  class SnapshotProducer
+  {
+  public:
+    virtual ~SnapshotProducer () {}
+    virtual bool produce (SnapshotSink &sink) = 0;
+  };
+
+  class GraphProducer: public SnapshotProducer
+  {
+  public:
+    GraphProducer (QSharedPointer<GraphManager> pgraph)
+    : m_pGraph (pgraph)
+    {
+    }
+
+    bool
+    produce (SnapshotSink &sink)
+    {
+      writeGraph (m_pGraph, sink);
+      return true;
+    }
+
+  private:
+    QSharedPointer<GraphManager> m_pGraph;
+  };
+
+  class FileProducer: public SnapshotProducer
+  {
+  public:
+    FileProducer (const QString &fileName)
+    : m_fileName (fileName)
+    {
+    }
+
+    bool
+    produce (SnapshotSink &sink)
+    {
+      return SnapshotFormat::readFile (m_fileName, sink, m_error);
+    }
+
+    QString m_fileName;
+    QString m_error;
+  };
+}
+
+/* The file is only replaced once the whole snapshot has been written, a
+ * failure leaves what was there before. */
+static bool
+writeSnapshot (const QString &fileName, SnapshotProducer &producer)
+{
+  QSaveFile file (fileName);
+
+  if (!file.open (QIODevice::WriteOnly)) {
+    QMessageBox::warning (0, "Read only", "The file is in read only mode");
+    return false;
   }
 
-  xmlWriter.writeEndElement ();
-  xmlWriter.writeEndDocument ();
+  SnapshotFormat::Format format = SnapshotFormat::formatForFileName (fileName);
+  bool produced;
+  bool res;
+
+  if (format == SnapshotFormat::Xml) {
+    XmlSnapshotWriter writer (&file);
+    produced = producer.produce (writer);
+    res = produced && writer.finish ();
+  }
+  else {
+    BinarySnapshotWriter writer;
+    produced = producer.produce (writer);
+    res = produced && writer.finish (&file, format == SnapshotFormat::CompressedBinary);
+  }
+
+  /* the producer tells why itself */
+  if (!produced)
+    return false;
+
+  if (!res || !file.commit ()) {
+    QMessageBox::warning (0, "Write failed",
+                          QString ("Cannot write file ") + fileName);
+    return false;
+  }
 
   return true;
 }
 
+bool
+PipelineIE::Export (QSharedPointer<GraphManager> pgraph,
+                    const QString &fileName)
+{
+  GraphProducer producer (pgraph);
+  return writeSnapshot (fileName, producer);
+}
+
 bool
 PipelineIE::Import (QSharedPointer<GraphManager> pgraph,
                     const QString &fileName)
 {
-  GstElement *pipeline = pgraph->m_pGraph;
-  QFile file (fileName);
-  if (!file.open (QFile::ReadOnly | QFile::Text)) {
-    QMessageBox::warning (
-    0, "Open failed",
-    QString ("Cannot read file ") + fileName + ": " + file.errorString ());
+  Profiler::Scope profile ("Import");
+
+  GraphBuilder builder (pgraph);
+  QString error;
+
+  if (!SnapshotFormat::readFile (fileName, builder, error)) {
+    QMessageBox::warning (0, "Open failed", error);
+    return false;
+  }
 
+  if (!builder.link ())
     return false;
+
+  GstElement *pipeline = pgraph->m_pGraph;
+
+  /* Sometimes pads show up while prerolling and are linked from pad-added
+   * right away, so waiting for the preroll is enough. */
+  if (pgraph->HasPendingLinks ()) {
+    gst_element_set_state (pipeline, GST_STATE_PAUSED);
+    gst_element_get_state (pipeline, NULL, NULL, IMPORT_PREROLL_TIMEOUT);
   }
+  else
+    gst_element_set_state (pipeline, GST_STATE_READY);
 
-  QString errorStr;
-  int errorLine;
-  int errorColumn;
+  return true;
+}
 
-  QDomDocument doc;
-  if (!doc.setContent (&file, false, &errorStr, &errorLine, &errorColumn)) {
-    QMessageBox::warning (
-    0, "Xml parsing failed",
-    QString ("Parse error at line ") + QString::number (errorLine) + ", "
-    "column " + QString::number (errorColumn) + ": " + errorStr);
+bool
+PipelineIE::Convert (const QString &source, const QString &target)
+{
+  Profiler::Scope profile ("Convert");
+
+  /* the target is only written once the source has been read through */
+  QFileInfo sourceInfo (source);
+  QFileInfo targetInfo (target);
+  if (targetInfo.exists ()
+  && sourceInfo.canonicalFilePath () == targetInfo.canonicalFilePath ()) {
+    QMessageBox::warning (0, "Convert failed",
+                          "The source and the target are the same file");
+    return false;
+  }
+
+  FileProducer producer (source);
+  if (!writeSnapshot (target, producer)) {
+    if (!producer.m_error.isEmpty ())
+      QMessageBox::warning (0, "Convert failed", producer.m_error);
     return false;
   }
 
-  clearPipeline (pipeline);
+  return true;
+}
 
-  QDomElement root = doc.documentElement ();
+bool
+PipelineIE::ImportLaunch (QSharedPointer<GraphManager> pgraph,
+                          const QString &description)
+{
+  Profiler::Scope profile ("ImportLaunch");
+
+  GstParseContext *context = gst_parse_context_new ();
+  GError *error = NULL;
+  GstElement *parsed = gst_parse_launch_full (
+  description.toStdString ().c_str (), context,
+  (GstParseFlags) (GST_PARSE_FLAG_FATAL_ERRORS | GST_PARSE_FLAG_PLACE_IN_BIN),
+  &error);
+
+  if (!parsed) {
+    QString msg = QString ("Could not parse the description: ")
+    + (error ? error->message : "unknown error");
+
+    gchar **missing = gst_parse_context_get_missing_elements (context);
+    if (missing) {
+      gchar *missingStr = g_strjoinv (", ", missing);
+      msg += QString ("\nMissing elements: ") + missingStr;
+      g_free (missingStr);
+      g_strfreev (missing);
+    }
 
-  if (root.tagName () != "pipeline") {
-    QMessageBox::warning (0, "Parsing failed", "Is invalid pipeline file");
+    QMessageBox::warning (0, "Launch description import failed", msg);
+    g_clear_error (&error);
+    gst_parse_context_free (context);
     return false;
   }
 
-  QDomNode child = root.firstChild ();
+  if (error) {
+    LOG_INFO("launch description parsed with warning: %s", error->message);
+    g_clear_error (&error);
+  }
+  gst_parse_context_free (context);
+
+  if (g_object_is_floating (parsed))
+    gst_object_ref_sink (parsed);
+
+  /* Removing the elements from the parsed bin unlinks them, so the links
+   * are recorded first and made again in our pipeline. */
+  std::vector<GstElement *> elements;
+  GstIterator *iter = gst_bin_iterate_elements (GST_BIN (parsed));
+  GValue value = G_VALUE_INIT;
+  while (gst_iterator_next (iter, &value) == GST_ITERATOR_OK) {
+    elements.push_back (
+    GST_ELEMENT (gst_object_ref (g_value_get_object (&value))));
+    g_value_reset (&value);
+  }
+  g_value_unset (&value);
+  gst_iterator_free (iter);
 
-  std::vector<Connection> connections;
-  while (!child.isNull ()) {
-    if (child.toElement ().tagName () == "element") {
-      QDomElement elNode = child.toElement ();
+  std::vector<Connection> links;
+  NameTable names;
+  for (std::size_t i = 0; i < elements.size (); i++) {
+    GstIterator *padItr = gst_element_iterate_src_pads (elements[i]);
+    GValue padVal = G_VALUE_INIT;
+    while (gst_iterator_next (padItr, &padVal) == GST_ITERATOR_OK) {
+      GstPad *pad = GST_PAD (g_value_get_object (&padVal));
+      GstPad *peer = gst_pad_get_peer (pad);
+      if (peer) {
+        GstElement *peerElement = gst_pad_get_parent_element (peer);
+        if (peerElement) {
+          Connection link;
+          link.element1 = names.intern (GST_OBJECT_NAME (elements[i]));
+          link.pad1 = names.intern (GST_OBJECT_NAME (pad));
+          link.element2 = names.intern (GST_OBJECT_NAME (peerElement));
+          link.pad2 = names.intern (GST_OBJECT_NAME (peer));
+          links.push_back (link);
+          gst_object_unref (peerElement);
+        }
+        gst_object_unref (peer);
+      }
+      g_value_reset (&padVal);
+    }
+    g_value_unset (&padVal);
+    gst_iterator_free (padItr);
+  }
 
-      GstElement *pel = gst_element_factory_make (
-      elNode.attribute ("plugin-name").toStdString ().c_str (),
-      elNode.attribute ("name").toStdString ().c_str ());
+  pgraph->Clear ();
 
-      if (!pel) {
-        QMessageBox::warning (
-        0,
-        "Element creation failed",
-        QString ("Could not create element of `")
-        + elNode.attribute ("plugin-name") + "` with name `"
-        + elNode.attribute ("name") + "`");
+  GstElement *pipeline = pgraph->m_pGraph;
+  for (std::size_t i = 0; i < elements.size (); i++) {
+    gst_bin_remove (GST_BIN (parsed), elements[i]);
+    if (!gst_bin_add (GST_BIN (pipeline), elements[i])) {
+      gchar *name = gst_element_get_name (elements[i]);
+      LOG_INFO("Could not insert element `%s` to pipeline", name);
+      g_free (name);
+    }
+    gst_object_unref (elements[i]);
+  }
+  gst_object_unref (parsed);
+
+  for (std::size_t i = 0; i < links.size (); i++) {
+    if (!pgraph->ConnectWhenReady (names.name (links[i].element1),
+                                   names.name (links[i].pad1),
+                                   names.name (links[i].element2),
+                                   names.name (links[i].pad2)))
+      LOG_INFO("Could not link `%s:%s` to `%s:%s`", names.name (links[i].element1), names.name (links[i].pad1), names.name (links[i].element2), names.name (links[i].pad2));
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_READY);
+
+  return true;
+}
+
+QString
+PipelineIE::ExportLaunch (QSharedPointer<GraphManager> pgraph)
+{
+  std::vector<ElementInfo> info = pgraph->GetInfo ();
+  QStringList parts;
+
+  /* every element is declared by name, then every link is spelled out with
+   * its pads, which covers request pads and graphs that are not chains */
+  for (std::size_t i = 0; i < info.size (); i++) {
+    if (info[i].m_parentId != (size_t) -1)
+      continue;
+
+    GstElement *element = gst_bin_get_by_name (GST_BIN (pgraph->m_pGraph),
+                                               info[i].m_name.c_str ());
+    if (!element)
+      continue;
+
+    QString declaration = QString (info[i].m_pluginName.c_str ()) + " name="
+    + quoteLaunchValue (info[i].m_name.c_str ());
+
+    guint num_props;
+    GParamSpec **prop_specs = g_object_class_list_properties (
+    G_OBJECT_GET_CLASS (element), &num_props);
 
-        child = child.nextSibling ();
+    for (guint j = 0; j < num_props; j++) {
+      if (!strcmp (prop_specs[j]->name, "name"))
         continue;
-      }
 
-      bool res = gst_bin_add (GST_BIN (pipeline), pel);
+      QString value;
+      if (propertyValue (element, prop_specs[j], value))
+        declaration += QString (" ") + prop_specs[j]->name + "="
+        + quoteLaunchValue (value);
+    }
 
-      if (!res) {
-        QMessageBox::warning (
-        0,
-        "Element insertion failed",
-        QString ("Could not insert element `") + elNode.attribute ("name")
-        + "` to pipeline");
+    g_free (prop_specs);
+    gst_object_unref (element);
+
+    parts << declaration;
+  }
+
+  for (std::size_t i = 0; i < info.size (); i++) {
+    if (info[i].m_parentId != (size_t) -1)
+      continue;
 
-        child = child.nextSibling ();
+    for (std::size_t j = 0; j < info[i].m_pads.size (); j++) {
+      const ElementInfo::Connection &connection = info[i].m_connections[j];
+      if (info[i].m_pads[j].m_type != PadInfo::Out
+      || connection.m_elementId == (size_t) -1
+      || connection.m_padId == (size_t) -1)
         continue;
-      }
 
-      gst_element_sync_state_with_parent (pel);
+      const ElementInfo &peer = info[connection.m_elementId];
+      if (peer.m_parentId != (size_t) -1)
+        continue;
 
-      QDomNode elementChild = elNode.firstChild ();
-      while (!elementChild.isNull ()) {
-        if (elementChild.toElement ().tagName () == "pad") {
-          QDomNode padChild = elementChild.firstChild ();
-          QDomElement elPad = elementChild.toElement ();
-//					GstPadPresence presence = GST_PAD_ALWAYS;
-
-          QString templaneName;
-          if (elPad.attribute ("presence") == "request")
-            create_requst_pad (pel, elPad.attribute ("template-name"),
-                               elPad.attribute ("name"));
-
-          while (!padChild.isNull ()) {
-            if (padChild.toElement ().tagName () == "connected-to") {
-              bool isExists = false;
-              QDomElement elCoonnectedTo = padChild.toElement ();
-
-              for (std::size_t i = 0; i < connections.size (); i++) {
-                if ((connections[i].element1
-                == elNode.attribute ("name").toStdString ()
-                && connections[i].element2
-                == elCoonnectedTo.attribute ("element-name").toStdString ()
-                && connections[i].pad1
-                == elPad.attribute ("name").toStdString ()
-                && connections[i].pad2
-                == elCoonnectedTo.attribute ("pad-name").toStdString ())
-                || (connections[i].element2
-                == elNode.attribute ("name").toStdString ()
-                && connections[i].element1
-                == elCoonnectedTo.attribute ("element-name").toStdString ()
-                && connections[i].pad2
-                == elPad.attribute ("name").toStdString ()
-                && connections[i].pad1
-                == elCoonnectedTo.attribute ("pad-name").toStdString ())) {
-                  isExists = true;
-                }
-              }
-
-              if (!isExists) {
-                Connection newConnetion;
-                newConnetion.element1 =
-                elNode.attribute ("name").toStdString ();
-                newConnetion.element2 = padChild.toElement ().attribute (
-                "element-name").toStdString ();
-                newConnetion.pad1 =
-                elementChild.toElement ().attribute ("name").toStdString ();
-                newConnetion.pad2 =
-                padChild.toElement ().attribute ("pad-name").toStdString ();
-
-                connections.push_back (newConnetion);
-              }
-            }
-            padChild = padChild.nextSibling ();
-          }
-        }
-        else if (elementChild.toElement ().tagName () == "properties") {
-          loadProperties (elementChild.toElement (), pel);
-        }
-        elementChild = elementChild.nextSibling ();
-      }
+      parts << QString ("%1.%2 ! %3.%4")
+      .arg (quoteLaunchValue (info[i].m_name.c_str ()))
+      .arg (quoteLaunchValue (info[i].m_pads[j].m_name.c_str ()))
+      .arg (quoteLaunchValue (peer.m_name.c_str ()))
+      .arg (quoteLaunchValue (peer.m_pads[connection.m_padId].m_name.c_str ()));
     }
-    child = child.nextSibling ();
   }
 
-  std::size_t maxStarts = 5;
-  bool setReady = true;
-  for (std::size_t k = 0; k < maxStarts; k++) {
-    if (connections.empty ())
-      break;
+  return parts.join ("  ");
+}
+
+namespace
+{
+  struct SnapshotPad
+  {
+    QString m_name;
+    SnapshotSink::Presence m_presence;
+    QString m_templateName;
+    std::vector<QPair<QString, QString> > m_connections;
+  };
 
-    if (k > 0)
-      setReady = false;
+  struct SnapshotElement
+  {
+    QString m_name;
+    QString m_pluginName;
+    std::vector<SnapshotPad> m_pads;
+    PropertyList m_properties;
+  };
 
-    while (true) {
-      std::size_t i = 0;
-      for (; i < connections.size (); i++) {
-        GstElement *el1 = gst_bin_get_by_name (
-        GST_BIN (pipeline), connections[i].element1.c_str ());
-        GstElement *el2 = gst_bin_get_by_name (
-        GST_BIN (pipeline), connections[i].element2.c_str ());
+  /* Keeps the whole file, the reload needs to see every element before it
+   * can tell what has to change. */
+  class SnapshotCollector: public SnapshotSink
+  {
+  public:
+    void
+    beginElement (const QString &name, const QString &pluginName)
+    {
+      SnapshotElement element;
+      element.m_name = name;
+      element.m_pluginName = pluginName;
+      m_elements.push_back (element);
+    }
 
-        if (!el1 || !el2) {
-          QMessageBox::warning (
-          0,
-          "Internal error",
-          QString ("Could not find one of elements `")
-          + QString (connections[i].element1.c_str ()) + "`, `"
-          + QString (connections[i].element2.c_str ()) + "`");
+    void
+    pad (const QString &name, Presence presence, const QString &templateName)
+    {
+      SnapshotPad pad;
+      pad.m_name = name;
+      pad.m_presence = presence;
+      pad.m_templateName = templateName;
+      m_elements.back ().m_pads.push_back (pad);
+    }
 
-          gst_object_unref (el1);
-          gst_object_unref (el2);
+    void
+    connection (const QString &peerElement, const QString &peerPad)
+    {
+      std::vector<SnapshotPad> &pads = m_elements.back ().m_pads;
+      if (!pads.empty ())
+        pads.back ().m_connections.push_back (qMakePair (peerElement, peerPad));
+    }
 
-          return false;
-        }
+    void
+    property (const QString &name, const QString &value)
+    {
+      m_elements.back ().m_properties.push_back (qMakePair (name, value));
+    }
+
+    void
+    endElement ()
+    {
+    }
+
+    std::vector<SnapshotElement> m_elements;
+  };
 
-        GstPad *pad1 = gst_element_get_static_pad (
-        el1, connections[i].pad1.c_str ());
-        GstPad *pad2 = gst_element_get_static_pad (
-        el2, connections[i].pad2.c_str ());
+  /* both ends as "element:pad", in a fixed order */
+  typedef QPair<QString, QString> LinkKey;
 
-        if (pad1 && pad2) {
-          if (GST_PAD_IS_SRC (pad1))
-            gst_element_link_pads (el1, connections[i].pad1.c_str (), el2,
-                                   connections[i].pad2.c_str ());
-          else
-            gst_element_link_pads (el2, connections[i].pad2.c_str (), el1,
-                                   connections[i].pad1.c_str ());
+  LinkKey
+  linkKey (const QString &element1, const QString &pad1,
+           const QString &element2, const QString &pad2)
+  {
+    QString end1 = element1 + ":" + pad1;
+    QString end2 = element2 + ":" + pad2;
+    if (end1 < end2)
+      return qMakePair (end1, end2);
+    return qMakePair (end2, end1);
+  }
+
+  struct LiveLink
+  {
+    std::string m_src;
+    std::string m_srcPad;
+    std::string m_dst;
+    std::string m_dstPad;
+  };
+}
 
-          gst_object_unref (pad1);
-          gst_object_unref (pad2);
-          connections.erase (connections.begin () + i);
+/* Sets the changed properties of an element which is kept and resets the
+ * ones which are no longer in the file. */
+static std::size_t
+updateProperties (GstElement *element, const PropertyList &properties)
+{
+  QHash<QString, QString> wanted;
+  for (std::size_t i = 0; i < properties.size (); i++)
+    wanted.insert (properties[i].first, properties[i].second);
 
-          gst_object_unref (el1);
-          gst_object_unref (el2);
+  guint num_props;
+  GParamSpec **prop_specs = g_object_class_list_properties (
+  G_OBJECT_GET_CLASS (element), &num_props);
 
-          break;
-        }
+  PropertyList changed;
+  std::vector<GParamSpec *> reset;
 
-        if (pad1)
-          gst_object_unref (pad1);
+  for (guint i = 0; i < num_props; i++) {
+    QString name = g_param_spec_get_name (prop_specs[i]);
+    QString current;
+    bool isSet = propertyValue (element, prop_specs[i], current);
 
-        if (pad2)
-          gst_object_unref (pad2);
+    QHash<QString, QString>::const_iterator itr = wanted.constFind (name);
+    if (itr != wanted.constEnd ()) {
+      if (!isSet || current != itr.value ())
+        changed.push_back (qMakePair (name, itr.value ()));
+    }
+    else if (isSet)
+      reset.push_back (prop_specs[i]);
+  }
 
-        gst_object_unref (el1);
-        gst_object_unref (el2);
-      }
+  applyProperties (element, changed);
 
-      if (i == connections.size ())
-        break;
+  for (std::size_t i = 0; i < reset.size (); i++) {
+    GValue value = G_VALUE_INIT;
+    g_value_init (&value, reset[i]->value_type);
+    g_param_value_set_default (reset[i], &value);
+    g_object_set_property (G_OBJECT (element), reset[i]->name, &value);
+    g_value_unset (&value);
+  }
+
+  g_free (prop_specs);
+  return changed.size () + reset.size ();
+}
+
+bool
+PipelineIE::Reload (QSharedPointer<GraphManager> pgraph,
+                    const QString &fileName)
+{
+  Profiler::Scope profile ("Reload");
+
+  SnapshotCollector snapshot;
+  QString error;
+  if (!SnapshotFormat::readFile (fileName, snapshot, error)) {
+    QMessageBox::warning (0, "Reload failed", error);
+    return false;
+  }
+
+  std::vector<ElementInfo> info = pgraph->GetInfo ();
+  QHash<QString, std::size_t> live;
+  for (std::size_t i = 0; i < info.size (); i++)
+    if (info[i].m_parentId == (size_t) -1)
+      live.insert (info[i].m_name.c_str (), i);
+
+  /* elements are kept when an element of the same name and plugin exists,
+   * everything else is recreated */
+  QSet<QString> kept;
+  QSet<LinkKey> wantedLinks;
+  std::vector<std::size_t> created;
+  for (std::size_t i = 0; i < snapshot.m_elements.size (); i++) {
+    const SnapshotElement &element = snapshot.m_elements[i];
+    QHash<QString, std::size_t>::const_iterator itr = live.constFind (
+    element.m_name);
+
+    if (itr != live.constEnd ()
+    && element.m_pluginName == info[itr.value ()].m_pluginName.c_str ())
+      kept.insert (element.m_name);
+    else
+      created.push_back (i);
+
+    for (std::size_t j = 0; j < element.m_pads.size (); j++)
+      for (std::size_t k = 0; k < element.m_pads[j].m_connections.size (); k++)
+        wantedLinks.insert (
+        linkKey (element.m_name, element.m_pads[j].m_name,
+                 element.m_pads[j].m_connections[k].first,
+                 element.m_pads[j].m_connections[k].second));
+  }
+
+  QSet<LinkKey> liveLinks;
+  std::vector<LiveLink> unlinks;
+  for (std::size_t i = 0; i < info.size (); i++) {
+    if (info[i].m_parentId != (size_t) -1)
+      continue;
+
+    for (std::size_t j = 0; j < info[i].m_pads.size (); j++) {
+      const ElementInfo::Connection &connection = info[i].m_connections[j];
+      if (info[i].m_pads[j].m_type != PadInfo::Out
+      || connection.m_elementId == (size_t) -1
+      || connection.m_padId == (size_t) -1)
+        continue;
+
+      const ElementInfo &peer = info[connection.m_elementId];
+      LiveLink link;
+      link.m_src = info[i].m_name;
+      link.m_srcPad = info[i].m_pads[j].m_name;
+      link.m_dst = peer.m_name;
+      link.m_dstPad = peer.m_pads[connection.m_padId].m_name;
+
+      /* links of removed elements go away with them */
+      if (!kept.contains (link.m_src.c_str ())
+      || !kept.contains (link.m_dst.c_str ()))
+        continue;
+
+      LinkKey key = linkKey (link.m_src.c_str (), link.m_srcPad.c_str (),
+                             link.m_dst.c_str (), link.m_dstPad.c_str ());
+      liveLinks.insert (key);
+
+      if (!wantedLinks.contains (key))
+        unlinks.push_back (link);
+    }
+  }
+
+  std::size_t removed = 0;
+  pgraph->BeginTransaction ();
+
+  for (QHash<QString, std::size_t>::const_iterator itr = live.constBegin ();
+  itr != live.constEnd (); ++itr) {
+    if (!kept.contains (itr.key ())) {
+      pgraph->RemovePlugin (info[itr.value ()].m_name.c_str ());
+      removed++;
     }
+  }
 
-    if (!connections.empty ()) {
-      gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  for (std::size_t i = 0; i < unlinks.size (); i++)
+    pgraph->Disconnect (unlinks[i].m_src.c_str (), unlinks[i].m_srcPad.c_str (),
+                        unlinks[i].m_dst.c_str (), unlinks[i].m_dstPad.c_str ());
 
-      GstState state;
-      gst_element_get_state (pipeline, &state, NULL, GST_MSECOND * 2500);
+  for (std::size_t i = 0; i < created.size (); i++) {
+    const SnapshotElement &element = snapshot.m_elements[created[i]];
+    std::string name = element.m_name.toStdString ();
+
+    GstElement *pel = gst_element_factory_make (
+    element.m_pluginName.toStdString ().c_str (), name.c_str ());
+    if (!pel) {
+      LOG_INFO("Could not create element of `%s` with name `%s`", element.m_pluginName.toStdString ().c_str (), name.c_str ());
+      continue;
     }
 
+    for (std::size_t j = 0; j < element.m_pads.size (); j++)
+      if (element.m_pads[j].m_presence == SnapshotSink::Request)
+        create_requst_pad (pel, element.m_pads[j].m_templateName,
+                           element.m_pads[j].m_name);
+
+    applyProperties (pel, element.m_properties);
+    pgraph->AddElement (pel);
   }
 
-  if (setReady)
-    gst_element_set_state (pipeline, GST_STATE_READY);
+  bool res = pgraph->CommitTransaction ();
 
-  return true;
+  /* kept elements keep their state, only what differs is touched */
+  std::size_t changedProperties = 0;
+  for (std::size_t i = 0; i < snapshot.m_elements.size (); i++) {
+    const SnapshotElement &element = snapshot.m_elements[i];
+    if (!kept.contains (element.m_name))
+      continue;
+
+    std::string name = element.m_name.toStdString ();
+    GstElement *pel = gst_bin_get_by_name (GST_BIN (pgraph->m_pGraph),
+                                           name.c_str ());
+    if (!pel)
+      continue;
+
+    for (std::size_t j = 0; j < element.m_pads.size (); j++) {
+      if (element.m_pads[j].m_presence != SnapshotSink::Request)
+        continue;
+
+      GstPad *pad = gst_element_get_static_pad (
+      pel, element.m_pads[j].m_name.toStdString ().c_str ());
+      if (pad)
+        gst_object_unref (pad);
+      else
+        create_requst_pad (pel, element.m_pads[j].m_templateName,
+                           element.m_pads[j].m_name);
+    }
+
+    changedProperties += updateProperties (pel, element.m_properties);
+    gst_object_unref (pel);
+  }
+
+  std::size_t linked = 0;
+  for (QSet<LinkKey>::const_iterator itr = wantedLinks.constBegin ();
+  itr != wantedLinks.constEnd (); ++itr) {
+    if (liveLinks.contains (*itr))
+      continue;
+
+    std::string end1 = itr->first.toStdString ();
+    std::string end2 = itr->second.toStdString ();
+    std::size_t sep1 = end1.rfind (':');
+    std::size_t sep2 = end2.rfind (':');
+    if (sep1 == std::string::npos || sep2 == std::string::npos)
+      continue;
+
+    if (pgraph->ConnectWhenReady (end1.substr (0, sep1).c_str (),
+                                  end1.substr (sep1 + 1).c_str (),
+                                  end2.substr (0, sep2).c_str (),
+                                  end2.substr (sep2 + 1).c_str ()))
+      linked++;
+  }
+
+  LOG_INFO("reload: %d elements created, %d removed, %d unlinked, %d linked, %d properties changed", (int) created.size (), (int) removed, (int) unlinks.size (), (int) linked, (int) changedProperties);
+
+  return res;
 }
 
 bool
 PipelineIE::Clear (QSharedPointer<GraphManager> pgraph)
 {
-  GstElement *pipeline = pgraph->m_pGraph;
-  clearPipeline (pipeline);
-  return true;
+  return pgraph->Clear ();
 }
@@ -11,6 +11,17 @@ namespace PipelineIE
   bool Export(QSharedPointer<GraphManager> pgraph, const QString &fileName);
   bool Import(QSharedPointer<GraphManager> pgraph, const QString &fileName);
   bool Clear(QSharedPointer<GraphManager> pgraph);
+
+  /* applies only the differences between the file and the graph, elements
+   * which are in both keep their state */
+  bool Reload(QSharedPointer<GraphManager> pgraph, const QString &fileName);
+
+  /* the format of the written file follows its suffix: .gpi, .gpb or the
+   * compressed .gpbz, files are read in whichever format they are in */
+  bool Convert(const QString &source, const QString &target);
+
+  bool ImportLaunch(QSharedPointer<GraphManager> pgraph, const QString &description);
+  QString ExportLaunch(QSharedPointer<GraphManager> pgraph);
 };
 
 #endif
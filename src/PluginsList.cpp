@@ -20,7 +20,7 @@ plugins_sort_cb (gconstpointer a, gconstpointer b)
 {
   Plugin* p1 = (Plugin*) a;
   Plugin* p2 = (Plugin*) b;
-  LOG_INFO("Sort p1: %s and  p2: ",  p1->getName ().toStdString ().c_str (),p2->getName ().toStdString ().c_str ());
+  LOG_INFO("Sort p1: %s and  p2: %s",  p1->getName ().toStdString ().c_str (),p2->getName ().toStdString ().c_str ());
   if (p1->getRank () > p2->getRank ())
     return 1;
   else if (p1->getRank () == p2->getRank ()) {
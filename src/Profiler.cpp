@@ -0,0 +1,60 @@
+#include "Profiler.h"
+
+#include "Logger.h"
+
+#include <stdio.h>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+static bool profilerEnabled = false;
+
+void
+Profiler::setEnabled (bool enabled)
+{
+  profilerEnabled = enabled;
+}
+
+bool
+Profiler::isEnabled ()
+{
+  return profilerEnabled;
+}
+
+long
+Profiler::peakMemoryKb ()
+{
+#ifdef Q_OS_UNIX
+  struct rusage usage;
+  if (getrusage (RUSAGE_SELF, &usage) != 0)
+    return -1;
+#ifdef Q_OS_MAC
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#else
+  return -1;
+#endif
+}
+
+Profiler::Scope::Scope (const char *name)
+: m_name (name)
+{
+  if (profilerEnabled)
+    m_timer.start ();
+}
+
+Profiler::Scope::~Scope ()
+{
+  if (!profilerEnabled)
+    return;
+
+  qint64 elapsed = m_timer.elapsed ();
+  long peakMemory = peakMemoryKb ();
+
+  fprintf (stderr, "profile: %s took %lld ms, peak memory %ld kB\n", m_name,
+           (long long) elapsed, peakMemory);
+  LOG_INFO("%s took %lld ms, peak memory %ld kB", m_name, (long long) elapsed, peakMemory);
+}
@@ -0,0 +1,25 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <QElapsedTimer>
+
+namespace Profiler
+{
+  void setEnabled(bool enabled);
+  bool isEnabled();
+
+  long peakMemoryKb();
+
+  class Scope
+  {
+  public:
+    Scope(const char *name);
+    ~Scope();
+
+  private:
+    const char *m_name;
+    QElapsedTimer m_timer;
+  };
+}
+
+#endif
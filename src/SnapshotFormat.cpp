@@ -0,0 +1,580 @@
+#include "SnapshotFormat.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QXmlStreamReader>
+#include <QtEndian>
+
+#include <string.h>
+
+/* Binary snapshot layout, all fields are little endian quint32 unless noted:
+ *
+ *   header      magic "PVZS", quint16 version, quint16 flags, string count,
+ *               element count, pad count, link count, property count,
+ *               payload size
+ *   payload     string  { offset, length } into the string data
+ *               element { name, plugin, first pad, pad count,
+ *                         first property, property count }
+ *               pad     { name, template, presence, first link, link count }
+ *               link    { peer element, peer pad }
+ *               property { name, value }
+ *               string data, utf-8
+ *
+ * Names and values are string ids, so the records have a fixed size and
+ * the uncompressed payload is used straight from the mapped file. With the
+ * compressed flag the payload is stored as qCompress output. */
+
+#define SNAPSHOT_MAGIC "PVZS"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_FLAG_COMPRESSED 0x1
+#define SNAPSHOT_HEADER_SIZE 32
+
+#define STRING_RECORD 2
+#define ELEMENT_RECORD 6
+#define PAD_RECORD 5
+#define LINK_RECORD 2
+#define PROPERTY_RECORD 2
+
+static inline quint32
+readU32 (const uchar *data, quint64 index)
+{
+  return qFromLittleEndian<quint32> (data + index * sizeof(quint32));
+}
+
+static inline void
+appendU32 (QByteArray &buffer, quint32 value)
+{
+  uchar tmp[sizeof(quint32)];
+  qToLittleEndian<quint32> (value, tmp);
+  buffer.append ((const char *) tmp, sizeof(tmp));
+}
+
+static const char *
+presenceName (SnapshotSink::Presence presence)
+{
+  switch (presence) {
+    case SnapshotSink::Sometimes:
+      return "sometimes";
+    case SnapshotSink::Request:
+      return "request";
+    default:
+      return "always";
+  }
+}
+
+static SnapshotSink::Presence
+presenceFromName (const QStringRef &name)
+{
+  if (name == QLatin1String ("sometimes"))
+    return SnapshotSink::Sometimes;
+  if (name == QLatin1String ("request"))
+    return SnapshotSink::Request;
+  return SnapshotSink::Always;
+}
+
+SnapshotFormat::Format
+SnapshotFormat::formatForFileName (const QString &fileName)
+{
+  QString suffix = QFileInfo (fileName).suffix ().toLower ();
+  if (suffix == "gpb")
+    return Binary;
+  if (suffix == "gpbz")
+    return CompressedBinary;
+  return Xml;
+}
+
+bool
+SnapshotFormat::isBinary (const uchar *data, qint64 size)
+{
+  return size >= 4 && !memcmp (data, SNAPSHOT_MAGIC, 4);
+}
+
+static void
+readXmlPad (QXmlStreamReader &xml, SnapshotSink &sink)
+{
+  QXmlStreamAttributes attributes = xml.attributes ();
+  sink.pad (attributes.value ("name").toString (),
+            presenceFromName (attributes.value ("presence")),
+            attributes.value ("template-name").toString ());
+
+  while (xml.readNextStartElement ()) {
+    if (xml.name () == QLatin1String ("connected-to"))
+      sink.connection (xml.attributes ().value ("element-name").toString (),
+                       xml.attributes ().value ("pad-name").toString ());
+    xml.skipCurrentElement ();
+  }
+}
+
+static void
+readXmlProperties (QXmlStreamReader &xml, SnapshotSink &sink)
+{
+  while (xml.readNextStartElement ()) {
+    if (xml.name () == QLatin1String ("property"))
+      sink.property (xml.attributes ().value ("name").toString (),
+                     xml.attributes ().value ("value").toString ());
+    xml.skipCurrentElement ();
+  }
+}
+
+bool
+SnapshotFormat::readXml (QIODevice *device, SnapshotSink &sink, QString &error)
+{
+  QXmlStreamReader xml (device);
+
+  if (!xml.readNextStartElement () || xml.name () != QLatin1String ("pipeline")) {
+    error = "Is invalid pipeline file";
+    return false;
+  }
+
+  sink.beginPipeline ();
+
+  while (xml.readNextStartElement ()) {
+    if (xml.name () != QLatin1String ("element")) {
+      xml.skipCurrentElement ();
+      continue;
+    }
+
+    sink.beginElement (xml.attributes ().value ("name").toString (),
+                       xml.attributes ().value ("plugin-name").toString ());
+
+    while (xml.readNextStartElement ()) {
+      if (xml.name () == QLatin1String ("pad"))
+        readXmlPad (xml, sink);
+      else if (xml.name () == QLatin1String ("properties"))
+        readXmlProperties (xml, sink);
+      else
+        xml.skipCurrentElement ();
+    }
+
+    sink.endElement ();
+  }
+
+  if (xml.hasError ()) {
+    error = QString ("Parse error at line ") + QString::number (xml.lineNumber ())
+    + ", column " + QString::number (xml.columnNumber ()) + ": "
+    + xml.errorString ();
+    return false;
+  }
+
+  return true;
+}
+
+namespace
+{
+  class BinaryReader
+  {
+  public:
+    BinaryReader (const uchar *payload, quint64 size, const uchar *header)
+    : m_payload (payload), m_size (size)
+    {
+      m_stringCount = readU32 (header, 2);
+      m_elementCount = readU32 (header, 3);
+      m_padCount = readU32 (header, 4);
+      m_linkCount = readU32 (header, 5);
+      m_propertyCount = readU32 (header, 6);
+
+      m_elements = (quint64) m_stringCount * STRING_RECORD;
+      m_pads = m_elements + (quint64) m_elementCount * ELEMENT_RECORD;
+      m_links = m_pads + (quint64) m_padCount * PAD_RECORD;
+      m_properties = m_links + (quint64) m_linkCount * LINK_RECORD;
+      m_stringData = (m_properties
+      + (quint64) m_propertyCount * PROPERTY_RECORD) * sizeof(quint32);
+    }
+
+    bool
+    isValid () const
+    {
+      return m_stringData <= m_size;
+    }
+
+    bool
+    read (SnapshotSink &sink, QString &error)
+    {
+      for (quint32 i = 0; i < m_elementCount; i++) {
+        quint64 rec = m_elements + (quint64) i * ELEMENT_RECORD;
+        quint32 firstPad = readU32 (m_payload, rec + 2);
+        quint32 padCount = readU32 (m_payload, rec + 3);
+        quint32 firstProperty = readU32 (m_payload, rec + 4);
+        quint32 propertyCount = readU32 (m_payload, rec + 5);
+
+        QString name, plugin;
+        if (!string (readU32 (m_payload, rec), name)
+        || !string (readU32 (m_payload, rec + 1), plugin)
+        || (quint64) firstPad + padCount > m_padCount
+        || (quint64) firstProperty + propertyCount > m_propertyCount) {
+          error = QString ("Corrupted element record ") + QString::number (i);
+          return false;
+        }
+
+        sink.beginElement (name, plugin);
+
+        for (quint32 j = firstPad; j < firstPad + padCount; j++) {
+          if (!readPad (j, sink)) {
+            error = QString ("Corrupted pad record ") + QString::number (j);
+            return false;
+          }
+        }
+
+        for (quint32 j = firstProperty; j < firstProperty + propertyCount; j++) {
+          quint64 prop = m_properties + (quint64) j * PROPERTY_RECORD;
+          QString propName, value;
+          if (!string (readU32 (m_payload, prop), propName)
+          || !string (readU32 (m_payload, prop + 1), value)) {
+            error = QString ("Corrupted property record ") + QString::number (j);
+            return false;
+          }
+          sink.property (propName, value);
+        }
+
+        sink.endElement ();
+      }
+
+      return true;
+    }
+
+  private:
+    bool
+    string (quint32 id, QString &res) const
+    {
+      if (id >= m_stringCount)
+        return false;
+
+      quint32 offset = readU32 (m_payload, (quint64) id * STRING_RECORD);
+      quint32 length = readU32 (m_payload, (quint64) id * STRING_RECORD + 1);
+      if (m_stringData + offset + length > m_size)
+        return false;
+
+      res = QString::fromUtf8 ((const char *) m_payload + m_stringData + offset,
+                               length);
+      return true;
+    }
+
+    bool
+    readPad (quint32 index, SnapshotSink &sink) const
+    {
+      quint64 rec = m_pads + (quint64) index * PAD_RECORD;
+      quint32 presence = readU32 (m_payload, rec + 2);
+      quint32 firstLink = readU32 (m_payload, rec + 3);
+      quint32 linkCount = readU32 (m_payload, rec + 4);
+
+      QString name, templateName;
+      if (!string (readU32 (m_payload, rec), name)
+      || !string (readU32 (m_payload, rec + 1), templateName)
+      || presence > SnapshotSink::Request
+      || (quint64) firstLink + linkCount > m_linkCount)
+        return false;
+
+      sink.pad (name, (SnapshotSink::Presence) presence, templateName);
+
+      for (quint32 i = firstLink; i < firstLink + linkCount; i++) {
+        quint64 link = m_links + (quint64) i * LINK_RECORD;
+        QString peer, peerPad;
+        if (!string (readU32 (m_payload, link), peer)
+        || !string (readU32 (m_payload, link + 1), peerPad))
+          return false;
+        sink.connection (peer, peerPad);
+      }
+
+      return true;
+    }
+
+    const uchar *m_payload;
+    quint64 m_size;
+
+    quint32 m_stringCount;
+    quint32 m_elementCount;
+    quint32 m_padCount;
+    quint32 m_linkCount;
+    quint32 m_propertyCount;
+
+    quint64 m_elements;
+    quint64 m_pads;
+    quint64 m_links;
+    quint64 m_properties;
+    quint64 m_stringData;
+  };
+}
+
+bool
+SnapshotFormat::readBinary (const uchar *data, qint64 size, SnapshotSink &sink,
+                            QString &error)
+{
+  if (size < SNAPSHOT_HEADER_SIZE || !isBinary (data, size)) {
+    error = "Is invalid snapshot file";
+    return false;
+  }
+
+  quint16 version = qFromLittleEndian<quint16> (data + 4);
+  quint16 flags = qFromLittleEndian<quint16> (data + 6);
+  quint32 payloadSize = readU32 (data, 7);
+
+  if (version != SNAPSHOT_VERSION) {
+    error = QString ("Unsupported snapshot version ") + QString::number (version);
+    return false;
+  }
+
+  const uchar *payload = data + SNAPSHOT_HEADER_SIZE;
+  quint64 available = size - SNAPSHOT_HEADER_SIZE;
+
+  QByteArray uncompressed;
+  if (flags & SNAPSHOT_FLAG_COMPRESSED) {
+    uncompressed = qUncompress (payload, available);
+    if ((quint64) uncompressed.size () != payloadSize) {
+      error = "Could not decompress snapshot";
+      return false;
+    }
+    payload = (const uchar *) uncompressed.constData ();
+    available = uncompressed.size ();
+  }
+  else if (available < payloadSize) {
+    error = "Truncated snapshot";
+    return false;
+  }
+
+  BinaryReader reader (payload, payloadSize, data);
+  if (!reader.isValid ()) {
+    error = "Truncated snapshot";
+    return false;
+  }
+
+  sink.beginPipeline ();
+  return reader.read (sink, error);
+}
+
+bool
+SnapshotFormat::readFile (const QString &fileName, SnapshotSink &sink,
+                          QString &error)
+{
+  QFile file (fileName);
+  if (!file.open (QFile::ReadOnly)) {
+    error = QString ("Cannot read file ") + fileName + ": " + file.errorString ();
+    return false;
+  }
+
+  char magic[4];
+  if (file.peek (magic, sizeof(magic)) != sizeof(magic)
+  || !isBinary ((const uchar *) magic, sizeof(magic)))
+    return readXml (&file, sink, error);
+
+  /* mapping keeps large snapshots out of the heap, fall back to reading
+   * for files which cannot be mapped */
+  uchar *data = file.map (0, file.size ());
+  if (data) {
+    bool res = readBinary (data, file.size (), sink, error);
+    file.unmap (data);
+    return res;
+  }
+
+  QByteArray content = file.readAll ();
+  return readBinary ((const uchar *) content.constData (), content.size (),
+                     sink, error);
+}
+
+XmlSnapshotWriter::XmlSnapshotWriter (QIODevice *device)
+: m_writer (device),
+m_padOpen (false),
+m_propertiesOpen (false)
+{
+  m_writer.writeStartDocument ();
+  m_writer.writeStartElement ("pipeline");
+}
+
+void
+XmlSnapshotWriter::closePad ()
+{
+  if (m_padOpen)
+    m_writer.writeEndElement ();
+  m_padOpen = false;
+}
+
+void
+XmlSnapshotWriter::closeProperties ()
+{
+  if (m_propertiesOpen)
+    m_writer.writeEndElement ();
+  m_propertiesOpen = false;
+}
+
+void
+XmlSnapshotWriter::beginElement (const QString &name, const QString &pluginName)
+{
+  m_writer.writeStartElement ("element");
+  m_writer.writeAttribute ("name", name);
+  m_writer.writeAttribute ("plugin-name", pluginName);
+}
+
+void
+XmlSnapshotWriter::pad (const QString &name, Presence presence,
+                        const QString &templateName)
+{
+  /* a pad reported after properties of the same element */
+  closePad ();
+  closeProperties ();
+
+  m_writer.writeStartElement ("pad");
+  m_writer.writeAttribute ("name", name);
+  m_writer.writeAttribute ("presence", presenceName (presence));
+  m_writer.writeAttribute ("template-name", templateName);
+  m_padOpen = true;
+}
+
+void
+XmlSnapshotWriter::connection (const QString &peerElement,
+                               const QString &peerPad)
+{
+  if (!m_padOpen)
+    return;
+
+  m_writer.writeStartElement ("connected-to");
+  m_writer.writeAttribute ("element-name", peerElement);
+  m_writer.writeAttribute ("pad-name", peerPad);
+  m_writer.writeEndElement ();
+}
+
+void
+XmlSnapshotWriter::property (const QString &name, const QString &value)
+{
+  closePad ();
+
+  if (!m_propertiesOpen) {
+    m_writer.writeStartElement ("properties");
+    m_propertiesOpen = true;
+  }
+
+  m_writer.writeStartElement ("property");
+  m_writer.writeAttribute ("name", name);
+  m_writer.writeAttribute ("value", value);
+  m_writer.writeEndElement ();
+}
+
+void
+XmlSnapshotWriter::endElement ()
+{
+  closePad ();
+  closeProperties ();
+
+  m_writer.writeEndElement ();
+}
+
+bool
+XmlSnapshotWriter::finish ()
+{
+  m_writer.writeEndElement ();
+  m_writer.writeEndDocument ();
+
+  return !m_writer.hasError ();
+}
+
+BinarySnapshotWriter::BinarySnapshotWriter ()
+{
+}
+
+quint32
+BinarySnapshotWriter::intern (const QString &str)
+{
+  QHash<QString, quint32>::const_iterator itr = m_stringIds.constFind (str);
+  if (itr != m_stringIds.constEnd ())
+    return itr.value ();
+
+  QByteArray utf8 = str.toUtf8 ();
+  quint32 id = m_strings.size () / STRING_RECORD;
+  m_strings.push_back (m_stringData.size ());
+  m_strings.push_back (utf8.size ());
+  m_stringData.append (utf8);
+
+  m_stringIds.insert (str, id);
+  return id;
+}
+
+void
+BinarySnapshotWriter::beginElement (const QString &name,
+                                    const QString &pluginName)
+{
+  m_elements.push_back (intern (name));
+  m_elements.push_back (intern (pluginName));
+  m_elements.push_back (m_pads.size () / PAD_RECORD);
+  m_elements.push_back (0);
+  m_elements.push_back (m_properties.size () / PROPERTY_RECORD);
+  m_elements.push_back (0);
+}
+
+void
+BinarySnapshotWriter::pad (const QString &name, Presence presence,
+                           const QString &templateName)
+{
+  if (m_elements.empty ())
+    return;
+
+  m_pads.push_back (intern (name));
+  m_pads.push_back (intern (templateName));
+  m_pads.push_back (presence);
+  m_pads.push_back (m_links.size () / LINK_RECORD);
+  m_pads.push_back (0);
+
+  m_elements[m_elements.size () - ELEMENT_RECORD + 3]++;
+}
+
+void
+BinarySnapshotWriter::connection (const QString &peerElement,
+                                  const QString &peerPad)
+{
+  if (m_pads.empty ())
+    return;
+
+  m_links.push_back (intern (peerElement));
+  m_links.push_back (intern (peerPad));
+
+  m_pads[m_pads.size () - PAD_RECORD + 4]++;
+}
+
+void
+BinarySnapshotWriter::property (const QString &name, const QString &value)
+{
+  if (m_elements.empty ())
+    return;
+
+  m_properties.push_back (intern (name));
+  m_properties.push_back (intern (value));
+
+  m_elements[m_elements.size () - ELEMENT_RECORD + 5]++;
+}
+
+void
+BinarySnapshotWriter::endElement ()
+{
+}
+
+bool
+BinarySnapshotWriter::finish (QIODevice *device, bool compress)
+{
+  QByteArray payload;
+  payload.reserve ((m_strings.size () + m_elements.size () + m_pads.size ()
+  + m_links.size () + m_properties.size ()) * sizeof(quint32)
+  + m_stringData.size ());
+
+  const std::vector<quint32> *tables[] = { &m_strings, &m_elements, &m_pads,
+    &m_links, &m_properties };
+  for (std::size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++)
+    for (std::size_t j = 0; j < tables[i]->size (); j++)
+      appendU32 (payload, (*tables[i])[j]);
+  payload.append (m_stringData);
+
+  QByteArray header (SNAPSHOT_MAGIC);
+  uchar tmp[sizeof(quint16)];
+  qToLittleEndian<quint16> (SNAPSHOT_VERSION, tmp);
+  header.append ((const char *) tmp, sizeof(tmp));
+  qToLittleEndian<quint16> (compress ? SNAPSHOT_FLAG_COMPRESSED : 0, tmp);
+  header.append ((const char *) tmp, sizeof(tmp));
+  appendU32 (header, m_strings.size () / STRING_RECORD);
+  appendU32 (header, m_elements.size () / ELEMENT_RECORD);
+  appendU32 (header, m_pads.size () / PAD_RECORD);
+  appendU32 (header, m_links.size () / LINK_RECORD);
+  appendU32 (header, m_properties.size () / PROPERTY_RECORD);
+  appendU32 (header, payload.size ());
+
+  if (compress)
+    payload = qCompress (payload);
+
+  return device->write (header) == header.size ()
+  && device->write (payload) == payload.size ();
+}
@@ -0,0 +1,107 @@
+#ifndef SNAPSHOT_FORMAT_H_
+#define SNAPSHOT_FORMAT_H_
+
+#include <QString>
+#include <QHash>
+#include <QByteArray>
+#include <QXmlStreamWriter>
+
+#include <vector>
+
+class QIODevice;
+
+/* Pipeline snapshots are read and written as a stream of events, so that
+ * the graph, the .gpi xml and the binary format can be converted into each
+ * other without building an intermediate tree. */
+class SnapshotSink
+{
+public:
+  enum Presence
+  {
+    Always,
+    Sometimes,
+    Request
+  };
+
+  virtual ~SnapshotSink() {}
+
+  /* called once the input has been recognized, before any element */
+  virtual void beginPipeline() {}
+  virtual void beginElement(const QString &name, const QString &pluginName) = 0;
+  virtual void pad(const QString &name, Presence presence,
+      const QString &templateName) = 0;
+  /* connection of the last reported pad */
+  virtual void connection(const QString &peerElement, const QString &peerPad) = 0;
+  virtual void property(const QString &name, const QString &value) = 0;
+  virtual void endElement() = 0;
+};
+
+namespace SnapshotFormat
+{
+  enum Format
+  {
+    Xml,
+    Binary,
+    CompressedBinary
+  };
+
+  Format formatForFileName(const QString &fileName);
+  bool isBinary(const uchar *data, qint64 size);
+
+  bool readXml(QIODevice *device, SnapshotSink &sink, QString &error);
+  bool readBinary(const uchar *data, qint64 size, SnapshotSink &sink,
+      QString &error);
+  /* opens the file, detects its format and reads it */
+  bool readFile(const QString &fileName, SnapshotSink &sink, QString &error);
+}
+
+class XmlSnapshotWriter: public SnapshotSink
+{
+public:
+  XmlSnapshotWriter(QIODevice *device);
+
+  void beginElement(const QString &name, const QString &pluginName);
+  void pad(const QString &name, Presence presence, const QString &templateName);
+  void connection(const QString &peerElement, const QString &peerPad);
+  void property(const QString &name, const QString &value);
+  void endElement();
+
+  bool finish();
+
+private:
+  void closePad();
+  void closeProperties();
+
+  QXmlStreamWriter m_writer;
+  bool m_padOpen;
+  bool m_propertiesOpen;
+};
+
+/* Collects the records in memory, the string table is only complete once
+ * every element has been seen. */
+class BinarySnapshotWriter: public SnapshotSink
+{
+public:
+  BinarySnapshotWriter();
+
+  void beginElement(const QString &name, const QString &pluginName);
+  void pad(const QString &name, Presence presence, const QString &templateName);
+  void connection(const QString &peerElement, const QString &peerPad);
+  void property(const QString &name, const QString &value);
+  void endElement();
+
+  bool finish(QIODevice *device, bool compress);
+
+private:
+  quint32 intern(const QString &str);
+
+  QHash<QString, quint32> m_stringIds;
+  QByteArray m_stringData;
+  std::vector<quint32> m_strings;
+  std::vector<quint32> m_elements;
+  std::vector<quint32> m_pads;
+  std::vector<quint32> m_links;
+  std::vector<quint32> m_properties;
+};
+
+#endif
@@ -0,0 +1,342 @@
+#include "SyncMonitor.h"
+
+#include <QTimer>
+
+#include <stdlib.h>
+
+#include "GraphManager.h"
+#include "Logger.h"
+
+#define SYNC_UPDATE_INTERVAL 1000
+#define SYNC_DEFAULT_THRESHOLD (40 * GST_MSECOND)
+
+struct SyncMonitor::PadState: public PadProbes::State
+{
+  PadState(int index, gint64 startTime);
+  ~PadState();
+
+  /* 0 for the reference pad, 1 for the compared one */
+  int m_index;
+  /* monotonic, in nanoseconds */
+  gint64 m_startTime;
+
+  /* used by the streaming thread only */
+  GstSegment m_segment;
+  bool m_hasSegment;
+
+  GMutex m_lock;
+  /* running time of the buffers minus the time since start, added up
+   * since the last update */
+  gint64 m_sum;
+  guint64 m_count;
+  bool m_hasLast;
+  /* running time of the end of the last buffer */
+  gint64 m_lastPosition;
+};
+
+namespace
+{
+  gint64
+  monotonicTime ()
+  {
+    return g_get_monotonic_time () * 1000;
+  }
+
+  SyncPoint
+  mergePoints (const SyncPoint &first, const SyncPoint &second)
+  {
+    SyncPoint point;
+    point.m_time = second.m_time;
+    point.m_min = MIN (first.m_min, second.m_min);
+    point.m_max = MAX (first.m_max, second.m_max);
+    point.m_count = first.m_count + second.m_count;
+    point.m_mean = (first.m_mean * (gint64) first.m_count
+                    + second.m_mean * (gint64) second.m_count) / point.m_count;
+    return point;
+  }
+
+  /* an empty string if the pad exists or may come later */
+  QString
+  checkPad (GstBin *bin, const std::string &name)
+  {
+    std::size_t colon = name.find (':');
+    if (colon == std::string::npos || !colon || colon + 1 == name.size ())
+      return QString ("\"%1\" is not element:pad").arg (name.c_str ());
+
+    std::string elementName = name.substr (0, colon);
+    std::string padName = name.substr (colon + 1);
+    GstElement *element = gst_bin_get_by_name (bin, elementName.c_str ());
+    if (!element)
+      return QString ("No element \"%1\"").arg (elementName.c_str ());
+
+    QString res;
+    GstPad *pad = gst_element_get_static_pad (element, padName.c_str ());
+    if (pad)
+      gst_object_unref (pad);
+    else {
+      /* a sometimes or request pad of another name may come */
+      bool later = false;
+      GList *templates = gst_element_class_get_pad_template_list (
+          GST_ELEMENT_GET_CLASS (element));
+      for (GList *l = templates; l; l = l->next) {
+        GstPadTemplate *tmpl = GST_PAD_TEMPLATE (l->data);
+        if (GST_PAD_TEMPLATE_PRESENCE (tmpl) != GST_PAD_ALWAYS)
+          later = true;
+      }
+      if (!later)
+        res = QString ("%1 has no pad \"%2\"").arg (elementName.c_str ())
+            .arg (padName.c_str ());
+    }
+
+    gst_object_unref (element);
+    return res;
+  }
+
+  void
+  checkBuffer (SyncMonitor::PadState *state, GstPad *pad, GstBuffer *buffer)
+  {
+    if (!state->m_hasSegment) {
+      GstEvent *event = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+      if (!event)
+        return;
+      gst_event_copy_segment (event, &state->m_segment);
+      state->m_hasSegment = true;
+      gst_event_unref (event);
+    }
+
+    GstClockTime timestamp = GST_BUFFER_PTS_IS_VALID (buffer)
+        ? GST_BUFFER_PTS (buffer) : GST_BUFFER_DTS (buffer);
+    if (!GST_CLOCK_TIME_IS_VALID (timestamp)
+    || state->m_segment.format != GST_FORMAT_TIME)
+      return;
+
+    GstClockTime running = gst_segment_to_running_time (&state->m_segment,
+                                                        GST_FORMAT_TIME,
+                                                        timestamp);
+    if (!GST_CLOCK_TIME_IS_VALID (running))
+      return;
+
+    gint64 position = (gint64) running + gst_pad_get_offset (pad);
+    gint64 lead = position - (monotonicTime () - state->m_startTime);
+    if (GST_BUFFER_DURATION_IS_VALID (buffer))
+      position += GST_BUFFER_DURATION (buffer);
+
+    g_mutex_lock (&state->m_lock);
+    state->m_sum += lead;
+    state->m_count++;
+    state->m_hasLast = true;
+    state->m_lastPosition = position;
+    g_mutex_unlock (&state->m_lock);
+  }
+}
+
+SyncMonitor::PadState::PadState (int index, gint64 startTime)
+: m_index (index),
+m_startTime (startTime),
+m_hasSegment (false),
+m_sum (0),
+m_count (0),
+m_hasLast (false),
+m_lastPosition (0)
+{
+  gst_segment_init (&m_segment, GST_FORMAT_UNDEFINED);
+  g_mutex_init (&m_lock);
+}
+
+SyncMonitor::PadState::~PadState ()
+{
+  g_mutex_clear (&m_lock);
+}
+
+static GstPadProbeReturn
+sync_pad_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+  SyncMonitor::PadState *state = (SyncMonitor::PadState *) data;
+
+  if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+    if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
+      gst_event_copy_segment (event, &state->m_segment);
+      state->m_hasSegment = true;
+    }
+  }
+  else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    for (guint i = 0; i < gst_buffer_list_length (list); i++)
+      checkBuffer (state, pad, gst_buffer_list_get (list, i));
+  }
+  else
+    checkBuffer (state, pad, GST_PAD_PROBE_INFO_BUFFER (info));
+
+  return GST_PAD_PROBE_OK;
+}
+
+SyncMonitor::SyncMonitor (QObject *parent)
+: QObject (parent),
+m_startTime (0),
+m_threshold (SYNC_DEFAULT_THRESHOLD),
+m_hasOffset (false),
+m_offset (0),
+m_alerting (false),
+m_alerts (0),
+m_span (1)
+{
+  m_pending.m_count = 0;
+
+  m_pUpdateTimer = new QTimer (this);
+  m_pUpdateTimer->setInterval (SYNC_UPDATE_INTERVAL);
+  connect (m_pUpdateTimer, SIGNAL (timeout ()), SLOT (update ()));
+}
+
+SyncMonitor::~SyncMonitor ()
+{
+  stop ();
+}
+
+PadProbes::State *
+SyncMonitor::padData (GstPad *pad, gpointer data)
+{
+  SyncMonitor *thiz = (SyncMonitor *) data;
+  GstObject *parent = GST_OBJECT_PARENT (pad);
+  std::string name = std::string (parent ? GST_OBJECT_NAME (parent) : "") + ":"
+      + GST_OBJECT_NAME (pad);
+
+  for (int i = 0; i < 2; i++) {
+    if (name == thiz->m_names[i])
+      return new PadState (i, thiz->m_startTime);
+  }
+  return NULL;
+}
+
+bool
+SyncMonitor::start (GraphManager *graph, const std::string &reference,
+                    const std::string &compared, QString &error)
+{
+  if (isRunning ()) {
+    error = "Already running";
+    return false;
+  }
+
+  if (reference == compared) {
+    error = "Pick two different pads";
+    return false;
+  }
+
+  const std::string *names[2] = { &reference, &compared };
+  for (int i = 0; i < 2; i++) {
+    error = checkPad (GST_BIN (graph->m_pGraph), *names[i]);
+    if (!error.isEmpty ())
+      return false;
+  }
+
+  m_names[0] = reference;
+  m_names[1] = compared;
+  m_startTime = monotonicTime ();
+  m_hasOffset = false;
+  m_alerting = false;
+  m_alerts = 0;
+  m_history.clear ();
+  m_pending.m_count = 0;
+  m_span = 1;
+
+  m_probes.add (graph->m_pGraph, (GstPadProbeType) (
+                    GST_PAD_PROBE_TYPE_BUFFER
+                    | GST_PAD_PROBE_TYPE_BUFFER_LIST
+                    | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                sync_pad_probe, padData, this);
+  m_pUpdateTimer->start ();
+  return true;
+}
+
+void
+SyncMonitor::stop ()
+{
+  /* the pad states go with the last probe callback */
+  m_probes.clear ();
+  m_pUpdateTimer->stop ();
+}
+
+bool
+SyncMonitor::lead (PadState *state, gint64 now, gint64 &value)
+{
+  bool res = true;
+
+  g_mutex_lock (&state->m_lock);
+  if (state->m_count)
+    value = state->m_sum / (gint64) state->m_count;
+  else if (state->m_hasLast)
+    value = state->m_lastPosition - now;
+  else
+    res = false;
+  state->m_sum = 0;
+  state->m_count = 0;
+  g_mutex_unlock (&state->m_lock);
+
+  return res;
+}
+
+void
+SyncMonitor::addPoint (const SyncPoint &point)
+{
+  m_pending = m_pending.m_count ? mergePoints (m_pending, point) : point;
+  if (m_pending.m_count < m_span)
+    return;
+
+  m_history.push_back (m_pending);
+  m_pending.m_count = 0;
+
+  /* the whole run at half the resolution */
+  if (m_history.size () >= SYNC_HISTORY_SIZE) {
+    for (std::size_t i = 0; i < m_history.size () / 2; i++)
+      m_history[i] = mergePoints (m_history[2 * i], m_history[2 * i + 1]);
+    m_history.resize (m_history.size () / 2);
+    m_span *= 2;
+  }
+}
+
+void
+SyncMonitor::update ()
+{
+  gint64 now = monotonicTime () - m_startTime;
+  gint64 leads[2];
+  bool valid = true;
+
+  PadState *pads[2] = { NULL, NULL };
+  std::vector<PadProbes::State *> states = m_probes.states ();
+  for (std::size_t i = 0; i < states.size (); i++) {
+    PadState *state = static_cast<PadState *> (states[i]);
+    if (!pads[state->m_index])
+      pads[state->m_index] = state;
+  }
+
+  for (int i = 0; i < 2; i++)
+    valid = pads[i] && lead (pads[i], now, leads[i]) && valid;
+
+  if (!valid) {
+    emit updated ();
+    return;
+  }
+
+  m_hasOffset = true;
+  m_offset = leads[1] - leads[0];
+
+  SyncPoint point;
+  point.m_time = now;
+  point.m_min = point.m_max = point.m_mean = m_offset;
+  point.m_count = 1;
+  addPoint (point);
+
+  bool alerting = (GstClockTime) llabs (m_offset) > m_threshold;
+  if (alerting != m_alerting) {
+    m_alerting = alerting;
+    if (alerting) {
+      m_alerts++;
+      LOG_INFO("%s is %.1f ms %s %s", m_names[1].c_str (),
+               llabs (m_offset) / (double) GST_MSECOND,
+               m_offset > 0 ? "ahead of" : "behind", m_names[0].c_str ());
+    }
+    emit alert (alerting);
+  }
+
+  emit updated ();
+}
@@ -0,0 +1,96 @@
+#ifndef SYNC_MONITOR_H_
+#define SYNC_MONITOR_H_
+
+#include <QObject>
+#include <QString>
+
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "PadProbes.h"
+
+class GraphManager;
+class QTimer;
+
+/* points kept for the whole run, two neighbours are merged when full */
+#define SYNC_HISTORY_SIZE 1024
+
+/* The offset between the branches over a span of time, in nanoseconds */
+struct SyncPoint
+{
+  /* end of the span, since start */
+  gint64 m_time;
+  gint64 m_min;
+  gint64 m_max;
+  gint64 m_mean;
+  /* updates merged into the point */
+  guint m_count;
+};
+
+/* Follows the running time of the buffers at two pads, typically the audio
+ * and the video sink pads of a muxer or of the sinks, and how far the
+ * compared branch is ahead of the reference one. A pad which stops
+ * receiving buffers falls behind as time goes on. The memory does not grow
+ * with the time it runs. */
+class SyncMonitor: public QObject
+{
+  Q_OBJECT
+
+public:
+  SyncMonitor(QObject *parent = 0);
+  ~SyncMonitor();
+
+  /* pads as "element:pad", which must exist or may come from a template
+   * of the element */
+  bool start(GraphManager *graph, const std::string &reference,
+      const std::string &compared, QString &error);
+  void stop();
+  bool isRunning() const { return m_probes.isActive (); }
+
+  void setThreshold(GstClockTime threshold) { m_threshold = threshold; }
+  GstClockTime threshold() const { return m_threshold; }
+
+  /* oldest first, the last update is not in it until its span is complete */
+  const std::vector<SyncPoint> &history() const { return m_history; }
+  /* of the last update, valid once both pads got a buffer */
+  bool hasOffset() const { return m_hasOffset; }
+  gint64 offset() const { return m_offset; }
+  bool isAlerting() const { return m_alerting; }
+  guint alerts() const { return m_alerts; }
+
+  struct PadState;
+
+signals:
+  void updated();
+  void alert(bool alerting);
+
+private slots:
+  void update();
+
+private:
+  static PadProbes::State *padData(GstPad *pad, gpointer data);
+  bool lead(PadState *state, gint64 now, gint64 &value);
+  void addPoint(const SyncPoint &point);
+
+  std::string m_names[2];
+  gint64 m_startTime;
+
+  GstClockTime m_threshold;
+  bool m_hasOffset;
+  gint64 m_offset;
+  bool m_alerting;
+  guint m_alerts;
+
+  std::vector<SyncPoint> m_history;
+  SyncPoint m_pending;
+  /* updates per point, doubles each time the history is merged */
+  guint m_span;
+
+  QTimer *m_pUpdateTimer;
+  /* declared last, the probes go first */
+  PadProbes m_probes;
+};
+
+#endif
@@ -0,0 +1,239 @@
+#include "SyncPanel.h"
+
+#include <QApplication>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPainter>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+#include <stdlib.h>
+
+namespace
+{
+  QString
+  formatElapsed (gint64 time)
+  {
+    gint64 seconds = time / GST_SECOND;
+    return QString ("%1:%2:%3").arg (seconds / 3600)
+        .arg ((seconds / 60) % 60, 2, 10, QChar ('0'))
+        .arg (seconds % 60, 2, 10, QChar ('0'));
+  }
+
+  QString
+  formatOffset (gint64 offset)
+  {
+    return QString ("%1 ms").arg (offset / (double) GST_MSECOND, 0, 'f', 1);
+  }
+}
+
+/* The offset over time: the band spans the smallest and the largest offset
+ * of each point and the line follows their mean */
+class SyncPlot: public QWidget
+{
+public:
+  SyncPlot (SyncMonitor *monitor, QWidget *parent = 0)
+  : QWidget (parent),
+  m_pMonitor (monitor)
+  {
+    setMinimumHeight (120);
+  }
+
+protected:
+  void
+  paintEvent (QPaintEvent *)
+  {
+    QPainter painter (this);
+    int lineHeight = painter.fontMetrics ().height ();
+    QRect area = rect ().adjusted (0, 0, -1, -lineHeight - 2);
+    painter.fillRect (area, Qt::white);
+    painter.drawRect (area);
+
+    const std::vector<SyncPoint> &history = m_pMonitor->history ();
+    gint64 threshold = m_pMonitor->threshold ();
+    gint64 range = threshold + threshold / 2;
+    for (std::size_t i = 0; i < history.size (); i++)
+      range = MAX (range, MAX (llabs (history[i].m_min), llabs (history[i].m_max)));
+    gint64 duration = history.empty () ? 0 : history.back ().m_time;
+
+    double yScale = area.height () / (2.0 * range);
+    double yZero = area.center ().y ();
+    double xScale = duration ? area.width () / (double) duration : 0;
+
+    painter.setPen (Qt::lightGray);
+    painter.drawLine (QPointF (area.left (), yZero), QPointF (area.right (), yZero));
+    painter.setPen (QPen (Qt::red, 1, Qt::DashLine));
+    painter.drawLine (QPointF (area.left (), yZero - threshold * yScale),
+                      QPointF (area.right (), yZero - threshold * yScale));
+    painter.drawLine (QPointF (area.left (), yZero + threshold * yScale),
+                      QPointF (area.right (), yZero + threshold * yScale));
+
+    QPointF last;
+    for (std::size_t i = 0; i < history.size (); i++) {
+      const SyncPoint &point = history[i];
+      double x = area.left () + point.m_time * xScale;
+      painter.setPen (QColor (160, 190, 255));
+      painter.drawLine (QPointF (x, yZero - point.m_max * yScale),
+                        QPointF (x, yZero - point.m_min * yScale));
+
+      QPointF mean (x, yZero - point.m_mean * yScale);
+      painter.setPen (llabs (point.m_mean) > threshold ? Qt::red : Qt::darkBlue);
+      if (i)
+        painter.drawLine (last, mean);
+      last = mean;
+    }
+
+    painter.setPen (Qt::black);
+    painter.drawText (area.adjusted (4, 2, 0, 0), Qt::AlignLeft | Qt::AlignTop,
+                      "+" + formatOffset (range));
+    painter.drawText (area.adjusted (4, 0, 0, -2), Qt::AlignLeft | Qt::AlignBottom,
+                      "-" + formatOffset (range));
+    painter.drawText (QRect (0, area.bottom () + 2, width (), lineHeight),
+                      Qt::AlignLeft, "0:00:00");
+    painter.drawText (QRect (0, area.bottom () + 2, width (), lineHeight),
+                      Qt::AlignRight, formatElapsed (duration));
+  }
+
+private:
+  SyncMonitor *m_pMonitor;
+};
+
+SyncPanel::SyncPanel (GraphManager *graph, QWidget *parent)
+: QWidget (parent),
+m_pGraph (graph)
+{
+  m_pMonitor = new SyncMonitor (this);
+
+  /* editable, the pads of a decodebin only come once it plays */
+  m_pReference = new QComboBox;
+  m_pReference->setEditable (true);
+  m_pReference->setToolTip ("Pad of the reference branch, as element:pad");
+  m_pCompared = new QComboBox;
+  m_pCompared->setEditable (true);
+  m_pCompared->setToolTip ("Pad of the compared branch, as element:pad");
+  QPushButton *prefresh = new QPushButton ("Pads");
+  prefresh->setToolTip ("List the pads of the pipeline again");
+
+  m_pThreshold = new QDoubleSpinBox;
+  m_pThreshold->setRange (1, 10000);
+  m_pThreshold->setDecimals (1);
+  m_pThreshold->setSuffix (" ms");
+  m_pThreshold->setValue (m_pMonitor->threshold () / (double) GST_MSECOND);
+  m_pThreshold->setToolTip ("Alert when the offset goes past this");
+
+  m_pStart = new QPushButton ("Start");
+  m_pStart->setCheckable (true);
+
+  QHBoxLayout *phblayPads = new QHBoxLayout;
+  phblayPads->addWidget (new QLabel ("Reference:"));
+  phblayPads->addWidget (m_pReference, 1);
+  phblayPads->addWidget (new QLabel ("Compared:"));
+  phblayPads->addWidget (m_pCompared, 1);
+  phblayPads->addWidget (prefresh);
+  phblayPads->addWidget (new QLabel ("Threshold:"));
+  phblayPads->addWidget (m_pThreshold);
+  phblayPads->addWidget (m_pStart);
+
+  m_pStatus = new QLabel;
+  m_pStatus->setTextInteractionFlags (Qt::TextSelectableByMouse);
+  m_pPlot = new SyncPlot (m_pMonitor);
+
+  QVBoxLayout *playout = new QVBoxLayout;
+  playout->setContentsMargins (0, 0, 0, 0);
+  playout->addLayout (phblayPads);
+  playout->addWidget (m_pStatus);
+  playout->addWidget (m_pPlot, 1);
+  setLayout (playout);
+
+  connect (prefresh, SIGNAL (clicked ()), SLOT (refreshPads ()));
+  connect (m_pStart, SIGNAL (toggled (bool)), SLOT (toggle (bool)));
+  connect (m_pThreshold, SIGNAL (valueChanged (double)), SLOT (setThreshold (double)));
+  connect (m_pMonitor, SIGNAL (updated ()), SLOT (refresh ()));
+  connect (m_pMonitor, SIGNAL (alert (bool)), SLOT (showAlert (bool)));
+
+  refreshPads ();
+}
+
+void
+SyncPanel::refreshPads ()
+{
+  QStringList pads;
+  std::vector<ElementInfo> info = m_pGraph->GetInfo ();
+  for (std::size_t i = 0; i < info.size (); i++) {
+    for (std::size_t j = 0; j < info[i].m_pads.size (); j++)
+      pads.append (QString ("%1:%2").arg (info[i].m_name.c_str ())
+                   .arg (info[i].m_pads[j].m_name.c_str ()));
+  }
+
+  QComboBox *combos[2] = { m_pReference, m_pCompared };
+  for (int i = 0; i < 2; i++) {
+    QString current = combos[i]->currentText ();
+    combos[i]->clear ();
+    combos[i]->addItems (pads);
+    combos[i]->setEditText (current);
+  }
+}
+
+void
+SyncPanel::toggle (bool start)
+{
+  if (!start) {
+    m_pMonitor->stop ();
+    m_pStart->setText ("Start");
+    refresh ();
+    return;
+  }
+
+  QString error;
+  if (!m_pMonitor->start (m_pGraph, m_pReference->currentText ().toStdString (),
+                          m_pCompared->currentText ().toStdString (), error)) {
+    QMessageBox::warning (this, "A/V sync", error);
+    m_pStart->setChecked (false);
+    return;
+  }
+
+  m_pStart->setText ("Stop");
+  m_pReference->setEnabled (false);
+  m_pCompared->setEnabled (false);
+  showAlert (false);
+  refresh ();
+}
+
+void
+SyncPanel::setThreshold (double threshold)
+{
+  m_pMonitor->setThreshold (threshold * GST_MSECOND);
+  m_pPlot->update ();
+}
+
+void
+SyncPanel::refresh ()
+{
+  m_pReference->setEnabled (!m_pMonitor->isRunning ());
+  m_pCompared->setEnabled (!m_pMonitor->isRunning ());
+
+  QString text;
+  if (m_pMonitor->hasOffset ())
+    text = QString ("%1 %2, %3 alerts")
+        .arg (m_pMonitor->offset () >= 0 ? "Compared ahead by" : "Compared behind by")
+        .arg (formatOffset (llabs (m_pMonitor->offset ())))
+        .arg (m_pMonitor->alerts ());
+  else if (m_pMonitor->isRunning ())
+    text = "Waiting for buffers on both pads";
+  if (!m_pMonitor->isRunning () && !text.isEmpty ())
+    text += ", stopped";
+  m_pStatus->setText (text);
+
+  m_pPlot->update ();
+}
+
+void
+SyncPanel::showAlert (bool alerting)
+{
+  m_pStatus->setStyleSheet (alerting ? "color: red" : "");
+  if (alerting)
+    QApplication::alert (window ());
+}
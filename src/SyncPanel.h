@@ -0,0 +1,44 @@
+#ifndef SYNC_PANEL_H_
+#define SYNC_PANEL_H_
+
+#include <QWidget>
+
+#include "GraphManager.h"
+#include "SyncMonitor.h"
+
+class QComboBox;
+class QDoubleSpinBox;
+class QLabel;
+class QPushButton;
+
+class SyncPlot;
+
+/* Picks the pads of two branches, follows the offset between them and
+ * plots it over the whole run */
+class SyncPanel: public QWidget
+{
+  Q_OBJECT
+
+public:
+  SyncPanel(GraphManager *graph, QWidget *parent = 0);
+
+private slots:
+  void refreshPads();
+  void toggle(bool start);
+  void setThreshold(double threshold);
+  void refresh();
+  void showAlert(bool alerting);
+
+private:
+  GraphManager *m_pGraph;
+  SyncMonitor *m_pMonitor;
+
+  QComboBox *m_pReference;
+  QComboBox *m_pCompared;
+  QDoubleSpinBox *m_pThreshold;
+  QPushButton *m_pStart;
+  QLabel *m_pStatus;
+  SyncPlot *m_pPlot;
+};
+
+#endif
@@ -0,0 +1,403 @@
+#include "TimingAnalyzer.h"
+
+#include <QStringList>
+#include <QTimer>
+
+#include <stdlib.h>
+
+#include "GraphManager.h"
+
+#define TIMING_UPDATE_INTERVAL 1000
+/* a buffer starting later than the end of the previous one plus this is a gap */
+#define TIMING_GAP_TOLERANCE GST_MSECOND
+/* the drift is not computed from samples spanning less clock time */
+#define TIMING_DRIFT_SPAN GST_SECOND
+/* a pad keeps warning this long after an irregularity */
+#define TIMING_WARNING_HOLD (10 * G_USEC_PER_SEC)
+
+struct TimingAnalyzer::PadState: public PadProbes::State
+{
+  PadState(GstPad *pad, int sampleEvery);
+  ~PadState();
+
+  std::string m_name;
+  int m_sampleEvery;
+
+  /* used by the streaming thread only */
+  GstSegment m_segment;
+  bool m_hasSegment;
+  bool m_expectDiscont;
+  GstClockTime m_lastTimestamp;
+  GstClockTime m_lastEnd;
+  gint64 m_lastArrival;
+  guint64 m_count;
+
+  /* written by the streaming thread */
+  std::atomic<guint64> m_buffers;
+  std::atomic<guint64> m_untimed;
+  std::atomic<guint64> m_gaps;
+  std::atomic<guint64> m_maxGap;
+  std::atomic<guint64> m_backwards;
+  std::atomic<guint64> m_discont;
+  std::atomic<gint64> m_jitter;
+
+  GMutex m_lock;
+  TimingSample m_ring[TIMING_RING_SIZE];
+  guint m_ringNext;
+  guint m_ringCount;
+
+  /* read by update */
+  guint64 m_lastBuffers;
+  guint64 m_lastGaps;
+  guint64 m_lastBackwards;
+  guint64 m_lastDiscont;
+  gint64 m_lastTime;
+};
+
+namespace
+{
+  void
+  resetStream (TimingAnalyzer::PadState *state)
+  {
+    state->m_expectDiscont = true;
+    state->m_lastTimestamp = GST_CLOCK_TIME_NONE;
+    state->m_lastEnd = GST_CLOCK_TIME_NONE;
+    state->m_lastArrival = 0;
+  }
+
+  bool
+  clockOffset (TimingAnalyzer::PadState *state, GstPad *pad, GstClockTime pts,
+               TimingSample &sample)
+  {
+    GstElement *element = GST_ELEMENT (GST_OBJECT_PARENT (pad));
+    if (!element || GST_STATE (element) != GST_STATE_PLAYING
+    || !GST_CLOCK_TIME_IS_VALID (pts) || state->m_segment.format != GST_FORMAT_TIME)
+      return false;
+
+    GstClockTime running = gst_segment_to_running_time (&state->m_segment,
+                                                        GST_FORMAT_TIME, pts);
+    GstClock *clock = gst_element_get_clock (element);
+    if (!clock || !GST_CLOCK_TIME_IS_VALID (running)) {
+      if (clock)
+        gst_object_unref (clock);
+      return false;
+    }
+
+    GstClockTime now = gst_clock_get_time (clock);
+    GstClockTime base = gst_element_get_base_time (element);
+    gst_object_unref (clock);
+    if (now < base)
+      return false;
+
+    sample.m_clockTime = now - base;
+    sample.m_clockOffset = (gint64) running - (gint64) sample.m_clockTime;
+    return true;
+  }
+
+  void
+  checkBuffer (TimingAnalyzer::PadState *state, GstPad *pad, GstBuffer *buffer)
+  {
+    gint64 arrival = g_get_monotonic_time () * 1000;
+    GstClockTime pts = GST_BUFFER_PTS (buffer);
+    GstClockTime dts = GST_BUFFER_DTS (buffer);
+    GstClockTime duration = GST_BUFFER_DURATION (buffer);
+    /* the decoding order goes forward even with reordered frames */
+    GstClockTime timestamp = GST_CLOCK_TIME_IS_VALID (dts) ? dts : pts;
+
+    state->m_buffers++;
+
+    if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DISCONT)
+    && !state->m_expectDiscont)
+      state->m_discont++;
+    state->m_expectDiscont = false;
+
+    TimingSample sample;
+    sample.m_pts = pts;
+    sample.m_dts = dts;
+    sample.m_duration = duration;
+    sample.m_arrival = arrival / 1000;
+    sample.m_interArrival = state->m_lastArrival ? arrival - state->m_lastArrival : 0;
+    sample.m_deviation = 0;
+
+    if (!GST_CLOCK_TIME_IS_VALID (timestamp))
+      state->m_untimed++;
+    else {
+      if (GST_CLOCK_TIME_IS_VALID (state->m_lastEnd)
+      && timestamp > state->m_lastEnd + TIMING_GAP_TOLERANCE) {
+        guint64 gap = timestamp - state->m_lastEnd;
+        state->m_gaps++;
+        if (gap > state->m_maxGap)
+          state->m_maxGap = gap;
+      }
+
+      if (GST_CLOCK_TIME_IS_VALID (state->m_lastTimestamp)) {
+        if (timestamp < state->m_lastTimestamp)
+          state->m_backwards++;
+
+        if (state->m_lastArrival) {
+          sample.m_deviation = sample.m_interArrival
+              - ((gint64) timestamp - (gint64) state->m_lastTimestamp);
+          gint64 jitter = state->m_jitter;
+          state->m_jitter = jitter + (llabs (sample.m_deviation) - jitter) / 16;
+        }
+      }
+
+      state->m_lastTimestamp = timestamp;
+      state->m_lastEnd = GST_CLOCK_TIME_IS_VALID (duration)
+          ? timestamp + duration : GST_CLOCK_TIME_NONE;
+    }
+    state->m_lastArrival = arrival;
+
+    if (state->m_count++ % state->m_sampleEvery)
+      return;
+
+    if (!state->m_hasSegment) {
+      GstEvent *event = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+      if (event) {
+        gst_event_copy_segment (event, &state->m_segment);
+        state->m_hasSegment = true;
+        gst_event_unref (event);
+      }
+    }
+    sample.m_clockTime = 0;
+    sample.m_clockOffset = 0;
+    sample.m_hasClock = state->m_hasSegment && clockOffset (state, pad, pts, sample);
+
+    g_mutex_lock (&state->m_lock);
+    state->m_ring[state->m_ringNext] = sample;
+    state->m_ringNext = (state->m_ringNext + 1) % TIMING_RING_SIZE;
+    if (state->m_ringCount < TIMING_RING_SIZE)
+      state->m_ringCount++;
+    g_mutex_unlock (&state->m_lock);
+  }
+
+  /* slope of the clock offset against the clock time, 0 without enough
+   * samples */
+  double
+  drift (const std::vector<TimingSample> &samples)
+  {
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    GstClockTime first = GST_CLOCK_TIME_NONE, last = 0;
+
+    for (std::size_t i = 0; i < samples.size (); i++) {
+      if (!samples[i].m_hasClock)
+        continue;
+      if (!GST_CLOCK_TIME_IS_VALID (first))
+        first = samples[i].m_clockTime;
+      last = samples[i].m_clockTime;
+
+      /* relative to the first sample, to keep the precision */
+      double x = (double) (samples[i].m_clockTime - first);
+      double y = (double) samples[i].m_clockOffset;
+      n++;
+      sx += x;
+      sy += y;
+      sxx += x * x;
+      sxy += x * y;
+    }
+
+    if (n < 2 || !GST_CLOCK_TIME_IS_VALID (first) || last - first < TIMING_DRIFT_SPAN)
+      return 0;
+
+    double variance = n * sxx - sx * sx;
+    return variance > 0 ? (n * sxy - sx * sy) / variance : 0;
+  }
+}
+
+TimingAnalyzer::PadState::PadState (GstPad *pad, int sampleEvery)
+: m_sampleEvery (sampleEvery),
+m_hasSegment (false),
+m_count (0),
+m_buffers (0),
+m_untimed (0),
+m_gaps (0),
+m_maxGap (0),
+m_backwards (0),
+m_discont (0),
+m_jitter (0),
+m_ringNext (0),
+m_ringCount (0),
+m_lastBuffers (0),
+m_lastGaps (0),
+m_lastBackwards (0),
+m_lastDiscont (0),
+m_lastTime (g_get_monotonic_time ())
+{
+  GstObject *parent = GST_OBJECT_PARENT (pad);
+  m_name = std::string (parent ? GST_OBJECT_NAME (parent) : "") + ":"
+      + GST_OBJECT_NAME (pad);
+  gst_segment_init (&m_segment, GST_FORMAT_UNDEFINED);
+  resetStream (this);
+  g_mutex_init (&m_lock);
+}
+
+TimingAnalyzer::PadState::~PadState ()
+{
+  g_mutex_clear (&m_lock);
+}
+
+static GstPadProbeReturn
+timing_pad_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+  TimingAnalyzer::PadState *state = (TimingAnalyzer::PadState *) data;
+
+  if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+    if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
+      gst_event_copy_segment (event, &state->m_segment);
+      state->m_hasSegment = true;
+      resetStream (state);
+    }
+    else if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP)
+      resetStream (state);
+  }
+  else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    for (guint i = 0; i < gst_buffer_list_length (list); i++)
+      checkBuffer (state, pad, gst_buffer_list_get (list, i));
+  }
+  else
+    checkBuffer (state, pad, GST_PAD_PROBE_INFO_BUFFER (info));
+
+  return GST_PAD_PROBE_OK;
+}
+
+TimingAnalyzer::TimingAnalyzer (QObject *parent)
+: QObject (parent),
+m_sampleEvery (1)
+{
+  m_pUpdateTimer = new QTimer (this);
+  m_pUpdateTimer->setInterval (TIMING_UPDATE_INTERVAL);
+  connect (m_pUpdateTimer, SIGNAL (timeout ()), SLOT (update ()));
+}
+
+TimingAnalyzer::~TimingAnalyzer ()
+{
+  stop ();
+}
+
+PadProbes::State *
+TimingAnalyzer::padData (GstPad *pad, gpointer data)
+{
+  TimingAnalyzer *thiz = (TimingAnalyzer *) data;
+  if (GST_PAD_DIRECTION (pad) != GST_PAD_SRC)
+    return NULL;
+
+  return new PadState (pad, thiz->m_sampleEvery);
+}
+
+bool
+TimingAnalyzer::start (GraphManager *graph, int sampleEvery)
+{
+  if (isRunning () || sampleEvery < 1)
+    return false;
+
+  m_sampleEvery = sampleEvery;
+  m_pads.clear ();
+  m_probes.add (graph->m_pGraph, (GstPadProbeType) (
+                    GST_PAD_PROBE_TYPE_BUFFER
+                    | GST_PAD_PROBE_TYPE_BUFFER_LIST
+                    | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                timing_pad_probe, padData, this);
+  m_pUpdateTimer->start ();
+  return true;
+}
+
+void
+TimingAnalyzer::stop ()
+{
+  /* the pad states go with the last probe callback */
+  m_probes.clear ();
+  m_pUpdateTimer->stop ();
+}
+
+void
+TimingAnalyzer::update ()
+{
+  gint64 now = g_get_monotonic_time ();
+
+  std::vector<PadProbes::State *> states = m_probes.states ();
+  for (std::size_t i = 0; i < states.size (); i++) {
+    PadState *state = static_cast<PadState *> (states[i]);
+    guint64 buffers = state->m_buffers;
+    if (!buffers)
+      continue;
+
+    PadTiming &pad = m_pads[state->m_name];
+    pad.m_buffers = buffers;
+    pad.m_buffersPerSecond = (buffers - state->m_lastBuffers)
+        / ((now - state->m_lastTime) / (double) G_USEC_PER_SEC);
+    pad.m_untimed = state->m_untimed;
+    pad.m_gaps = state->m_gaps;
+    pad.m_maxGap = state->m_maxGap;
+    pad.m_backwards = state->m_backwards;
+    pad.m_discont = state->m_discont;
+    pad.m_jitter = state->m_jitter;
+
+    g_mutex_lock (&state->m_lock);
+    guint first = (state->m_ringNext + TIMING_RING_SIZE - state->m_ringCount)
+        % TIMING_RING_SIZE;
+    pad.m_samples.resize (state->m_ringCount);
+    for (guint j = 0; j < state->m_ringCount; j++)
+      pad.m_samples[j] = state->m_ring[(first + j) % TIMING_RING_SIZE];
+    g_mutex_unlock (&state->m_lock);
+
+    pad.m_hasClock = false;
+    for (std::size_t j = pad.m_samples.size (); j > 0; j--) {
+      if (pad.m_samples[j - 1].m_hasClock) {
+        pad.m_hasClock = true;
+        pad.m_clockOffset = pad.m_samples[j - 1].m_clockOffset;
+        break;
+      }
+    }
+    pad.m_drift = drift (pad.m_samples) * 1e6;
+
+    QStringList reasons;
+    if (pad.m_gaps > state->m_lastGaps)
+      reasons.append ("timestamp gaps");
+    if (pad.m_backwards > state->m_lastBackwards)
+      reasons.append ("timestamps going backwards");
+    if (pad.m_discont > state->m_lastDiscont)
+      reasons.append ("discontinuities");
+    if (!reasons.isEmpty ()) {
+      pad.m_warnedAt = now;
+      pad.m_reason = reasons.join (", ").toStdString ();
+    }
+    pad.m_warning = pad.m_warnedAt && now - pad.m_warnedAt < TIMING_WARNING_HOLD;
+
+    state->m_lastBuffers = buffers;
+    state->m_lastGaps = pad.m_gaps;
+    state->m_lastBackwards = pad.m_backwards;
+    state->m_lastDiscont = pad.m_discont;
+    state->m_lastTime = now;
+  }
+
+  emit updated ();
+}
+
+QString
+TimingAnalyzer::describe (const PadTiming &pad)
+{
+  QStringList lines;
+  lines.append (QString ("%1 buffers, %2 buffers/s")
+                .arg (pad.m_buffers).arg (pad.m_buffersPerSecond, 0, 'f', 1));
+  lines.append (QString ("gaps: %1 (largest %2 ms), backwards: %3, "
+                         "discontinuities: %4")
+                .arg (pad.m_gaps).arg (pad.m_maxGap / (double) GST_MSECOND, 0, 'f', 1)
+                .arg (pad.m_backwards).arg (pad.m_discont));
+  if (pad.m_untimed)
+    lines.append (QString ("without timestamp: %1").arg (pad.m_untimed));
+  lines.append (QString ("arrival jitter: %1 ms")
+                .arg (pad.m_jitter / (double) GST_MSECOND, 0, 'f', 2));
+  if (pad.m_hasClock)
+    lines.append (QString ("clock: %1 ms %2, drift %3 ppm")
+                  .arg (qAbs (pad.m_clockOffset) / (double) GST_MSECOND, 0, 'f', 1)
+                  .arg (pad.m_clockOffset >= 0 ? "early" : "late")
+                  .arg (pad.m_drift, 0, 'f', 1));
+  else
+    lines.append ("clock: not playing");
+  if (pad.m_warning)
+    lines.append (QString ("warning: %1").arg (pad.m_reason.c_str ()));
+
+  return lines.join ("\n");
+}
@@ -0,0 +1,111 @@
+#ifndef TIMING_ANALYZER_H_
+#define TIMING_ANALYZER_H_
+
+#include <QObject>
+#include <QString>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "PadProbes.h"
+
+class GraphManager;
+class QTimer;
+
+/* samples kept per pad, the oldest are overwritten */
+#define TIMING_RING_SIZE 512
+
+struct TimingSample
+{
+  GstClockTime m_pts;
+  GstClockTime m_dts;
+  GstClockTime m_duration;
+  /* monotonic, in microseconds */
+  gint64 m_arrival;
+  /* since the previous buffer, in nanoseconds */
+  gint64 m_interArrival;
+  /* arrival delta minus timestamp delta, in nanoseconds */
+  gint64 m_deviation;
+  bool m_hasClock;
+  /* running time of the pipeline clock at arrival */
+  GstClockTime m_clockTime;
+  /* running time of the buffer minus the clock one, early is positive */
+  gint64 m_clockOffset;
+};
+
+/* What went through a source pad, the counts are since start */
+struct PadTiming
+{
+  PadTiming(): m_buffers(0), m_buffersPerSecond(0), m_untimed(0), m_gaps(0),
+      m_maxGap(0), m_backwards(0), m_discont(0), m_jitter(0),
+      m_hasClock(false), m_clockOffset(0), m_drift(0), m_warning(false),
+      m_warnedAt(0) {}
+
+  guint64 m_buffers;
+  double m_buffersPerSecond;
+  /* without PTS nor DTS */
+  guint64 m_untimed;
+  /* a buffer starting after the end of the previous one */
+  guint64 m_gaps;
+  GstClockTime m_maxGap;
+  /* a buffer starting before the previous one */
+  guint64 m_backwards;
+  /* DISCONT flags other than after a segment or a flush */
+  guint64 m_discont;
+  /* smoothed like the RTP interarrival jitter, in nanoseconds */
+  gint64 m_jitter;
+  bool m_hasClock;
+  gint64 m_clockOffset;
+  /* of the buffers against the clock, in parts per million */
+  double m_drift;
+  /* an irregularity lately, monotonic time of the last one */
+  bool m_warning;
+  gint64 m_warnedAt;
+  std::string m_reason;
+  /* oldest first */
+  std::vector<TimingSample> m_samples;
+};
+
+/* Follows the timestamps and the arrival times of the buffers pushed by
+ * every source pad. Every buffer is checked for gaps and discontinuities,
+ * one out of N is recorded with the pipeline clock for the histograms and
+ * the drift. */
+class TimingAnalyzer: public QObject
+{
+  Q_OBJECT
+
+public:
+  TimingAnalyzer(QObject *parent = 0);
+  ~TimingAnalyzer();
+
+  bool start(GraphManager *graph, int sampleEvery);
+  void stop();
+  bool isRunning() const { return m_probes.isActive (); }
+
+  /* by "element:pad" of the source pad */
+  const std::map<std::string, PadTiming> &pads() const { return m_pads; }
+
+  static QString describe(const PadTiming &pad);
+
+  struct PadState;
+
+signals:
+  void updated();
+
+private slots:
+  void update();
+
+private:
+  static PadProbes::State *padData(GstPad *pad, gpointer data);
+
+  int m_sampleEvery;
+  std::map<std::string, PadTiming> m_pads;
+  QTimer *m_pUpdateTimer;
+  /* declared last, the probes go first */
+  PadProbes m_probes;
+};
+
+#endif
@@ -0,0 +1,509 @@
+#include "TraceRecorder.h"
+
+#include <QFile>
+#include <QHash>
+#include <QTimer>
+
+#include "GraphManager.h"
+
+/* about 48 MB, allocated the first time a trace is recorded */
+#define TRACE_CAPACITY (256 * 1024)
+#define TRACE_QUEUE_INTERVAL 20
+
+/* The events, shared by the recorder and the pad traces */
+struct TraceLog
+{
+  TraceLog();
+
+  void ref() { m_refs++; }
+  void unref();
+  void record(int type, const char *object, const char *detail,
+      gint64 value0, gint64 value1, gint64 value2, gint64 value3);
+
+  std::vector<TraceEvent> m_events;
+  std::atomic<std::size_t> m_next;
+  std::atomic<quint64> m_dropped;
+  std::atomic<bool> m_recording;
+  std::atomic<int> m_refs;
+};
+
+TraceLog::TraceLog ()
+: m_next (0),
+m_dropped (0),
+m_recording (false),
+m_refs (1)
+{
+}
+
+void
+TraceLog::unref ()
+{
+  if (--m_refs == 0)
+    delete this;
+}
+
+void
+TraceLog::record (int type, const char *object, const char *detail,
+                  gint64 value0, gint64 value1, gint64 value2, gint64 value3)
+{
+  if (!m_recording)
+    return;
+
+  std::size_t index = m_next++;
+  if (index >= m_events.size ()) {
+    m_dropped++;
+    return;
+  }
+
+  TraceEvent &event = m_events[index];
+  event.m_time = g_get_monotonic_time ();
+  event.m_thread = (quintptr) g_thread_self ();
+  event.m_type = type;
+  event.m_values[0] = value0;
+  event.m_values[1] = value1;
+  event.m_values[2] = value2;
+  event.m_values[3] = value3;
+  g_strlcpy (event.m_object, object ? object : "", sizeof(event.m_object));
+  g_strlcpy (event.m_detail, detail ? detail : "", sizeof(event.m_detail));
+}
+
+namespace
+{
+  struct PadTrace: public PadProbes::State
+  {
+    PadTrace(GstPad *pad, TraceLog *log, int sampleEvery);
+    ~PadTrace();
+
+    /* a reference */
+    TraceLog *m_pLog;
+    int m_sampleEvery;
+    guint m_count;
+    char m_name[TRACE_NAME_SIZE];
+  };
+
+  PadTrace::PadTrace (GstPad *pad, TraceLog *log, int sampleEvery)
+  : m_pLog (log),
+  m_sampleEvery (sampleEvery),
+  m_count (0)
+  {
+    m_pLog->ref ();
+    GstObject *parent = GST_OBJECT_PARENT (pad);
+    g_snprintf (m_name, sizeof(m_name), "%s:%s",
+                parent ? GST_OBJECT_NAME (parent) : "", GST_OBJECT_NAME (pad));
+  }
+
+  PadTrace::~PadTrace ()
+  {
+    m_pLog->unref ();
+  }
+
+  void
+  appendJsonString (QByteArray &out, const char *str)
+  {
+    out += '"';
+    for (; *str; str++) {
+      uchar c = *str;
+      if (c == '"' || c == '\\') {
+        out += '\\';
+        out += c;
+      }
+      else if (c < 0x20) {
+        char escaped[8];
+        g_snprintf (escaped, sizeof(escaped), "\\u%04x", c);
+        out += escaped;
+      }
+      else
+        out += c;
+    }
+    out += '"';
+  }
+}
+
+static GstPadProbeReturn
+trace_pad_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+  Q_UNUSED(pad);
+  PadTrace *trace = (PadTrace *) data;
+
+  if (info->type & (GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST)) {
+    /* a pad pushes from one thread at a time */
+    if (trace->m_count++ % trace->m_sampleEvery)
+      return GST_PAD_PROBE_OK;
+
+    GstBuffer *buffer;
+    guint count = 1;
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+      GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+      count = gst_buffer_list_length (list);
+      buffer = count ? gst_buffer_list_get (list, 0) : NULL;
+    }
+    else
+      buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+    if (buffer)
+      trace->m_pLog->record (TraceEvent::Buffer, trace->m_name, NULL,
+                             (gint64) GST_BUFFER_PTS (buffer),
+                             (gint64) GST_BUFFER_DURATION (buffer),
+                             gst_buffer_get_size (buffer), count);
+    return GST_PAD_PROBE_OK;
+  }
+
+  GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS: {
+      GstCaps *caps;
+      gst_event_parse_caps (event, &caps);
+      gchar *str = gst_caps_to_string (caps);
+      trace->m_pLog->record (TraceEvent::Caps, trace->m_name, str, 0, 0, 0, 0);
+      g_free (str);
+      break;
+    }
+    case GST_EVENT_SEGMENT: {
+      const GstSegment *segment;
+      gst_event_parse_segment (event, &segment);
+      char detail[TRACE_DETAIL_SIZE];
+      g_snprintf (detail, sizeof(detail), "%s rate %g", gst_format_get_name (
+                      segment->format), segment->rate);
+      trace->m_pLog->record (TraceEvent::Segment, trace->m_name, detail,
+                             segment->start, segment->stop, segment->time, 0);
+      break;
+    }
+    case GST_EVENT_EOS:
+      trace->m_pLog->record (TraceEvent::Eos, trace->m_name, NULL, 0, 0, 0, 0);
+      break;
+    default:
+      break;
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+trace_bus_listener (GstMessage *message, gpointer data)
+{
+  TraceRecorder *recorder = (TraceRecorder *) data;
+  const char *source = GST_MESSAGE_SRC_NAME (message);
+  if (!source)
+    source = "";
+
+  switch (GST_MESSAGE_TYPE (message)) {
+    case GST_MESSAGE_STATE_CHANGED: {
+      GstState oldState, newState, pending;
+      gst_message_parse_state_changed (message, &oldState, &newState, &pending);
+
+      char detail[TRACE_DETAIL_SIZE];
+      g_snprintf (detail, sizeof(detail), "%s -> %s",
+                  gst_element_state_get_name (oldState),
+                  gst_element_state_get_name (newState));
+      recorder->record (TraceEvent::StateChange, source, detail, oldState,
+                        newState);
+      break;
+    }
+    case GST_MESSAGE_QOS: {
+      gint64 jitter;
+      gdouble proportion;
+      gint quality;
+      GstFormat format;
+      guint64 processed, dropped;
+      gst_message_parse_qos_values (message, &jitter, &proportion, &quality);
+      gst_message_parse_qos_stats (message, &format, &processed, &dropped);
+      recorder->record (TraceEvent::Qos, source, NULL, jitter,
+                        (gint64) (proportion * 1000), processed, dropped);
+      break;
+    }
+    case GST_MESSAGE_ERROR:
+    case GST_MESSAGE_WARNING: {
+      GError *error = NULL;
+      if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_ERROR)
+        gst_message_parse_error (message, &error, NULL);
+      else
+        gst_message_parse_warning (message, &error, NULL);
+      recorder->record (TraceEvent::Message, source,
+                        error ? error->message : "");
+      g_clear_error (&error);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+TraceRecorder::TraceRecorder (QObject *parent)
+: QObject (parent),
+m_pLog (NULL),
+m_startTime (0),
+m_sampleEvery (1),
+m_pGraph (NULL)
+{
+  g_mutex_init (&m_lock);
+
+  m_pQueueTimer = new QTimer (this);
+  m_pQueueTimer->setInterval (TRACE_QUEUE_INTERVAL);
+  connect (m_pQueueTimer, SIGNAL (timeout ()), SLOT (sampleQueues ()));
+}
+
+TraceRecorder::~TraceRecorder ()
+{
+  stop ();
+  if (m_pLog)
+    m_pLog->unref ();
+  g_mutex_clear (&m_lock);
+}
+
+PadProbes::State *
+TraceRecorder::padData (GstPad *pad, gpointer data)
+{
+  TraceRecorder *thiz = (TraceRecorder *) data;
+  if (GST_PAD_DIRECTION (pad) != GST_PAD_SRC)
+    return NULL;
+
+  return new PadTrace (pad, thiz->m_pLog, thiz->m_sampleEvery);
+}
+
+void
+TraceRecorder::elementAdded (GstElement *element, gpointer data)
+{
+  TraceRecorder *thiz = (TraceRecorder *) data;
+  GstElementFactory *factory = gst_element_get_factory (element);
+  const char *factoryName = factory ? GST_OBJECT_NAME (factory) : "";
+  if (g_strcmp0 (factoryName, "queue") && g_strcmp0 (factoryName, "queue2"))
+    return;
+
+  g_mutex_lock (&thiz->m_lock);
+  thiz->m_queues.push_back (GST_ELEMENT (gst_object_ref (element)));
+  g_mutex_unlock (&thiz->m_lock);
+}
+
+bool
+TraceRecorder::start (GraphManager *graph, int sampleEvery)
+{
+  if (isRecording ())
+    return false;
+
+  /* the probes of the last recording may still write to it */
+  if (m_pLog && m_pLog->m_refs > 1) {
+    m_pLog->unref ();
+    m_pLog = NULL;
+  }
+  if (!m_pLog)
+    m_pLog = new TraceLog;
+  if (m_pLog->m_events.empty ())
+    m_pLog->m_events.resize (TRACE_CAPACITY);
+
+  m_pLog->m_next = 0;
+  m_pLog->m_dropped = 0;
+  m_sampleEvery = qMax (1, sampleEvery);
+  m_startTime = g_get_monotonic_time ();
+  m_pGraph = graph;
+  m_pLog->m_recording = true;
+
+  m_probes.add (graph->m_pGraph, (GstPadProbeType) (
+                    GST_PAD_PROBE_TYPE_BUFFER
+                    | GST_PAD_PROBE_TYPE_BUFFER_LIST
+                    | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                trace_pad_probe, padData, this, elementAdded);
+
+  graph->AddBusListener (trace_bus_listener, this);
+  m_pQueueTimer->start ();
+  return true;
+}
+
+void
+TraceRecorder::stop ()
+{
+  if (!isRecording ())
+    return;
+
+  m_pLog->m_recording = false;
+  m_pQueueTimer->stop ();
+  m_pGraph->RemoveBusListener (trace_bus_listener, this);
+
+  /* the pad traces go with the last probe callback, their reference on
+   * the log with them */
+  m_probes.clear ();
+
+  g_mutex_lock (&m_lock);
+  for (std::size_t i = 0; i < m_queues.size (); i++)
+    gst_object_unref (m_queues[i]);
+  m_queues.clear ();
+  g_mutex_unlock (&m_lock);
+}
+
+bool
+TraceRecorder::isRecording () const
+{
+  return m_pLog && m_pLog->m_recording;
+}
+
+std::size_t
+TraceRecorder::eventCount () const
+{
+  return m_pLog ? qMin<std::size_t> (m_pLog->m_next, m_pLog->m_events.size ()) : 0;
+}
+
+quint64
+TraceRecorder::droppedCount () const
+{
+  return m_pLog ? (quint64) m_pLog->m_dropped : 0;
+}
+
+void
+TraceRecorder::record (int type, const char *object, const char *detail,
+                       gint64 value0, gint64 value1, gint64 value2,
+                       gint64 value3)
+{
+  if (m_pLog)
+    m_pLog->record (type, object, detail, value0, value1, value2, value3);
+}
+
+void
+TraceRecorder::sampleQueues ()
+{
+  g_mutex_lock (&m_lock);
+  for (std::size_t i = 0; i < m_queues.size (); i++) {
+    guint buffers = 0, bytes = 0;
+    guint64 time = 0;
+    g_object_get (m_queues[i], "current-level-buffers", &buffers,
+                  "current-level-bytes", &bytes, "current-level-time", &time,
+                  NULL);
+    record (TraceEvent::QueueLevel, GST_OBJECT_NAME (m_queues[i]), NULL,
+            buffers, bytes, time);
+  }
+  g_mutex_unlock (&m_lock);
+}
+
+bool
+TraceRecorder::exportChromeJson (const QString &fileName, QString &error) const
+{
+  QFile file (fileName);
+  if (!file.open (QIODevice::WriteOnly | QIODevice::Truncate)) {
+    error = file.errorString ();
+    return false;
+  }
+
+  std::size_t count = eventCount ();
+
+  /* small thread ids, named after the first pad seen pushing from them */
+  QHash<quintptr, int> threads;
+  QByteArray out;
+  out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+         "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+         "\"args\":{\"name\":\"pipeline\"}}";
+
+  for (std::size_t i = 0; i < count; i++) {
+    const TraceEvent &event = m_pLog->m_events[i];
+    if (event.m_type == TraceEvent::QueueLevel || threads.contains (event.m_thread))
+      continue;
+
+    int tid = threads.size () + 1;
+    threads[event.m_thread] = tid;
+
+    QByteArray name = (event.m_type == TraceEvent::Buffer)
+        ? QByteArray ("streaming ") + event.m_object : QByteArray ("thread");
+    out += QString (",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                    "\"tid\":%1,\"args\":{\"name\":").arg (tid).toUtf8 ();
+    appendJsonString (out, name.constData ());
+    out += "}}";
+  }
+
+  char number[160];
+  for (std::size_t i = 0; i < count; i++) {
+    const TraceEvent &event = m_pLog->m_events[i];
+    gint64 ts = event.m_time - m_startTime;
+
+    out += ",\n{";
+    switch (event.m_type) {
+      case TraceEvent::QueueLevel:
+        out += "\"name\":";
+        appendJsonString (out, event.m_object);
+        g_snprintf (number, sizeof(number), ",\"ph\":\"C\",\"ts\":%" G_GINT64_FORMAT
+                    ",\"pid\":1,\"args\":{\"buffers\":%" G_GINT64_FORMAT
+                    ",\"bytes\":%" G_GINT64_FORMAT ",\"time_ms\":%.3f}}",
+                    ts, event.m_values[0], event.m_values[1],
+                    event.m_values[2] / 1e6);
+        out += number;
+        continue;
+      case TraceEvent::Buffer:
+        out += "\"name\":\"push\",\"cat\":\"buffer\"";
+        break;
+      case TraceEvent::StateChange:
+        out += "\"name\":";
+        appendJsonString (out, event.m_object);
+        out += ",\"cat\":\"state\"";
+        break;
+      case TraceEvent::Qos:
+        out += "\"name\":\"qos\",\"cat\":\"qos\"";
+        break;
+      case TraceEvent::Caps:
+        out += "\"name\":\"caps\",\"cat\":\"event\"";
+        break;
+      case TraceEvent::Segment:
+        out += "\"name\":\"segment\",\"cat\":\"event\"";
+        break;
+      case TraceEvent::Eos:
+        out += "\"name\":\"eos\",\"cat\":\"event\"";
+        break;
+      default:
+        out += "\"name\":\"message\",\"cat\":\"message\"";
+        break;
+    }
+
+    /* state changes are drawn across the whole process */
+    g_snprintf (number, sizeof(number), ",\"ph\":\"i\",\"s\":\"%s\",\"ts\":%"
+                G_GINT64_FORMAT ",\"pid\":1,\"tid\":%d,\"args\":{\"object\":",
+                event.m_type == TraceEvent::StateChange ? "p" : "t", ts,
+                threads.value (event.m_thread));
+    out += number;
+    appendJsonString (out, event.m_object);
+
+    switch (event.m_type) {
+      case TraceEvent::Buffer:
+        g_snprintf (number, sizeof(number), ",\"pts\":%" G_GINT64_FORMAT
+                    ",\"duration\":%" G_GINT64_FORMAT ",\"size\":%"
+                    G_GINT64_FORMAT ",\"buffers\":%" G_GINT64_FORMAT,
+                    event.m_values[0], event.m_values[1], event.m_values[2],
+                    event.m_values[3]);
+        out += number;
+        break;
+      case TraceEvent::Qos:
+        g_snprintf (number, sizeof(number), ",\"jitter\":%" G_GINT64_FORMAT
+                    ",\"proportion\":%.3f,\"processed\":%" G_GINT64_FORMAT
+                    ",\"dropped\":%" G_GINT64_FORMAT, event.m_values[0],
+                    event.m_values[1] / 1000.0, event.m_values[2],
+                    event.m_values[3]);
+        out += number;
+        break;
+      case TraceEvent::Segment:
+        g_snprintf (number, sizeof(number), ",\"start\":%" G_GINT64_FORMAT
+                    ",\"stop\":%" G_GINT64_FORMAT ",\"time\":%" G_GINT64_FORMAT,
+                    event.m_values[0], event.m_values[1], event.m_values[2]);
+        out += number;
+        break;
+      default:
+        break;
+    }
+
+    if (event.m_detail[0]) {
+      out += ",\"detail\":";
+      appendJsonString (out, event.m_detail);
+    }
+    out += "}}";
+
+    /* keep the memory flat on large traces */
+    if (out.size () > 1024 * 1024) {
+      if (file.write (out) != out.size ()) {
+        error = file.errorString ();
+        return false;
+      }
+      out.clear ();
+    }
+  }
+
+  out += "\n]}\n";
+  if (file.write (out) != out.size ()) {
+    error = file.errorString ();
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,92 @@
+#ifndef TRACE_RECORDER_H_
+#define TRACE_RECORDER_H_
+
+#include <QObject>
+#include <QString>
+
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "PadProbes.h"
+
+class GraphManager;
+class QTimer;
+struct TraceLog;
+
+#define TRACE_NAME_SIZE 48
+#define TRACE_DETAIL_SIZE 80
+
+struct TraceEvent
+{
+  enum Type
+  {
+    StateChange,
+    Buffer,
+    QueueLevel,
+    Qos,
+    Caps,
+    Segment,
+    Eos,
+    Message
+  };
+
+  gint64 m_time;     /* monotonic, in microseconds */
+  quintptr m_thread;
+  int m_type;
+  gint64 m_values[4];
+  char m_object[TRACE_NAME_SIZE];
+  char m_detail[TRACE_DETAIL_SIZE];
+};
+
+/* Records what the pipeline does on a timeline: state changes, sampled
+ * buffer pushes, caps and segments per pad, queue levels and QoS, along
+ * with the thread which did it. The events go into a buffer allocated up
+ * front, recording stops adding events once it is full. The probes write
+ * to the buffer, not to the recorder, and keep it alive until their last
+ * callback returned. */
+class TraceRecorder: public QObject
+{
+  Q_OBJECT
+
+public:
+  TraceRecorder(QObject *parent = 0);
+  ~TraceRecorder();
+
+  /* one buffer push out of sampleEvery is recorded on each pad */
+  bool start(GraphManager *graph, int sampleEvery);
+  void stop();
+  bool isRecording() const;
+
+  std::size_t eventCount() const;
+  quint64 droppedCount() const;
+
+  /* trace event format, loads in chrome://tracing and ui.perfetto.dev */
+  bool exportChromeJson(const QString &fileName, QString &error) const;
+
+  /* from the bus and the queue timer, in any thread */
+  void record(int type, const char *object, const char *detail,
+      gint64 value0 = 0, gint64 value1 = 0, gint64 value2 = 0,
+      gint64 value3 = 0);
+
+private slots:
+  void sampleQueues();
+
+private:
+  static PadProbes::State *padData(GstPad *pad, gpointer data);
+  static void elementAdded(GstElement *element, gpointer data);
+
+  /* a reference */
+  TraceLog *m_pLog;
+  gint64 m_startTime;
+  int m_sampleEvery;
+
+  GraphManager *m_pGraph;
+  GMutex m_lock;
+  std::vector<GstElement *> m_queues;
+  QTimer *m_pQueueTimer;
+  /* declared last, the probes go first */
+  PadProbes m_probes;
+};
+
+#endif
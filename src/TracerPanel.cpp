@@ -0,0 +1,513 @@
+#include "TracerPanel.h"
+
+#include <QCheckBox>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTabWidget>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include <gst/gst.h>
+
+#include "CustomSettings.h"
+#include "GraphManager.h"
+#include "MetricsReport.h"
+
+#define TRACER_REFRESH_INTERVAL 1000
+
+enum {
+  NAME_COLUMN,
+  PARAMS_COLUMN,
+  DESCRIPTION_COLUMN
+};
+
+namespace
+{
+  QTreeWidget *
+  createView (const QStringList &headers)
+  {
+    QTreeWidget *pview = new QTreeWidget;
+    pview->setHeaderLabels (headers);
+    pview->setUniformRowHeights (true);
+    pview->setSortingEnabled (true);
+    pview->header ()->setSectionResizeMode (0, QHeaderView::Stretch);
+    pview->header ()->setStretchLastSection (false);
+    return pview;
+  }
+
+  /* milliseconds with microsecond precision, sortable as a number */
+  QVariant
+  toMs (double ns)
+  {
+    return qRound64 (ns / 1000) / 1000.0;
+  }
+
+  void
+  fillLatency (QTreeWidgetItem *parent,
+               const QMap<QString, TracerStats::Stat> &stats)
+  {
+    QMap<QString, TracerStats::Stat>::const_iterator it;
+    for (it = stats.begin (); it != stats.end (); ++it) {
+      QTreeWidgetItem *pitem = new QTreeWidgetItem (parent);
+      pitem->setText (0, it.key ());
+      pitem->setData (1, Qt::DisplayRole, (double) it->m_count);
+      pitem->setData (2, Qt::DisplayRole, toMs (it->mean ()));
+      pitem->setData (3, Qt::DisplayRole, toMs (it->m_min));
+      pitem->setData (4, Qt::DisplayRole, toMs (it->m_max));
+    }
+  }
+
+  void
+  addLoad (QTreeWidget *view, const QString &name,
+           const TracerStats::Load &load)
+  {
+    QTreeWidgetItem *pitem = new QTreeWidgetItem (view);
+    pitem->setText (0, name);
+    pitem->setData (1, Qt::DisplayRole, load.m_current / 10.0);
+    pitem->setData (2, Qt::DisplayRole, load.m_average / 10.0);
+    pitem->setData (3, Qt::DisplayRole, toMs (load.m_time));
+  }
+
+  /* "latency(flags=element);rusage" */
+  QHash<QString, QString>
+  parseTracers (const QString &tracers)
+  {
+    QHash<QString, QString> parsed;
+
+    QStringList items = tracers.split (';', QString::SkipEmptyParts);
+    for (int i = 0; i < items.size (); i++) {
+      QString item = items[i].trimmed ();
+      int open = item.indexOf ('(');
+      if (open < 0)
+        parsed[item] = QString ();
+      else
+        parsed[item.left (open)] = item.mid (open + 1).section (')', 0, 0);
+    }
+
+    return parsed;
+  }
+}
+
+TracerPanel::TracerPanel (GraphManager *graph, QWidget *parent)
+: QWidget (parent),
+m_pGraph (graph),
+m_dirty (false),
+m_truncated (0),
+m_unparsed (0),
+m_droppedBase (Logger::instance ().tracerDropped ())
+{
+  m_pFactories = new QTreeWidget;
+  m_pFactories->setHeaderLabels (QStringList () << "Tracer" << "Parameters"
+                                 << "Description");
+  m_pFactories->setRootIsDecorated (false);
+  m_pFactories->setUniformRowHeights (true);
+  m_pFactories->setEditTriggers (QAbstractItemView::NoEditTriggers);
+
+  QPushButton *penable = new QPushButton ("Enable");
+  penable->setToolTip ("Enable the checked tracers, before building the "
+                       "pipeline to see all of it; not while it is paused "
+                       "or playing");
+  m_pAtStartup = new QCheckBox ("Enable at startup");
+  QPushButton *preset = new QPushButton ("Reset");
+  preset->setToolTip ("Forget what the tracers reported so far");
+  QPushButton *pexport = new QPushButton ("Export Report...");
+  m_pRecordsStatus = new QLabel;
+  m_pRecordsStatus->setToolTip ("Tracer records cut at 512 bytes, not "
+                                "parsing as a structure, or lost because "
+                                "the log could not keep up");
+
+  QHBoxLayout *phblayButtons = new QHBoxLayout;
+  phblayButtons->addWidget (penable);
+  phblayButtons->addWidget (m_pAtStartup);
+  phblayButtons->addWidget (m_pRecordsStatus, 1);
+  phblayButtons->addWidget (preset);
+  phblayButtons->addWidget (pexport);
+
+  m_pLatency = createView (QStringList () << "Path" << "Count" << "Mean (ms)"
+                           << "Min (ms)" << "Max (ms)");
+  m_pLoad = createView (QStringList () << "Thread" << "Current %"
+                        << "Average %" << "CPU time (ms)");
+  m_pLoad->setRootIsDecorated (false);
+  m_pTraffic = createView (QStringList () << "Element" << "Buffers" << "Bytes");
+  m_pTraffic->setRootIsDecorated (false);
+  m_pLeaks = createView (QStringList () << "Type" << "Live objects");
+  m_pLeaks->setRootIsDecorated (false);
+
+  QPushButton *prefreshLeaks = new QPushButton ("Refresh");
+  m_pLeaksStatus = new QLabel;
+  QHBoxLayout *phblayLeaks = new QHBoxLayout;
+  phblayLeaks->addWidget (prefreshLeaks);
+  phblayLeaks->addWidget (m_pLeaksStatus, 1);
+
+  QWidget *pleaksPage = new QWidget;
+  QVBoxLayout *pvblayLeaks = new QVBoxLayout;
+  pvblayLeaks->setContentsMargins (0, 0, 0, 0);
+  pvblayLeaks->addWidget (m_pLeaks, 1);
+  pvblayLeaks->addLayout (phblayLeaks);
+  pleaksPage->setLayout (pvblayLeaks);
+
+  QTabWidget *ptabs = new QTabWidget;
+  ptabs->addTab (m_pFactories, "Tracers");
+  ptabs->addTab (m_pLatency, "Latency");
+  ptabs->addTab (m_pLoad, "CPU");
+  ptabs->addTab (m_pTraffic, "Buffers");
+  ptabs->addTab (pleaksPage, "Leaks");
+
+  QVBoxLayout *playout = new QVBoxLayout;
+  playout->setContentsMargins (0, 0, 0, 0);
+  playout->addWidget (ptabs, 1);
+  playout->addLayout (phblayButtons);
+  setLayout (playout);
+
+  m_pRefreshTimer = new QTimer (this);
+  m_pRefreshTimer->setInterval (TRACER_REFRESH_INTERVAL);
+
+  connect (penable, SIGNAL (clicked ()), SLOT (enableSelected ()));
+  connect (m_pFactories, SIGNAL (itemDoubleClicked (QTreeWidgetItem *, int)),
+           SLOT (editParams (QTreeWidgetItem *)));
+  connect (m_pAtStartup, SIGNAL (toggled (bool)), SLOT (saveStartup ()));
+  connect (preset, SIGNAL (clicked ()), SLOT (resetStats ()));
+  connect (pexport, SIGNAL (clicked ()), SLOT (exportReport ()));
+  connect (prefreshLeaks, SIGNAL (clicked ()), SLOT (refreshLeaks ()));
+  connect (m_pRefreshTimer, SIGNAL (timeout ()), SLOT (refreshViews ()));
+  connect (&Logger::instance (), SIGNAL (sendTracerRecords (const QVector<LogRecord> &)),
+           SLOT (addRecords (const QVector<LogRecord> &)));
+
+  /* the ones from GST_TRACERS were created by gst_init */
+  m_enabled = parseTracers (QString::fromLocal8Bit (qgetenv ("GST_TRACERS")));
+  fillFactories ();
+
+  QHash<QString, QString> startup = parseTracers (CustomSettings::lastTracers ());
+  QHash<QString, QString>::const_iterator it;
+  for (it = startup.begin (); it != startup.end (); ++it) {
+    if (!m_enabled.contains (it.key ()))
+      enableTracer (it.key (), it.value ());
+  }
+  m_pAtStartup->blockSignals (true);
+  m_pAtStartup->setChecked (!startup.isEmpty ());
+  m_pAtStartup->blockSignals (false);
+
+  if (!m_enabled.isEmpty ()) {
+    Logger::instance ().pinThreshold ("GST_TRACER", GST_LEVEL_TRACE);
+    gst_debug_set_active (TRUE);
+    m_pRefreshTimer->start ();
+  }
+}
+
+void
+TracerPanel::fillFactories ()
+{
+  GList *factories = gst_tracer_factory_get_list ();
+
+  for (GList *l = factories; l != NULL; l = l->next) {
+    GstPluginFeature *feature = GST_PLUGIN_FEATURE (l->data);
+    QString name = gst_plugin_feature_get_name (feature);
+
+    QTreeWidgetItem *pitem = new QTreeWidgetItem (m_pFactories);
+    pitem->setText (NAME_COLUMN, name);
+    pitem->setFlags (pitem->flags () | Qt::ItemIsUserCheckable
+                     | Qt::ItemIsEditable);
+    pitem->setCheckState (NAME_COLUMN, Qt::Unchecked);
+
+    GstPlugin *plugin = gst_plugin_feature_get_plugin (feature);
+    if (plugin) {
+      pitem->setText (DESCRIPTION_COLUMN, gst_plugin_get_description (plugin));
+      gst_object_unref (plugin);
+    }
+    m_factoryItems[name] = pitem;
+  }
+
+  gst_plugin_feature_list_free (factories);
+
+  QHash<QString, QString>::const_iterator it;
+  for (it = m_enabled.begin (); it != m_enabled.end (); ++it) {
+    QTreeWidgetItem *pitem = m_factoryItems.value (it.key ());
+    if (!pitem)
+      continue;
+
+    pitem->setCheckState (NAME_COLUMN, Qt::Checked);
+    pitem->setText (PARAMS_COLUMN, it.value ());
+    pitem->setFlags (pitem->flags () & ~Qt::ItemIsEnabled);
+  }
+
+  m_pFactories->sortItems (NAME_COLUMN, Qt::AscendingOrder);
+}
+
+bool
+TracerPanel::enableTracer (const QString &name, const QString &params)
+{
+  QTreeWidgetItem *pitem = m_factoryItems.value (name);
+  if (!pitem)
+    return false;
+
+#if GST_CHECK_VERSION(1,14,0)
+  GstPluginFeature *feature = gst_registry_find_feature (
+      gst_registry_get (), name.toUtf8 ().constData (), GST_TYPE_TRACER_FACTORY);
+  if (!feature)
+    return false;
+
+  GstPluginFeature *loaded = gst_plugin_feature_load (feature);
+  gst_object_unref (feature);
+  if (!loaded)
+    return false;
+
+  GType type = gst_tracer_factory_get_tracer_type (GST_TRACER_FACTORY (loaded));
+  gst_object_unref (loaded);
+  if (!type)
+    return false;
+
+  /* registers its hooks while constructed, the hooks keep it alive */
+  QByteArray utf8Params = params.toUtf8 ();
+  GstTracer *tracer = (GstTracer *) g_object_new (
+      type, "params", params.isEmpty () ? NULL : utf8Params.constData (), NULL);
+  gst_object_ref_sink (tracer);
+  gst_object_unref (tracer);
+
+  m_enabled[name] = params;
+  pitem->setCheckState (NAME_COLUMN, Qt::Checked);
+  pitem->setText (PARAMS_COLUMN, params);
+  pitem->setFlags (pitem->flags () & ~Qt::ItemIsEnabled);
+
+  LOG_INFO("Tracer %s enabled", name.toStdString ().c_str ());
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+TracerPanel::editParams (QTreeWidgetItem *item)
+{
+  /* "flags=pipeline+element" and the like, only before enabling */
+  if (!m_enabled.contains (item->text (NAME_COLUMN)))
+    m_pFactories->editItem (item, PARAMS_COLUMN);
+}
+
+QString
+TracerPanel::enabledTracers () const
+{
+  QStringList tracers;
+
+  QHash<QString, QString>::const_iterator it;
+  for (it = m_enabled.begin (); it != m_enabled.end (); ++it)
+    tracers.append (it.value ().isEmpty () ? it.key ()
+                    : QString ("%1(%2)").arg (it.key ()).arg (it.value ()));
+
+  tracers.sort ();
+  return tracers.join (';');
+}
+
+bool
+TracerPanel::isStreaming () const
+{
+  GstState state, pending;
+  gst_element_get_state (m_pGraph->m_pGraph, &state, &pending, 0);
+  return state > GST_STATE_READY || pending > GST_STATE_READY;
+}
+
+void
+TracerPanel::enableSelected ()
+{
+  QStringList failed;
+
+  /* the hooks would be registered under the running streaming threads */
+  if (isStreaming ()) {
+    QMessageBox::warning (this, "Tracers",
+                          "Stop the pipeline before enabling tracers");
+    return;
+  }
+
+  for (int i = 0; i < m_pFactories->topLevelItemCount (); i++) {
+    QTreeWidgetItem *pitem = m_pFactories->topLevelItem (i);
+    QString name = pitem->text (NAME_COLUMN);
+    if (pitem->checkState (NAME_COLUMN) != Qt::Checked || m_enabled.contains (name))
+      continue;
+
+    if (!enableTracer (name, pitem->text (PARAMS_COLUMN).trimmed ()))
+      failed.append (name);
+  }
+
+  if (!m_enabled.isEmpty ()) {
+    Logger::instance ().pinThreshold ("GST_TRACER", GST_LEVEL_TRACE);
+    gst_debug_set_active (TRUE);
+    m_pRefreshTimer->start ();
+  }
+
+  saveStartup ();
+
+  if (!failed.isEmpty ())
+    QMessageBox::warning (this, "Tracers",
+                          "Could not enable " + failed.join (", ")
+                          + ", tracers are created at runtime since "
+                          "GStreamer 1.14");
+}
+
+void
+TracerPanel::saveStartup ()
+{
+  CustomSettings::saveTracers (m_pAtStartup->isChecked () ? enabledTracers ()
+                               : QString ());
+}
+
+void
+TracerPanel::addRecords (const QVector<LogRecord> &records)
+{
+  for (int i = 0; i < records.size (); i++) {
+    /* a cut structure may still parse, with a wrong last field */
+    if (records[i].m_truncated)
+      m_truncated++;
+    else if (m_stats.addRecord (records[i].m_message))
+      m_dirty = true;
+    else
+      m_unparsed++;
+  }
+}
+
+void
+TracerPanel::showRecordsStatus ()
+{
+  unsigned dropped = Logger::instance ().tracerDropped () - m_droppedBase;
+  if (!m_truncated && !m_unparsed && !dropped) {
+    m_pRecordsStatus->clear ();
+    return;
+  }
+
+  m_pRecordsStatus->setText (QString ("Records lost: %1 truncated, %2 "
+                                      "unparsed, %3 dropped")
+                             .arg (m_truncated).arg (m_unparsed)
+                             .arg (dropped));
+}
+
+void
+TracerPanel::refreshViews ()
+{
+  if (!isVisible ())
+    return;
+
+  showRecordsStatus ();
+  if (!m_dirty)
+    return;
+  m_dirty = false;
+
+  m_pLatency->clear ();
+  if (!m_stats.elementLatencies ().isEmpty ()) {
+    QTreeWidgetItem *pelements = new QTreeWidgetItem (m_pLatency);
+    pelements->setText (0, "Elements");
+    fillLatency (pelements, m_stats.elementLatencies ());
+    pelements->setExpanded (true);
+  }
+  if (!m_stats.linkLatencies ().isEmpty ()) {
+    QTreeWidgetItem *plinks = new QTreeWidgetItem (m_pLatency);
+    plinks->setText (0, "Source to sink");
+    fillLatency (plinks, m_stats.linkLatencies ());
+    plinks->setExpanded (true);
+  }
+
+  m_pLoad->clear ();
+  if (m_stats.hasProcessLoad ())
+    addLoad (m_pLoad, "process", m_stats.processLoad ());
+  QMap<QString, TracerStats::Load>::const_iterator load;
+  for (load = m_stats.threadLoads ().begin ();
+       load != m_stats.threadLoads ().end (); ++load)
+    addLoad (m_pLoad, load.key (), load.value ());
+
+  m_pTraffic->clear ();
+  QList<TracerStats::Traffic> traffic = m_stats.traffic ();
+  for (int i = 0; i < traffic.size (); i++) {
+    QTreeWidgetItem *pitem = new QTreeWidgetItem (m_pTraffic);
+    pitem->setText (0, traffic[i].m_element);
+    pitem->setData (1, Qt::DisplayRole, (double) traffic[i].m_buffers);
+    pitem->setData (2, Qt::DisplayRole, (double) traffic[i].m_bytes);
+  }
+}
+
+void
+TracerPanel::refreshLeaks ()
+{
+  m_pLeaks->clear ();
+
+#if GST_CHECK_VERSION(1,18,0)
+  QMap<QString, int> counts;
+  bool found = false;
+
+  GList *tracers = gst_tracing_get_active_tracers ();
+  for (GList *l = tracers; l != NULL; l = l->next) {
+    if (g_strcmp0 (G_OBJECT_TYPE_NAME (l->data), "GstLeaksTracer"))
+      continue;
+
+    GstStructure *info = NULL;
+    g_signal_emit_by_name (l->data, "get-live-objects", &info);
+    found = true;
+    if (!info)
+      continue;
+
+    const GValue *list = gst_structure_get_value (info, "live-objects-list");
+    guint size = list ? gst_value_list_get_size (list) : 0;
+    for (guint i = 0; i < size; i++) {
+      const GstStructure *object = gst_value_get_structure (
+          gst_value_list_get_value (list, i));
+      const GValue *value = gst_structure_get_value (object, "object");
+      if (value)
+        counts[g_type_name (G_VALUE_TYPE (value))]++;
+    }
+    gst_structure_free (info);
+  }
+  g_list_free_full (tracers, gst_object_unref);
+
+  if (!found) {
+    m_pLeaksStatus->setText ("The leaks tracer is not enabled");
+    return;
+  }
+
+  m_stats.setLiveObjects (counts);
+
+  int total = 0;
+  QMap<QString, int>::const_iterator it;
+  for (it = counts.begin (); it != counts.end (); ++it) {
+    QTreeWidgetItem *pitem = new QTreeWidgetItem (m_pLeaks);
+    pitem->setText (0, it.key ());
+    pitem->setData (1, Qt::DisplayRole, it.value ());
+    total += it.value ();
+  }
+  m_pLeaks->sortItems (1, Qt::DescendingOrder);
+  m_pLeaksStatus->setText (QString ("%1 objects alive").arg (total));
+#else
+  m_pLeaksStatus->setText ("Live objects need GStreamer 1.18");
+#endif
+}
+
+void
+TracerPanel::resetStats ()
+{
+  m_stats.clear ();
+  m_truncated = 0;
+  m_unparsed = 0;
+  m_droppedBase = Logger::instance ().tracerDropped ();
+  m_dirty = true;
+  refreshViews ();
+  m_pLeaks->clear ();
+  m_pLeaksStatus->clear ();
+}
+
+void
+TracerPanel::exportReport ()
+{
+  QString path = QFileDialog::getSaveFileName (this, "Export Report",
+                                               CustomSettings::lastIODirectory (),
+                                               "JSON (*.json)");
+  if (path.isEmpty ())
+    return;
+
+  MetricsReport report;
+  m_stats.fillReport (report);
+
+  QString error;
+  if (!report.write (path, error))
+    QMessageBox::warning (this, "Export Report",
+                          "Could not write " + path + ": " + error);
+}
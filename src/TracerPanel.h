@@ -0,0 +1,75 @@
+#ifndef TRACER_PANEL_H_
+#define TRACER_PANEL_H_
+
+#include <QWidget>
+#include <QHash>
+#include <QVector>
+
+#include "Logger.h"
+#include "TracerStats.h"
+
+class GraphManager;
+class QCheckBox;
+class QLabel;
+class QTimer;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+/* Enables GStreamer's tracers in the running process and shows what they
+ * report. Their records are taken from the debug log hook and parsed as
+ * structures, the text log is never read back. A tracer cannot be removed
+ * once enabled, it stays until pipeviz exits. Tracers are only created
+ * while the pipeline is not streaming, GStreamer does not lock its hook
+ * list against the threads running the hooks. */
+class TracerPanel: public QWidget
+{
+  Q_OBJECT
+
+public:
+  TracerPanel(GraphManager *graph, QWidget *parent = 0);
+
+  const TracerStats &stats() const { return m_stats; }
+
+public slots:
+  void addRecords(const QVector<LogRecord> &records);
+
+private slots:
+  void enableSelected();
+  void editParams(QTreeWidgetItem *item);
+  void saveStartup();
+  void refreshViews();
+  void refreshLeaks();
+  void resetStats();
+  void exportReport();
+
+private:
+  void fillFactories();
+  bool enableTracer(const QString &name, const QString &params);
+  QString enabledTracers() const;
+  bool isStreaming() const;
+  void showRecordsStatus();
+
+  GraphManager *m_pGraph;
+  TracerStats m_stats;
+  bool m_dirty;
+  /* records lost to the 512 bytes of a log record, to the parser and to
+   * a full log ring since the last reset */
+  quint64 m_truncated;
+  quint64 m_unparsed;
+  unsigned m_droppedBase;
+  /* name to params of every tracer running in the process */
+  QHash<QString, QString> m_enabled;
+
+  QTreeWidget *m_pFactories;
+  QHash<QString, QTreeWidgetItem *> m_factoryItems;
+  QCheckBox *m_pAtStartup;
+  QTreeWidget *m_pLatency;
+  QTreeWidget *m_pLoad;
+  QTreeWidget *m_pTraffic;
+  QTreeWidget *m_pLeaks;
+  QLabel *m_pLeaksStatus;
+  QLabel *m_pRecordsStatus;
+  QTimer *m_pRefreshTimer;
+};
+
+#endif
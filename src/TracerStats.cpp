@@ -0,0 +1,243 @@
+#include "TracerStats.h"
+
+#include <QJsonArray>
+
+#include "MetricsReport.h"
+
+TracerStats::Stat::Stat ()
+: m_count (0),
+m_sum (0),
+m_min (G_MAXUINT64),
+m_max (0),
+m_last (0)
+{
+}
+
+void
+TracerStats::Stat::add (guint64 value)
+{
+  m_count++;
+  m_sum += value;
+  m_min = MIN (m_min, value);
+  m_max = MAX (m_max, value);
+  m_last = value;
+}
+
+QJsonObject
+TracerStats::Stat::toJson () const
+{
+  /* nanoseconds, as the tracers report them */
+  QJsonObject object;
+  object["count"] = (double) m_count;
+  object["mean_ns"] = mean ();
+  object["min_ns"] = (double) (m_count ? m_min : 0);
+  object["max_ns"] = (double) m_max;
+  object["last_ns"] = (double) m_last;
+  return object;
+}
+
+TracerStats::TracerStats ()
+: m_hasProcessLoad (false)
+{
+  m_processLoad.m_current = 0;
+  m_processLoad.m_average = 0;
+  m_processLoad.m_time = 0;
+}
+
+bool
+TracerStats::addRecord (const char *message)
+{
+  GstStructure *record = gst_structure_from_string (message, NULL);
+  if (!record)
+    return false;
+
+  addRecord (record);
+  gst_structure_free (record);
+  return true;
+}
+
+void
+TracerStats::addRecord (const GstStructure *record)
+{
+  if (gst_structure_has_name (record, "latency"))
+    addLatency (record);
+  else if (gst_structure_has_name (record, "element-latency"))
+    addElementLatency (record);
+  else if (gst_structure_has_name (record, "thread-rusage")) {
+    guint64 thread = 0;
+    gst_structure_get_uint64 (record, "thread-id", &thread);
+    addLoad (record, m_threadLoad[QString ("0x%1").arg (thread, 0, 16)]);
+  }
+  else if (gst_structure_has_name (record, "proc-rusage")) {
+    addLoad (record, m_processLoad);
+    m_hasProcessLoad = true;
+  }
+  else if (gst_structure_has_name (record, "new-element")) {
+    guint ix;
+    const gchar *name = gst_structure_get_string (record, "name");
+    if (name && gst_structure_get_uint (record, "ix", &ix))
+      m_elementNames[ix] = name;
+  }
+  else if (gst_structure_has_name (record, "buffer"))
+    addBuffer (record);
+}
+
+void
+TracerStats::addLatency (const GstStructure *record)
+{
+  guint64 time;
+  if (!gst_structure_get_uint64 (record, "time", &time))
+    return;
+
+  const gchar *src = gst_structure_get_string (record, "src");
+  const gchar *sink = gst_structure_get_string (record, "sink");
+  const gchar *srcElement = gst_structure_get_string (record, "src-element");
+  const gchar *sinkElement = gst_structure_get_string (record, "sink-element");
+
+  /* before 1.16 the pads are named "element_pad", without the elements */
+  QString from = srcElement ? QString ("%1:%2").arg (srcElement).arg (src)
+      : QString (src);
+  QString to = sinkElement ? QString ("%1:%2").arg (sinkElement).arg (sink)
+      : QString (sink);
+
+  m_latency[from + " -> " + to].add (time);
+}
+
+void
+TracerStats::addElementLatency (const GstStructure *record)
+{
+  guint64 time;
+  const gchar *element = gst_structure_get_string (record, "element");
+  if (!element || !gst_structure_get_uint64 (record, "time", &time))
+    return;
+
+  const gchar *src = gst_structure_get_string (record, "src");
+  m_elementLatency[src ? QString ("%1:%2").arg (element).arg (src)
+                   : QString (element)].add (time);
+}
+
+void
+TracerStats::addLoad (const GstStructure *record, Load &load)
+{
+  guint value;
+  if (gst_structure_get_uint (record, "current-cpuload", &value))
+    load.m_current = value;
+  if (gst_structure_get_uint (record, "average-cpuload", &value))
+    load.m_average = value;
+  gst_structure_get_uint64 (record, "time", &load.m_time);
+}
+
+void
+TracerStats::addBuffer (const GstStructure *record)
+{
+  guint ix, size;
+  if (!gst_structure_get_uint (record, "element-ix", &ix))
+    return;
+
+  Traffic &traffic = m_traffic[ix];
+  traffic.m_buffers++;
+  if (gst_structure_get_uint (record, "buffer-size", &size))
+    traffic.m_bytes += size;
+}
+
+QList<TracerStats::Traffic>
+TracerStats::traffic () const
+{
+  QList<Traffic> list;
+
+  QHash<guint, Traffic>::const_iterator it;
+  for (it = m_traffic.begin (); it != m_traffic.end (); ++it) {
+    Traffic item = it.value ();
+    item.m_element = m_elementNames.value (it.key (),
+                                           QString ("#%1").arg (it.key ()));
+    list.append (item);
+  }
+
+  return list;
+}
+
+void
+TracerStats::setLiveObjects (const QMap<QString, int> &counts)
+{
+  m_liveObjects = counts;
+}
+
+void
+TracerStats::clear ()
+{
+  m_latency.clear ();
+  m_elementLatency.clear ();
+  m_threadLoad.clear ();
+  m_hasProcessLoad = false;
+  m_traffic.clear ();
+  m_liveObjects.clear ();
+  /* the names stay, the stats tracer only announces an element once */
+}
+
+static QJsonObject
+loadToJson (const TracerStats::Load &load)
+{
+  QJsonObject object;
+  object["current_percent"] = load.m_current / 10.0;
+  object["average_percent"] = load.m_average / 10.0;
+  object["cpu_time_ns"] = (double) load.m_time;
+  return object;
+}
+
+static QJsonObject
+statsToJson (const QMap<QString, TracerStats::Stat> &stats)
+{
+  QJsonObject object;
+
+  QMap<QString, TracerStats::Stat>::const_iterator it;
+  for (it = stats.begin (); it != stats.end (); ++it)
+    object[it.key ()] = it.value ().toJson ();
+
+  return object;
+}
+
+void
+TracerStats::fillReport (MetricsReport &report) const
+{
+  QJsonObject tracers;
+
+  if (!m_latency.isEmpty ())
+    tracers["latency"] = statsToJson (m_latency);
+  if (!m_elementLatency.isEmpty ())
+    tracers["element_latency"] = statsToJson (m_elementLatency);
+
+  if (m_hasProcessLoad || !m_threadLoad.isEmpty ()) {
+    QJsonObject rusage;
+    if (m_hasProcessLoad)
+      rusage["process"] = loadToJson (m_processLoad);
+
+    QJsonObject threads;
+    QMap<QString, Load>::const_iterator it;
+    for (it = m_threadLoad.begin (); it != m_threadLoad.end (); ++it)
+      threads[it.key ()] = loadToJson (it.value ());
+    rusage["threads"] = threads;
+    tracers["rusage"] = rusage;
+  }
+
+  QList<Traffic> buffers = traffic ();
+  if (!buffers.isEmpty ()) {
+    QJsonObject stats;
+    for (int i = 0; i < buffers.size (); i++) {
+      QJsonObject element;
+      element["buffers"] = (double) buffers[i].m_buffers;
+      element["bytes"] = (double) buffers[i].m_bytes;
+      stats[buffers[i].m_element] = element;
+    }
+    tracers["stats"] = stats;
+  }
+
+  if (!m_liveObjects.isEmpty ()) {
+    QJsonObject leaks;
+    QMap<QString, int>::const_iterator it;
+    for (it = m_liveObjects.begin (); it != m_liveObjects.end (); ++it)
+      leaks[it.key ()] = it.value ();
+    tracers["leaks"] = leaks;
+  }
+
+  report.addSection ("tracers", tracers);
+}
@@ -0,0 +1,90 @@
+#ifndef TRACER_STATS_H_
+#define TRACER_STATS_H_
+
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+#include <gst/gst.h>
+
+class MetricsReport;
+
+/* Aggregates what the latency, rusage and stats tracers log, each record
+ * being a serialized GstStructure. Nothing is kept per record, only the
+ * running figures. */
+class TracerStats
+{
+public:
+  struct Stat
+  {
+    Stat();
+    void add(guint64 value);
+    double mean() const { return m_count ? (double) m_sum / m_count : 0; }
+    QJsonObject toJson() const;
+
+    quint64 m_count;
+    guint64 m_sum;
+    guint64 m_min;
+    guint64 m_max;
+    guint64 m_last;
+  };
+
+  /* in per mille of one cpu, as the rusage tracer reports it */
+  struct Load
+  {
+    int m_current;
+    int m_average;
+    guint64 m_time;
+  };
+
+  struct Traffic
+  {
+    QString m_element;
+    quint64 m_buffers;
+    quint64 m_bytes;
+  };
+
+  TracerStats();
+
+  /* false when the message does not parse as a structure */
+  bool addRecord(const char *message);
+  void addRecord(const GstStructure *record);
+  void clear();
+
+  /* "src-element:src -> sink-element:sink" */
+  const QMap<QString, Stat> &linkLatencies() const { return m_latency; }
+  /* "element:src" */
+  const QMap<QString, Stat> &elementLatencies() const { return m_elementLatency; }
+  const QMap<QString, Load> &threadLoads() const { return m_threadLoad; }
+  bool hasProcessLoad() const { return m_hasProcessLoad; }
+  const Load &processLoad() const { return m_processLoad; }
+  QList<Traffic> traffic() const;
+
+  /* live objects per type, from the leaks tracer */
+  void setLiveObjects(const QMap<QString, int> &counts);
+  const QMap<QString, int> &liveObjects() const { return m_liveObjects; }
+
+  void fillReport(MetricsReport &report) const;
+
+private:
+  void addLatency(const GstStructure *record);
+  void addElementLatency(const GstStructure *record);
+  void addLoad(const GstStructure *record, Load &load);
+  void addBuffer(const GstStructure *record);
+
+  QMap<QString, Stat> m_latency;
+  QMap<QString, Stat> m_elementLatency;
+  QMap<QString, Load> m_threadLoad;
+  Load m_processLoad;
+  bool m_hasProcessLoad;
+
+  /* the stats tracer names elements by index */
+  QHash<guint, QString> m_elementNames;
+  QHash<guint, Traffic> m_traffic;
+
+  QMap<QString, int> m_liveObjects;
+};
+
+#endif
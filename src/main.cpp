@@ -1,13 +1,60 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include "LogParser.h"
 #include "MainWindow.h"
+#include "PerformanceReport.h"
+#include "PipelineIE.h"
+#include "Profiler.h"
+
+#include <stdio.h>
+#include <string.h>
 
 #include <gst/gst.h>
 
+/* the graph from the launch description, or else from the first file */
+static int
+exportLaunch (const QString &launch, const QStringList &files,
+              const QString &target)
+{
+  QSharedPointer<GraphManager> graph (new GraphManager);
+
+  bool loaded = false;
+  if (!launch.isNull ())
+    loaded = PipelineIE::ImportLaunch (graph, launch);
+  else if (!files.isEmpty ())
+    loaded = PipelineIE::Import (graph, files.first ());
+
+  if (!loaded) {
+    fprintf (stderr, "Nothing to export\n");
+    return 1;
+  }
+
+  QByteArray description = PipelineIE::ExportLaunch (graph).toUtf8 () + "\n";
+
+  QFile file;
+  bool opened;
+  if (target == "-")
+    opened = file.open (stdout, QIODevice::WriteOnly);
+  else {
+    file.setFileName (target);
+    opened = file.open (QIODevice::WriteOnly | QIODevice::Truncate);
+  }
+
+  if (!opened || file.write (description) != description.size ()) {
+    fprintf (stderr, "Could not write %s\n", target.toStdString ().c_str ());
+    return 1;
+  }
+
+  return 0;
+}
+
 int
 main (int argc, char **argv)
 {
   Logger::instance().configure_logger ();
   gst_init (&argc, &argv);
+  Logger::instance().attachGstDebug ();
 
   GstRegistry *registry;
 #if GST_VERSION_MAJOR >= 1
@@ -17,10 +64,112 @@ main (int argc, char **argv)
 #endif
   gst_registry_scan_path (registry, "./plugins");
 
+  /* no display is needed to run headless */
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp (argv[i], "--headless") && qgetenv ("QT_QPA_PLATFORM").isEmpty ())
+      qputenv ("QT_QPA_PLATFORM", "offscreen");
+  }
+
   QApplication app (argc, argv);
 
+  QCommandLineParser parser;
+  parser.setApplicationDescription ("Graphedit for gstreamer");
+  parser.addHelpOption ();
+
+  QCommandLineOption profileOption ("profile",
+                                    "Report time and peak memory of pipeline loading.");
+  parser.addOption (profileOption);
+  QCommandLineOption launchOption ("launch",
+                                   "Build the graph from a gst-launch description.",
+                                   "description");
+  parser.addOption (launchOption);
+  QCommandLineOption exportLaunchOption ("export-launch",
+                                         "Write the loaded graph as a gst-launch description to <file> (- for stdout) and exit.",
+                                         "file");
+  parser.addOption (exportLaunchOption);
+  QCommandLineOption convertOption ("convert",
+                                    "Convert the pipeline file to <target> (.gpi, .gpb or .gpbz) and exit.",
+                                    "target");
+  parser.addOption (convertOption);
+  QCommandLineOption gstLogFileOption ("gst-log-file",
+                                       "Also write every GStreamer debug record to <file>.",
+                                       "file");
+  parser.addOption (gstLogFileOption);
+  QCommandLineOption benchLogParserOption ("bench-log-parser",
+                                           "Measure the log tokenizer on <file> (- for generated output) and exit.",
+                                           "file");
+  parser.addOption (benchLogParserOption);
+  QCommandLineOption headlessOption ("headless",
+                                     "Play the pipeline without a window until EOS, an error or --duration, then write the performance report.");
+  parser.addOption (headlessOption);
+  QCommandLineOption durationOption ("duration",
+                                     "Stop a headless run after <seconds>.",
+                                     "seconds", "0");
+  parser.addOption (durationOption);
+  QCommandLineOption reportOption ("report",
+                                   "Write the performance report of a headless run to <file> (- for stdout, the default).",
+                                   "file", "-");
+  parser.addOption (reportOption);
+  parser.addPositionalArgument ("file", "Pipeline file to open.", "[file]");
+
+  parser.process (app);
+
+  Profiler::setEnabled (parser.isSet (profileOption));
+  Logger::instance().setLogFile (parser.value (gstLogFileOption));
+
+  if (parser.isSet (benchLogParserOption))
+    return LogParser::benchmark (parser.value (benchLogParserOption));
+
+  if (parser.isSet (convertOption)) {
+    if (parser.positionalArguments ().isEmpty ()) {
+      fprintf (stderr, "Nothing to convert\n");
+      return 1;
+    }
+
+    return PipelineIE::Convert (parser.positionalArguments ().first (),
+                                parser.value (convertOption)) ? 0 : 1;
+  }
+
+  if (parser.isSet (headlessOption)) {
+    /* the GStreamer records only reach the log file through it */
+    Logger::instance().start ();
+    QSharedPointer<GraphManager> graph (new GraphManager);
+
+    bool loaded = false;
+    if (parser.isSet (launchOption))
+      loaded = PipelineIE::ImportLaunch (graph, parser.value (launchOption));
+    else if (!parser.positionalArguments ().isEmpty ())
+      loaded = PipelineIE::Import (graph, parser.positionalArguments ().first ());
+
+    int res = 1;
+    if (loaded)
+      res = PerformanceReport::runHeadless (graph.data (),
+                                            parser.value (durationOption).toInt (),
+                                            parser.value (reportOption));
+    else
+      fprintf (stderr, "Nothing to run\n");
+
+    Logger::instance().Quit ();
+    return res;
+  }
+
+  if (parser.isSet (exportLaunchOption)) {
+    Logger::instance().start ();
+    int res = exportLaunch (parser.isSet (launchOption)
+                            ? parser.value (launchOption) : QString (),
+                            parser.positionalArguments (),
+                            parser.value (exportLaunchOption));
+    Logger::instance().Quit ();
+    return res;
+  }
+
   MainWindow wgt;
   wgt.show ();
 
+  if (parser.isSet (launchOption))
+    wgt.OpenLaunch (parser.value (launchOption));
+  else if (!parser.positionalArguments ().isEmpty ())
+    wgt.OpenFile (parser.positionalArguments ().first ());
+
   return app.exec ();
 }